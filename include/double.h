@@ -5,6 +5,8 @@
 #include <string>
 #include <limits>
 
+#include "taq-parse.h"
+
 namespace taq_proc {
 
 class Double {
@@ -15,7 +17,7 @@ public:
   Double(double value) : value_(value)  { }
   Double(const std::string& str) {
     try {
-      value_ = str.empty() ? std::numeric_limits<double>::quiet_NaN() : std::stod(str);
+      value_ = str.empty() ? std::numeric_limits<double>::quiet_NaN() : Taq::ParseDouble(str);
     }  catch (...) {
       value_ = std::numeric_limits<double>::quiet_NaN();
     }
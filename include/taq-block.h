@@ -0,0 +1,106 @@
+#ifndef TAQ_BLOCK_INCLUDED
+#define TAQ_BLOCK_INCLUDED
+
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+
+#include "taq-proc.h"
+
+// Compressed quote and trade files, i.e. v4 and files with FILE_FLAG_COMPRESSED in their version. The data section
+// holds, symbol by symbol, blocks of at most BlockIndexFooter::block_records records; a block is the v3 columns of its
+// records, with the time and price columns stored as differences to the previous record, compressed with zstd. Blocks
+// never span symbols, so block k of a symbol holds its records k * block_records onwards. The trailer is that of the
+// file's version, whose time and price indexes count records as if the data were not compressed, followed by one
+// BlockIndexEntry per block in file order, and the BlockIndexFooter after the other footers; see LocateFileSections in
+// taq-proc.h.
+
+namespace Taq {
+
+constexpr uint32_t BLOCK_RECORDS = 4096;
+constexpr int BLOCK_COMPRESSION_LEVEL = 3;
+
+// consistency of the block index with the data section and the record count
+inline bool ValidateBlockIndex(const FileHeader& fh, const FileSections& sections, const BlockIndexEntry* blocks) {
+  if (false == IsCompressedFileVersion(fh.version)) {
+    return true;
+  }
+  uint64_t offset = 0;
+  int64_t record = 1;
+  for (size_t i = 0; i < sections.block_cnt; i++) {
+    if (blocks[i].offset != offset || blocks[i].first_record != record || 0 == blocks[i].record_cnt
+        || blocks[i].record_cnt > sections.block_records) {
+      return false;
+    }
+    offset += blocks[i].size;
+    record += blocks[i].record_cnt;
+  }
+  return offset == sections.data_size && record == (int64_t)fh.rec_cnt + 1;
+}
+
+inline void DeltaEncode(char* column, size_t cnt) {
+  uint64_t previous = 0;
+  for (size_t i = 0; i < cnt; i++, column += sizeof(previous)) {
+    uint64_t value;
+    std::memcpy(&value, column, sizeof(value));
+    const uint64_t delta = value - previous;
+    std::memcpy(column, &delta, sizeof(delta));
+    previous = value;
+  }
+}
+
+inline void DeltaDecode(char* column, size_t cnt) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < cnt; i++, column += sizeof(value)) {
+    uint64_t delta;
+    std::memcpy(&delta, column, sizeof(delta));
+    value += delta;
+    std::memcpy(column, &value, sizeof(value));
+  }
+}
+
+// compresses the v3 columns of record_cnt records, which are delta-encoded in place
+inline void EncodeBlock(const FieldLayout* fields, size_t field_cnt, size_t record_cnt, char* columns, size_t size,
+                        std::vector<char>& compressed) {
+  namespace io = boost::iostreams;
+  char* column = columns;
+  for (size_t i = 0; i < field_cnt; column += record_cnt * fields[i].size, i++) {
+    if (fields[i].kind != FieldKind::Raw) {
+      DeltaEncode(column, record_cnt);
+    }
+  }
+  compressed.clear();
+  io::filtering_ostream os;
+  os.push(io::zstd_compressor(io::zstd_params(BLOCK_COMPRESSION_LEVEL)));
+  os.push(io::back_inserter(compressed));
+  os.write(columns, size);
+  os.reset();
+}
+
+// decompresses a block into the v3 columns of its record_cnt records, which take exactly size bytes
+inline void DecodeBlock(const FieldLayout* fields, size_t field_cnt, size_t record_cnt, const char* compressed,
+                        size_t compressed_size, char* columns, size_t size) {
+  namespace io = boost::iostreams;
+  io::filtering_istream is;
+  is.push(io::zstd_decompressor((std::streamsize)size), (std::streamsize)size);
+  is.push(io::array_source(compressed, compressed_size));
+  is.read(columns, size);
+  if ((size_t)is.gcount() != size || is.get() != std::char_traits<char>::eof()) {
+    throw std::domain_error("Corrupt compressed block");
+  }
+  char* column = columns;
+  for (size_t i = 0; i < field_cnt; column += record_cnt * fields[i].size, i++) {
+    if (fields[i].kind != FieldKind::Raw) {
+      DeltaDecode(column, record_cnt);
+    }
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef TAQ_NBBO_INCLUDED
+#define TAQ_NBBO_INCLUDED
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "taq-proc.h"
+
+// the NBBO over a book of per-exchange quotes; taq-prep keeps one book per symbol while building nbbo files, and
+// tick-calc rebuilds books from bbo files to compute the NBBO over a subset of the exchanges
+
+namespace Taq {
+
+struct NbboSide{
+  enum Side {BID, OFFER};
+  double price;
+  int size;
+  ExchangeMask exch_mask;
+  NbboSide(Side side) : price(NoPrice(side)), size(0) { }
+  static constexpr double NoPrice(Side side) { return side == BID ? 0 : std::numeric_limits<double>::max(); }
+};
+
+static constexpr int EXCH_BOOK_SLOTS = (Exch_Max + 3) & ~3;   // whole 256-bit vectors of doubles
+
+// one side of the per-exchange quotes as aligned arrays; a quote that is not set holds the side's no-price and zero
+// size, so the book can be scanned without looking at set_mask
+struct ExchangeBook {
+  alignas(32) double price[EXCH_BOOK_SLOTS];
+  alignas(32) double size[EXCH_BOOK_SLOTS];
+  uint32_t set_mask;
+  ExchangeBook(NbboSide::Side side) : set_mask(0) {
+    std::fill(std::begin(price), std::end(price), NbboSide::NoPrice(side));
+    std::fill(std::begin(size), std::end(size), 0);
+  }
+  int Size(int exch_idx) const { return (int)size[exch_idx]; }
+  void Set(NbboSide::Side side, int exch_idx, bool is_set, double quote_price, int quote_size) {
+    price[exch_idx] = is_set ? quote_price : NbboSide::NoPrice(side);
+    size[exch_idx] = is_set ? quote_size : 0;
+    set_mask = (set_mask & ~(1u << exch_idx)) | ((uint32_t)is_set << exch_idx);
+  }
+};
+
+// recomputes one side of the NBBO from the exchange book: the best price over all set quotes (no-price if there are
+// none), then every set quote at that price joins the exchange mask and aggregate size; no data-dependent branches
+template <NbboSide::Side side>
+void ResetNbboSide(const ExchangeBook & book, NbboSide & best_quote) {
+  uint32_t exch_mask = 0;
+#if defined(__AVX2__)
+  auto better = [] (__m256d a, __m256d b) { return side == NbboSide::BID ? _mm256_max_pd(a, b) : _mm256_min_pd(a, b); };
+  __m256d best = _mm256_set1_pd(NbboSide::NoPrice(side));
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i += 4) {
+    best = better(_mm256_load_pd(book.price + i), best);    // NaN prices keep the second operand
+  }
+  best = better(_mm256_permute2f128_pd(best, best, 1), best);
+  best = better(_mm256_permute_pd(best, 5), best);
+  __m256d size = _mm256_setzero_pd();
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i += 4) {
+    const __m256d at_best = _mm256_cmp_pd(_mm256_load_pd(book.price + i), best, _CMP_EQ_OQ);
+    exch_mask |= (uint32_t)_mm256_movemask_pd(at_best) << i;
+    size = _mm256_add_pd(size, _mm256_and_pd(at_best, _mm256_load_pd(book.size + i)));
+  }
+  size = _mm256_add_pd(size, _mm256_permute2f128_pd(size, size, 1));
+  size = _mm256_add_pd(size, _mm256_permute_pd(size, 5));
+  best_quote.price = _mm256_cvtsd_f64(best);
+  best_quote.size = (int)_mm256_cvtsd_f64(size);
+#elif defined(__SSE2__) || defined(_M_X64)
+  auto better = [] (__m128d a, __m128d b) { return side == NbboSide::BID ? _mm_max_pd(a, b) : _mm_min_pd(a, b); };
+  __m128d best = _mm_set1_pd(NbboSide::NoPrice(side));
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i += 2) {
+    best = better(_mm_load_pd(book.price + i), best);       // NaN prices keep the second operand
+  }
+  best = better(_mm_unpackhi_pd(best, best), best);
+  best = _mm_unpacklo_pd(best, best);
+  __m128d size = _mm_setzero_pd();
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i += 2) {
+    const __m128d at_best = _mm_cmpeq_pd(_mm_load_pd(book.price + i), best);
+    exch_mask |= (uint32_t)_mm_movemask_pd(at_best) << i;
+    size = _mm_add_pd(size, _mm_and_pd(at_best, _mm_load_pd(book.size + i)));
+  }
+  size = _mm_add_sd(size, _mm_unpackhi_pd(size, size));
+  best_quote.price = _mm_cvtsd_f64(best);
+  best_quote.size = (int)_mm_cvtsd_f64(size);
+#else
+  double best = NbboSide::NoPrice(side);
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i++) {
+    const double price = book.price[i];
+    best = (side == NbboSide::BID ? price > best : price < best) ? price : best;
+  }
+  double size = 0;
+  for (int i = 0; i < EXCH_BOOK_SLOTS; i++) {
+    const bool at_best = book.price[i] == best;
+    exch_mask |= (uint32_t)at_best << i;
+    size += at_best ? book.size[i] : 0;
+  }
+  best_quote.price = best;
+  best_quote.size = (int)size;
+#endif
+  best_quote.exch_mask = ExchangeMask(exch_mask & book.set_mask);   // padding and unset quotes may sit at no-price
+}
+
+// applies the quote of one exchange to one side of the NBBO: incrementally while the best price holds, and by
+// ResetNbboSide when the sole contributor to the best price leaves it; the book then holds the new quote
+template <NbboSide::Side side>
+void UpdateNbboSide(ExchangeBook & book, NbboSide & best_quote, int exch_idx, bool is_set, double price, int size) {
+  auto is_better = [] (double quote_price, double best_price) {
+    return side == NbboSide::BID ? quote_price > best_price : quote_price < best_price;
+  };
+  if (is_set) {
+    if (is_better(price, best_quote.price)) {                         // replace best quote
+      best_quote.exch_mask.reset();
+      best_quote.exch_mask.set(exch_idx);
+      best_quote.price = price;
+      best_quote.size = size;
+    } else if (price == best_quote.price) {                           // match best quote
+      if (best_quote.exch_mask.test(exch_idx)) {                      // was a conributor already - adjust size of best quote
+        best_quote.size += (size - book.Size(exch_idx));
+      } else {                                                        // join best quote
+        best_quote.exch_mask.set(exch_idx);
+        best_quote.size += size;
+      }
+    } else if (best_quote.exch_mask.test(exch_idx)) {                 // was a conributor to best quote
+      if (best_quote.exch_mask.count() > 1) {                         // remove from best quote
+        best_quote.size -= book.Size(exch_idx);
+        best_quote.exch_mask.set(exch_idx, 0);
+      } else {                                                        // was the sole conributor - reset best quote
+        book.Set(side, exch_idx, is_set, price, size);
+        ResetNbboSide<side>(book, best_quote);
+      }
+    } else if (best_quote.exch_mask.count() == 0) {
+      throw(std::logic_error("should not be here"));
+    }
+  } else if (best_quote.exch_mask.test(exch_idx)) {                 // was a conributor to best quote
+      if (best_quote.exch_mask.count() > 1) {                       // remove from best quote
+        best_quote.size -= book.Size(exch_idx);
+        best_quote.exch_mask.set(exch_idx, 0);
+      } else {                                                      // was the sole conributor - reset best quote
+        book.Set(side, exch_idx, is_set, price, size);
+        ResetNbboSide<side>(book, best_quote);
+      }
+  }
+  book.Set(side, exch_idx, is_set, price, size);
+  if (best_quote.size == 0) {
+    best_quote.price = NbboSide::NoPrice(side);
+  } else if (best_quote.size < 0) {
+    throw(std::logic_error("Negative best quote size"));
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef TAQ_PARSE_INCLUDED
+#define TAQ_PARSE_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Allocation-free parsers for the fixed text layouts found in TAQ files and tick-calc requests.
+// Each fast path accepts only the exact layout; callers fall back to the generic (boost / std) conversion
+// for anything else, so results are identical to the generic routines.
+
+namespace Taq {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define TAQ_PARSE_SWAR 0
+#else
+#define TAQ_PARSE_SWAR 1
+#endif
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+inline bool IsEightDigits(const char* p) {
+#if TAQ_PARSE_SWAR
+  uint64_t val;
+  std::memcpy(&val, p, sizeof(val));
+  return (((val & 0xF0F0F0F0F0F0F0F0ULL) | (((val + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+          == 0x3333333333333333ULL);
+#else
+  for (int i = 0; i < 8; i++) {
+    if (!IsDigit(p[i])) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+inline bool IsDigits(const char* p, size_t len) {
+  for (; len >= 8; p += 8, len -= 8) {
+    if (!IsEightDigits(p)) {
+      return false;
+    }
+  }
+  for (; len; p++, len--) {
+    if (!IsDigit(*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline uint32_t ParseTwoDigits(const char* p) {
+  return (uint32_t)(p[0] - '0') * 10 + (uint32_t)(p[1] - '0');
+}
+
+inline uint32_t ParseFourDigits(const char* p) {
+  return ParseTwoDigits(p) * 100 + ParseTwoDigits(p + 2);
+}
+
+// converts eight validated ASCII digits with three multiplications (SIMD within a register)
+inline uint32_t ParseEightDigits(const char* p) {
+#if TAQ_PARSE_SWAR
+  uint64_t val;
+  std::memcpy(&val, p, sizeof(val));
+  val -= 0x3030303030303030ULL;
+  val = (val * 10) + (val >> 8);
+  val = (((val & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+       + (((val >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  return (uint32_t)val;
+#else
+  return ParseFourDigits(p) * 10000 + ParseFourDigits(p + 4);
+#endif
+}
+
+constexpr int64_t NANOS_PER_SECOND = 1000000000LL;
+
+inline int64_t MkNanos(int64_t hours, int64_t minutes, int64_t seconds, int64_t nanos) {
+  return ((hours * 60 + minutes) * 60 + seconds) * NANOS_PER_SECOND + nanos;
+}
+
+// TAQ time HHMMSSnnnnnnnnn -> nanoseconds since midnight
+inline bool ParseTaqTime(std::string_view text, int64_t& nanos) {
+  if (text.size() != 15) {
+    return false;
+  }
+  const char* p = text.data();
+  if (!(IsEightDigits(p) && IsEightDigits(p + 7))) {
+    return false;
+  }
+  nanos = MkNanos(ParseTwoDigits(p), ParseTwoDigits(p + 2), ParseTwoDigits(p + 4),
+                  (int64_t)(p[6] - '0') * 100000000 + ParseEightDigits(p + 7));
+  return true;
+}
+
+// ISO time HH:MM:SS with optional .f to .fffffffff -> nanoseconds since midnight
+inline bool ParseIsoTime(std::string_view text, int64_t& nanos) {
+  if (text.size() < 8 || text.size() == 9 || text.size() > 18) {
+    return false;
+  }
+  const char* p = text.data();
+  if (!(IsDigit(p[0]) && IsDigit(p[1]) && p[2] == ':' && IsDigit(p[3]) && IsDigit(p[4]) && p[5] == ':'
+        && IsDigit(p[6]) && IsDigit(p[7]))) {
+    return false;
+  }
+  int64_t fraction = 0;
+  if (text.size() > 8) {
+    const size_t digits = text.size() - 9;
+    if (p[8] != '.' || !IsDigits(p + 9, digits)) {
+      return false;
+    }
+    for (size_t i = 0; i < 9; i++) {
+      fraction = fraction * 10 + (i < digits ? p[9 + i] - '0' : 0);
+    }
+  }
+  nanos = MkNanos(ParseTwoDigits(p), ParseTwoDigits(p + 3), ParseTwoDigits(p + 6), fraction);
+  return true;
+}
+
+// ISO date YYYY-MM-DD
+inline bool ParseIsoDate(std::string_view text, int& year, int& month, int& day) {
+  if (text.size() != 10) {
+    return false;
+  }
+  const char* p = text.data();
+  if (!(IsDigits(p, 4) && p[4] == '-' && IsDigits(p + 5, 2) && p[7] == '-' && IsDigits(p + 8, 2))) {
+    return false;
+  }
+  year = (int)ParseFourDigits(p);
+  month = (int)ParseTwoDigits(p + 5);
+  day = (int)ParseTwoDigits(p + 8);
+  return true;
+}
+
+// TAQ date YYYYMMDD
+inline bool ParseTaqDate(std::string_view text, int& year, int& month, int& day) {
+  if (text.size() != 8 || !IsEightDigits(text.data())) {
+    return false;
+  }
+  const char* p = text.data();
+  year = (int)ParseFourDigits(p);
+  month = (int)ParseTwoDigits(p + 4);
+  day = (int)ParseTwoDigits(p + 6);
+  return true;
+}
+
+// ISO timestamp: date and time separated by exactly one 'T' or ' '
+inline bool SplitTimestamp(std::string_view text, std::string_view& date, std::string_view& time) {
+  const size_t sep = text.find_first_of("T ");
+  if (sep == std::string_view::npos || text.find_first_of("T ", sep + 1) != std::string_view::npos) {
+    return false;
+  }
+  date = text.substr(0, sep);
+  time = text.substr(sep + 1);
+  return true;
+}
+
+// same result as std::stoi; plain decimal text avoids the temporary string
+inline int ParseInt(std::string_view text) {
+  int value = 0;
+  const char* end = text.data() + text.size();
+  const auto res = std::from_chars(text.data(), end, value);
+  if (res.ec == std::errc() && res.ptr == end) {
+    return value;
+  }
+  return std::stoi(std::string(text));
+}
+
+// same result as std::stod; plain decimal text avoids the temporary string
+inline double ParseDouble(std::string_view text) {
+  double value = 0;
+#if defined(__cpp_lib_to_chars)
+  const char* end = text.data() + text.size();
+  const auto res = std::from_chars(text.data(), end, value);
+  if (res.ec == std::errc() && res.ptr == end) {
+    return value;
+  }
+#else
+  char buffer[32];
+  if (text.size() && text.size() < sizeof(buffer) && (IsDigit(text[0]) || text[0] == '-' || text[0] == '.')) {
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    char* parsed = nullptr;
+    errno = 0;
+    value = std::strtod(buffer, &parsed);
+    if (parsed == buffer + text.size() && errno != ERANGE) {
+      return value;
+    }
+  }
+#endif
+  return std::stod(std::string(text));
+}
+
+}
+
+#endif
@@ -3,6 +3,15 @@
 
 
 #include <bitset>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 #include <boost/filesystem.hpp>
 
 #include "taq-time.h"
@@ -39,7 +48,7 @@ typedef char Symbol[18];
 typedef std::bitset<Exch_Max> ExchangeMask;
 
 enum class RecordType {
-  NA, SecMaster, Nbbo, Trade, NbboPrice
+  NA, SecMaster, Nbbo, Trade, NbboPrice, ExchangeBbo, TradeNbbo, Bar, DailySummary, NbboSnapshot
 };
 
 struct Security {
@@ -60,21 +69,50 @@ struct Security {
   double shares_outstanding_m;
 };
 
+// prices of quote and trade records are fixed point, in PRICE_TICKS_PER_UNIT ticks; an absent offer is NO_OFFER_TICKS
+constexpr int64_t PRICE_TICKS_PER_UNIT = 1000000;
+constexpr int64_t NO_OFFER_TICKS = INT64_MAX;
+
+inline int64_t MkPriceTicks(double price) {
+  if (price >= (double)NO_OFFER_TICKS / PRICE_TICKS_PER_UNIT) {
+    return NO_OFFER_TICKS;
+  }
+  return std::llround(price * PRICE_TICKS_PER_UNIT);
+}
+
+inline double PriceFromTicks(int64_t ticks) {
+  return ticks == NO_OFFER_TICKS ? std::numeric_limits<double>::max() : (double)ticks / PRICE_TICKS_PER_UNIT;
+}
+
+// record times are nanoseconds since midnight, so records compare as integers and do not depend on the boost build
 struct Nbbo {
-  const Time time;
-  const double bidp;
-  const double askp;
+  const int64_t time;
+  const int64_t bidp;
+  const int64_t askp;
   const int bids;
   const int asks;
-  Nbbo(const Time& time, double bidp, double askp, int bids, int asks)
+  Nbbo(int64_t time, int64_t bidp, int64_t askp, int bids, int asks)
     : time(time), bidp(bidp), askp(askp), bids(bids), asks(asks) {}
 };
 
 struct NbboPrice {
-  const Time time;
-  const double bidp;
-  const double askp;
-  NbboPrice(const Time& time, double bidp, double askp) : time(time), bidp(bidp), askp(askp) {}
+  const int64_t time;
+  const int64_t bidp;
+  const int64_t askp;
+  NbboPrice(int64_t time, int64_t bidp, int64_t askp) : time(time), bidp(bidp), askp(askp) {}
+};
+
+// the quote of one exchange after it changed, as the NBBO computation keeps it: a side that is not set has the no-price
+// of nbbo records and zero size
+struct ExchangeBbo {
+  const int64_t time;
+  const int64_t bidp;
+  const int64_t askp;
+  const int bids;
+  const int asks;
+  const char exch;
+  ExchangeBbo(int64_t time, int64_t bidp, int64_t askp, int bids, int asks, char exch)
+    : time(time), bidp(bidp), askp(askp), bids(bids), asks(asks), exch(exch) {}
 };
 
 struct Trade {
@@ -85,40 +123,715 @@ struct Trade {
     unsigned int ve : 1;
     unsigned int iso : 1;
   };
-  const Time time;
-  const double price;
+  const int64_t time;
+  const int64_t price;
   const int qty;
   const struct Attr attr;
   char cond[4];
-  Trade(const Time& trd_time, double trd_price, int trd_qty, Attr attr, const char *trd_cond)
+  Trade(int64_t trd_time, int64_t trd_price, int trd_qty, Attr attr, const char *trd_cond)
     : time(trd_time), price(trd_price), qty(trd_qty), attr(attr) {
     memcpy(cond, trd_cond, 4);
   }
 };
 
+// a trade with the NBBO prevailing when it printed, the last one that changed before the trade's time; without a
+// prevailing NBBO the prices are the no-prices of nbbo records and quote_time is -1
+struct TradeNbbo {
+  const int64_t time;
+  const int64_t price;
+  const int qty;
+  const Trade::Attr attr;
+  char cond[4];
+  const int64_t bidp;
+  const int64_t askp;
+  const int64_t quote_time;
+  TradeNbbo(const Trade& trade, int64_t bidp, int64_t askp, int64_t quote_time)
+    : time(trade.time), price(trade.price), qty(trade.qty), attr(trade.attr), bidp(bidp), askp(askp),
+      quote_time(quote_time) {
+    memcpy(cond, trade.cond, 4);
+  }
+};
+
+// the trades of a symbol in the second starting at time, for each second that has any; the mid is that of the NBBO
+// prevailing at the end of the second, 0 without a two-sided NBBO or quotes; quote prices are whole cents or hundredths
+// of a cent, so the mid is a whole number of ticks
+struct Bar {
+  static constexpr int64_t NANOS = 1000000000;    // the span of a bar
+  const int64_t time;
+  const int64_t open;
+  const int64_t high;
+  const int64_t low;
+  const int64_t close;
+  const int64_t volume;
+  const int64_t ve_volume;    // of the trades eligible for volume, see Trade::Attr::ve
+  const int64_t mid;
+  const int trade_cnt;
+  Bar(int64_t time, int64_t open, int64_t high, int64_t low, int64_t close, int64_t volume, int64_t ve_volume,
+      int64_t mid, int trade_cnt)
+    : time(time), open(open), high(high), low(low), close(close), volume(volume), ve_volume(ve_volume), mid(mid),
+      trade_cnt(trade_cnt) {}
+};
+
+// what the quote and trade passes of taq-prep saw of a security in a day; each pass fills its part of the record and
+// sets its bit in parts, so a part is zero until its pass has run; OHLC prices are those of the trades eligible for last
+// sale, 0 without any, and the spread and the NBBO update rate are over the regular hours
+struct DailySummary {
+  static constexpr int64_t REGULAR_OPEN = 34200LL * Bar::NANOS;      // 09:30:00
+  static constexpr int64_t REGULAR_CLOSE = 57600LL * Bar::NANOS;     // 16:00:00
+  enum Part : uint32_t {
+    TRADES = 1,
+    QUOTES = 2
+  };
+  struct Trades {
+    int64_t trade_cnt;
+    int64_t volume;
+    int64_t ve_volume;        // of the trades eligible for volume, see Trade::Attr::ve
+    int64_t lte_volume;       // of the trades eligible for last sale
+    int64_t ve_value;         // sum of price times quantity of the trades eligible for volume, in ticks
+    int64_t open;
+    int64_t high;
+    int64_t low;
+    int64_t close;
+  };
+  struct Quotes {
+    int64_t quote_cnt;        // quote rows of the input
+    int64_t nbbo_cnt;         // NBBO changes, the records of the nbbo file
+    int64_t session_nbbo_cnt; // of them in the regular hours
+    int64_t two_sided_time;   // nanoseconds of the regular hours with a two-sided, uncrossed NBBO
+    double spread_time;       // the NBBO spread in ticks integrated over two_sided_time
+  };
+  Symbol symb;
+  Symbol utp_symb;
+  uint32_t parts;
+  Trades trades;
+  Quotes quotes;
+  DailySummary() {
+    ::memset((void*)this, 0, sizeof(*this));
+  }
+};
+
+// the times of the day's NBBO snapshot, interval apart from 04:00:00 to 20:00:00; the snapshot holds the nbbo record of
+// each security prevailing at each time, i.e. its last one at or before the time, or one with time NO_NBBO before its
+// first; every record of a security no quote run with the grid has seen has time NO_COLUMN
+struct SnapshotGrid {
+  static constexpr int64_t FIRST_TIME = 14400LL * Bar::NANOS;        // 04:00:00
+  static constexpr int64_t LAST_TIME = 72000LL * Bar::NANOS;         // 20:00:00
+  static constexpr int64_t NO_NBBO = -1;
+  static constexpr int64_t NO_COLUMN = -2;
+  int64_t start;
+  int64_t interval;
+  uint64_t time_cnt;
+  SnapshotGrid() : start(0), interval(0), time_cnt(0) {}
+  explicit SnapshotGrid(int64_t interval)
+    : start(FIRST_TIME), interval(interval), time_cnt(interval > 0 ? (LAST_TIME - FIRST_TIME) / interval + 1 : 0) {}
+  int64_t Time(size_t idx) const {
+    return start + (int64_t)idx * interval;
+  }
+  // false for a time off the grid
+  bool Find(int64_t time, size_t& idx) const {
+    if (interval <= 0 || time < start || (time - start) % interval) {
+      return false;
+    }
+    idx = (size_t)((time - start) / interval);
+    return idx < time_cnt;
+  }
+  bool operator==(const SnapshotGrid& other) const {
+    return start == other.start && interval == other.interval && time_cnt == other.time_cnt;
+  }
+};
+
+// records start to end of a symbol, numbered from 1 across the file; the v7 layout of the symbol map entries
 struct SymbolMap {
+  Symbol symb;
+  int64_t start;
+  int64_t end;
+  SymbolMap(std::string_view symbol, int64_t start, int64_t end) : start(start), end(end) {
+    ::memset(symb, 0, sizeof(symb));
+    ::memcpy(symb, symbol.data(), std::min(symbol.size(), sizeof(symb) - 1));
+  }
+};
+
+// symbol map entry of files before v7
+struct SymbolMapV1 {
   Symbol symb;
   int start;
   int end;
-  SymbolMap(const std::string &symbol, int start, int end) : start(start), end(end) {
-  #ifdef _MSC_VER
-    ::strncpy_s(symb, sizeof(symb), symbol.c_str(), sizeof(symb) - 1);
-  #else
-    ::strncpy(symb, symbol.c_str(), sizeof(symb) - 1);
-  #endif
-  }
 };
 
+// the v7 layout of the header of quote and trade files; the counts of earlier files and of security master files are
+// int, see FileHeaderV1 and ReadFileHeader
 struct FileHeader {
-  const int size;
+  int size;
+  RecordType type;
+  int version;
+  Date date;
+  int64_t symb_cnt;
+  int64_t rec_cnt;
+  FileHeader(int version);
+};
+
+struct FileHeaderV1 {
+  int size;
   RecordType type;
-  const int version;
-  const Date date;
+  int version;
+  Date date;
   int symb_cnt;
   int rec_cnt;
-  FileHeader(int version) : size((int)sizeof(FileHeader)), type(RecordType::NA), version(version), symb_cnt(0), rec_cnt(0) { }
 };
 
+static_assert(offsetof(FileHeader, version) == offsetof(FileHeaderV1, version), "the version tells the header layouts apart");
+
+// FileHeader::version of quote and trade files: v1 stores packed records; v2 stores the records of each symbol as
+// columns, i.e. the first field of every record of the symbol, then the second field, and so on, without padding;
+// v3 is v2 with integer time and price columns, where earlier versions hold boost time_duration and double values;
+// v4 cuts the v3 segments into blocks that are compressed one by one, see taq-block.h, and is no longer written; v5 is
+// v3 with a coarse time index of each symbol in the trailer; v6 is v5 with a hashed symbol directory in the trailer; v7
+// is v6 with 64-bit record counts and symbol map entries; v8 is v7 with an index of the price changes in nbbo files,
+// which then serve as nbbo-po files too; v5 and later files may have FILE_FLAG_COMPRESSED set in their version
+enum FileVersion {
+  FILE_VERSION_PACKED = 1,
+  FILE_VERSION_COLUMNAR = 2,
+  FILE_VERSION_FIXED_POINT = 3,
+  FILE_VERSION_COMPRESSED = 4,
+  FILE_VERSION_TIME_INDEX = 5,
+  FILE_VERSION_SYMBOL_DIRECTORY = 6,
+  FILE_VERSION_WIDE_COUNTS = 7,
+  FILE_VERSION_PRICE_INDEX = 8
+};
+
+// the segments of the file are cut into blocks that are compressed one by one as in v4, while the trailer is that of
+// the version without the flag, with the block index added, see taq-block.h
+constexpr int FILE_FLAG_COMPRESSED = 0x100;
+
+// the version without FILE_FLAG_COMPRESSED, which tells the header, trailer and column layouts
+inline int FileLayoutVersion(int version) {
+  return version & ~FILE_FLAG_COMPRESSED;
+}
+
+inline bool IsCompressedFileVersion(int version) {
+  return version == FILE_VERSION_COMPRESSED || (version & FILE_FLAG_COMPRESSED);
+}
+
+inline bool IsSupportedFileVersion(int version) {
+  const int layout = FileLayoutVersion(version);
+  return layout >= FILE_VERSION_PACKED && layout <= FILE_VERSION_PRICE_INDEX
+      && (layout == version || layout >= FILE_VERSION_TIME_INDEX);
+}
+
+inline bool HasWideCounts(int version) {
+  return FileLayoutVersion(version) >= FILE_VERSION_WIDE_COUNTS;
+}
+
+inline bool HasPriceIndex(int version) {
+  return FileLayoutVersion(version) >= FILE_VERSION_PRICE_INDEX;
+}
+
+inline FileHeader::FileHeader(int version)
+  : size((int)(HasWideCounts(version) ? sizeof(FileHeader) : sizeof(FileHeaderV1))), type(RecordType::NA),
+    version(version), symb_cnt(0), rec_cnt(0) { }
+
+// bytes of the header, which the data section follows
+inline size_t FileHeaderSize(int version) {
+  return HasWideCounts(version) ? sizeof(FileHeader) : sizeof(FileHeaderV1);
+}
+
+inline size_t SymbolMapSize(int version) {
+  return HasWideCounts(version) ? sizeof(SymbolMap) : sizeof(SymbolMapV1);
+}
+
+// the header at the start of a file of file_size bytes in either layout; false if the file is too small for it
+inline bool ReadFileHeader(const char* file, size_t file_size, FileHeader& fh) {
+  int version;
+  if (file_size < sizeof(FileHeaderV1)) {
+    return false;
+  }
+  memcpy(&version, file + offsetof(FileHeaderV1, version), sizeof(version));
+  if (HasWideCounts(version)) {
+    if (file_size < sizeof(FileHeader)) {
+      return false;
+    }
+    memcpy((void*)&fh, file, sizeof(fh));
+    return true;
+  }
+  FileHeaderV1 fh1;
+  memcpy((void*)&fh1, file, sizeof(fh1));
+  fh.size = fh1.size;
+  fh.type = fh1.type;
+  fh.version = fh1.version;
+  fh.date = fh1.date;
+  fh.symb_cnt = fh1.symb_cnt;
+  fh.rec_cnt = fh1.rec_cnt;
+  return true;
+}
+
+// the header in the layout of its version into FileHeaderSize bytes at out; false if its counts need v7
+inline bool WriteFileHeader(const FileHeader& fh, char* out) {
+  if (HasWideCounts(fh.version)) {
+    memcpy(out, (const void*)&fh, sizeof(fh));
+    return true;
+  }
+  if (fh.symb_cnt > std::numeric_limits<int>::max() || fh.rec_cnt > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  FileHeaderV1 fh1;
+  memset((void*)&fh1, 0, sizeof(fh1));
+  fh1.size = (int)sizeof(fh1);
+  fh1.type = fh.type;
+  fh1.version = fh.version;
+  fh1.date = fh.date;
+  fh1.symb_cnt = (int)fh.symb_cnt;
+  fh1.rec_cnt = (int)fh.rec_cnt;
+  memcpy(out, (const void*)&fh1, sizeof(fh1));
+  return true;
+}
+
+// the entries of a symbol map before v7 in the v7 layout
+inline void ReadSymbolMapV1(const char* map, size_t symb_cnt, SymbolMap* out) {
+  for (size_t i = 0; i < symb_cnt; i++) {
+    SymbolMapV1 entry;
+    memcpy(&entry, map + i * sizeof(entry), sizeof(entry));
+    out[i] = SymbolMap(std::string_view(entry.symb, strnlen(entry.symb, sizeof(entry.symb))), entry.start, entry.end);
+  }
+}
+
+inline bool HasTimeIndex(int version) {
+  return FileLayoutVersion(version) >= FILE_VERSION_TIME_INDEX;
+}
+
+inline bool HasSymbolDirectory(int version) {
+  return FileLayoutVersion(version) >= FILE_VERSION_SYMBOL_DIRECTORY;
+}
+
+enum class FieldKind {
+  Raw, Time, Price
+};
+
+struct FieldLayout {
+  size_t offset;    // within the packed record
+  size_t size;
+  FieldKind kind;
+};
+
+static_assert(sizeof(Time) == sizeof(int64_t), "time fields of files before v3 hold a boost time_duration");
+
+// fields of a record type in v2 column order
+template <typename T> struct RecordLayout;
+
+template <> struct RecordLayout<Nbbo> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(Nbbo, time), sizeof(int64_t), FieldKind::Time}, {offsetof(Nbbo, bidp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(Nbbo, askp), sizeof(int64_t), FieldKind::Price}, {offsetof(Nbbo, bids), sizeof(int), FieldKind::Raw},
+    {offsetof(Nbbo, asks), sizeof(int), FieldKind::Raw}
+  };
+};
+
+template <> struct RecordLayout<NbboPrice> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(NbboPrice, time), sizeof(int64_t), FieldKind::Time},
+    {offsetof(NbboPrice, bidp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(NbboPrice, askp), sizeof(int64_t), FieldKind::Price}
+  };
+};
+
+template <> struct RecordLayout<ExchangeBbo> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(ExchangeBbo, time), sizeof(int64_t), FieldKind::Time},
+    {offsetof(ExchangeBbo, bidp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(ExchangeBbo, askp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(ExchangeBbo, bids), sizeof(int), FieldKind::Raw}, {offsetof(ExchangeBbo, asks), sizeof(int), FieldKind::Raw},
+    {offsetof(ExchangeBbo, exch), sizeof(char), FieldKind::Raw}
+  };
+};
+
+template <> struct RecordLayout<Trade> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(Trade, time), sizeof(int64_t), FieldKind::Time}, {offsetof(Trade, price), sizeof(int64_t), FieldKind::Price},
+    {offsetof(Trade, qty), sizeof(int), FieldKind::Raw}, {offsetof(Trade, attr), sizeof(Trade::Attr), FieldKind::Raw},
+    {offsetof(Trade, cond), sizeof(Trade::cond), FieldKind::Raw}
+  };
+};
+
+template <> struct RecordLayout<TradeNbbo> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(TradeNbbo, time), sizeof(int64_t), FieldKind::Time},
+    {offsetof(TradeNbbo, price), sizeof(int64_t), FieldKind::Price},
+    {offsetof(TradeNbbo, qty), sizeof(int), FieldKind::Raw}, {offsetof(TradeNbbo, attr), sizeof(Trade::Attr), FieldKind::Raw},
+    {offsetof(TradeNbbo, cond), sizeof(TradeNbbo::cond), FieldKind::Raw},
+    {offsetof(TradeNbbo, bidp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(TradeNbbo, askp), sizeof(int64_t), FieldKind::Price},
+    {offsetof(TradeNbbo, quote_time), sizeof(int64_t), FieldKind::Time}
+  };
+};
+
+template <> struct RecordLayout<Bar> {
+  static constexpr FieldLayout fields[] = {
+    {offsetof(Bar, time), sizeof(int64_t), FieldKind::Time}, {offsetof(Bar, open), sizeof(int64_t), FieldKind::Price},
+    {offsetof(Bar, high), sizeof(int64_t), FieldKind::Price}, {offsetof(Bar, low), sizeof(int64_t), FieldKind::Price},
+    {offsetof(Bar, close), sizeof(int64_t), FieldKind::Price}, {offsetof(Bar, volume), sizeof(int64_t), FieldKind::Raw},
+    {offsetof(Bar, ve_volume), sizeof(int64_t), FieldKind::Raw},
+    {offsetof(Bar, mid), sizeof(int64_t), FieldKind::Price},
+    {offsetof(Bar, trade_cnt), sizeof(int), FieldKind::Raw}
+  };
+};
+
+// bytes per record in the data section of a file of the given version; records of compressed files take this much once
+// decompressed
+template <typename T>
+size_t RecordWidth(int version) {
+  if (version == FILE_VERSION_PACKED) {
+    return sizeof(T);
+  }
+  size_t width = 0;
+  for (const FieldLayout& field : RecordLayout<T>::fields) {
+    width += field.size;
+  }
+  return width;
+}
+
+inline size_t RecordWidth(RecordType type, int version) {
+  if (type == RecordType::Nbbo) {
+    return RecordWidth<Nbbo>(version);
+  } else if (type == RecordType::NbboPrice) {
+    return RecordWidth<NbboPrice>(version);
+  } else if (type == RecordType::Trade) {
+    return RecordWidth<Trade>(version);
+  } else if (type == RecordType::ExchangeBbo) {
+    return RecordWidth<ExchangeBbo>(version);
+  } else if (type == RecordType::TradeNbbo) {
+    return RecordWidth<TradeNbbo>(version);
+  } else if (type == RecordType::Bar) {
+    return RecordWidth<Bar>(version);
+  }
+  return 0;
+}
+
+// copies a field from its form in a file of the given version to the record
+inline void ReadField(const FieldLayout& field, int version, const char* src, char* dst) {
+  int64_t value;
+  if (version < FILE_VERSION_FIXED_POINT && field.kind == FieldKind::Time) {
+    Time time;
+    std::memcpy(&time, src, sizeof(time));
+    value = NanosFromTime(time);
+  } else if (version < FILE_VERSION_FIXED_POINT && field.kind == FieldKind::Price) {
+    double price;
+    std::memcpy(&price, src, sizeof(price));
+    value = MkPriceTicks(price);
+  } else {
+    std::memcpy(dst, src, field.size);
+    return;
+  }
+  std::memcpy(dst, &value, sizeof(value));
+}
+
+// copies a field of the record to its form in a file of the given version
+inline void WriteField(const FieldLayout& field, int version, const char* src, char* dst) {
+  if (version >= FILE_VERSION_FIXED_POINT || field.kind == FieldKind::Raw) {
+    std::memcpy(dst, src, field.size);
+    return;
+  }
+  int64_t value;
+  std::memcpy(&value, src, sizeof(value));
+  if (field.kind == FieldKind::Time) {
+    const Time time = TimeFromNanos(value);
+    std::memcpy(dst, &time, sizeof(time));
+  } else {
+    const double price = PriceFromTicks(value);
+    std::memcpy(dst, &price, sizeof(price));
+  }
+}
+
+// record i of a segment of record_cnt records in a file of the given version
+template <typename T>
+T GatherRecord(const char* segment, size_t record_cnt, size_t i, int version) {
+  alignas(T) char record[sizeof(T)] = {};
+  for (const FieldLayout& field : RecordLayout<T>::fields) {
+    if (version == FILE_VERSION_PACKED) {
+      ReadField(field, version, segment + i * sizeof(T) + field.offset, record + field.offset);
+    } else {
+      ReadField(field, version, segment + i * field.size, record + field.offset);
+      segment += record_cnt * field.size;
+    }
+  }
+  return *reinterpret_cast<const T*>(record);
+}
+
+// trailer of compressed files: the trailer of their version, i.e. the symbol map in v4, then a BlockIndexEntry per block
+// in file order, and the BlockIndexFooter after the other footers
+struct BlockIndexEntry {
+  uint64_t offset;          // of the compressed block from the end of the header
+  uint32_t size;            // compressed bytes
+  uint32_t record_cnt;
+  int64_t first_record;     // numbered as SymbolMap::start
+  int64_t first_time;       // lets searches pick the block without decompressing it
+};
+
+struct BlockIndexFooter {
+  uint64_t block_cnt;
+  uint32_t block_records;
+  uint32_t reserved;
+};
+
+// v5 trailer: the symbol map, a TimeIndexEntry per symbol in symbol map order, the bucket array, then the
+// TimeIndexFooter; bucket b of a symbol spans bucket_width nanoseconds from first_time + b * bucket_width, and its
+// entry in the bucket array is the number of the symbol's records before it; buckets average
+// TIME_INDEX_BUCKET_RECORDS records, so a search within one reads a page or two of the time column
+constexpr uint64_t TIME_INDEX_BUCKET_RECORDS = 256;
+
+struct TimeIndexEntry {
+  int64_t first_time;
+  int64_t bucket_width;
+  uint64_t first_bucket;    // in the bucket array
+  uint64_t bucket_cnt;
+};
+
+struct TimeIndexFooter {
+  uint64_t bucket_cnt;      // of the bucket array
+};
+
+// the records [from, to) of a symbol's record_cnt records hold the first record at or after time and the first record
+// after time
+inline void TimeIndexRange(const TimeIndexEntry& entry, const uint64_t* buckets, uint64_t record_cnt, int64_t time,
+                           uint64_t& from, uint64_t& to) {
+  if (time < entry.first_time) {
+    from = to = 0;
+    return;
+  }
+  const uint64_t bucket = (uint64_t)(time - entry.first_time) / (uint64_t)entry.bucket_width;
+  if (bucket >= entry.bucket_cnt) {
+    from = to = record_cnt;
+    return;
+  }
+  from = buckets[entry.first_bucket + bucket];
+  to = bucket + 1 < entry.bucket_cnt ? buckets[entry.first_bucket + bucket + 1] : record_cnt;
+}
+
+// v6 trailer: the v5 trailer with the symbol directory after the bucket array, and the SymbolDirectoryFooter after the
+// TimeIndexFooter; the directory is an open addressing hash table of slot_cnt slots, a power of two, each 0 when empty
+// or 1 + the index of a symbol in the symbol map; the symbol is in the first slot from SymbolHash % slot_cnt onwards
+// that holds it, before the next empty slot
+struct SymbolDirectoryFooter {
+  uint64_t slot_cnt;
+};
+
+// FNV-1a, which does not depend on the platform
+inline uint64_t SymbolHash(std::string_view symbol) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : symbol) {
+    hash = (hash ^ (uint8_t)c) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline std::string_view SymbolName(const SymbolMap& map) {
+  return std::string_view(map.symb, strnlen(map.symb, sizeof(map.symb)));
+}
+
+// at most half the slots are used, so probes stay short
+inline uint64_t SymbolDirectorySlots(size_t symb_cnt) {
+  uint64_t slot_cnt = 2;
+  while (slot_cnt < 2 * (uint64_t)symb_cnt) {
+    slot_cnt *= 2;
+  }
+  return slot_cnt;
+}
+
+// fills the slot_cnt zeroed slots for the symbol map
+inline void BuildSymbolDirectory(const SymbolMap* symbol_map, size_t symb_cnt, uint32_t* slots, uint64_t slot_cnt) {
+  for (size_t i = 0; i < symb_cnt; i++) {
+    uint64_t slot = SymbolHash(SymbolName(symbol_map[i])) & (slot_cnt - 1);
+    while (slots[slot]) {
+      slot = (slot + 1) & (slot_cnt - 1);
+    }
+    slots[slot] = (uint32_t)(i + 1);
+  }
+}
+
+// nullptr if the symbol is not in the file; slots pointing outside the symbol map end the search as empty ones do
+inline const SymbolMap* FindSymbol(const SymbolMap* symbol_map, size_t symb_cnt, const uint32_t* slots, uint64_t slot_cnt,
+                                   std::string_view symbol) {
+  uint64_t slot = SymbolHash(symbol) & (slot_cnt - 1);
+  for (uint64_t probes = 0; probes < slot_cnt; probes++, slot = (slot + 1) & (slot_cnt - 1)) {
+    if (0 == slots[slot] || slots[slot] > symb_cnt) {
+      break;
+    }
+    const SymbolMap& map = symbol_map[slots[slot] - 1];
+    if (SymbolName(map) == symbol) {
+      return &map;
+    }
+  }
+  return nullptr;
+}
+
+// the summary file of a day: the header, whose counts are those of the day's sec master, a DailySummary per security
+// in sec master order, a symbol directory as in v6 trailers that holds the CTA and the UTP symbol of each record, and the
+// SymbolDirectoryFooter
+inline size_t SummaryFileSize(int version, size_t symb_cnt, uint64_t slot_cnt) {
+  return FileHeaderSize(version) + symb_cnt * sizeof(DailySummary) + (size_t)slot_cnt * sizeof(uint32_t)
+         + sizeof(SymbolDirectoryFooter);
+}
+
+// the snapshot file of a day: the header, whose symbol count is that of the day's sec master, time_cnt rows of an Nbbo
+// per security in sec master order, the CTA symbol of each security, and the SnapshotGrid
+inline size_t SnapshotFileSize(int version, size_t symb_cnt, uint64_t time_cnt) {
+  return FileHeaderSize(version) + symb_cnt * (size_t)time_cnt * sizeof(Nbbo) + symb_cnt * sizeof(Symbol)
+         + sizeof(SnapshotGrid);
+}
+
+// CTA symbols go in first, so one of them is found before a UTP symbol of the same name
+inline void BuildSummaryDirectory(const DailySummary* records, size_t symb_cnt, uint32_t* slots, uint64_t slot_cnt) {
+  auto insert = [&](const Symbol& symb, size_t i) {
+    const std::string_view symbol(symb, strnlen(symb, sizeof(Symbol)));
+    if (symbol.empty()) {
+      return;
+    }
+    uint64_t slot = SymbolHash(symbol) & (slot_cnt - 1);
+    while (slots[slot]) {
+      slot = (slot + 1) & (slot_cnt - 1);
+    }
+    slots[slot] = (uint32_t)(i + 1);
+  };
+  for (size_t i = 0; i < symb_cnt; i++) {
+    insert(records[i].symb, i);
+  }
+  for (size_t i = 0; i < symb_cnt; i++) {
+    if (strncmp(records[i].symb, records[i].utp_symb, sizeof(Symbol))) {
+      insert(records[i].utp_symb, i);
+    }
+  }
+}
+
+inline const DailySummary* FindSummary(const DailySummary* records, size_t symb_cnt, const uint32_t* slots,
+                                       uint64_t slot_cnt, std::string_view symbol) {
+  uint64_t slot = SymbolHash(symbol) & (slot_cnt - 1);
+  for (uint64_t probes = 0; probes < slot_cnt; probes++, slot = (slot + 1) & (slot_cnt - 1)) {
+    if (0 == slots[slot] || slots[slot] > symb_cnt) {
+      break;
+    }
+    const DailySummary& record = records[slots[slot] - 1];
+    if (std::string_view(record.symb, strnlen(record.symb, sizeof(Symbol))) == symbol
+        || std::string_view(record.utp_symb, strnlen(record.utp_symb, sizeof(Symbol))) == symbol) {
+      return &record;
+    }
+  }
+  return nullptr;
+}
+
+// v8 trailer: the v7 trailer followed by the price index, and the PriceIndexFooter after the other footers; the index of
+// an nbbo file has a PriceIndexEntry per symbol in symbol map order, then the positions of the records of each symbol
+// whose prices differ from the record before, i.e. its nbbo-po records, counted from the symbol's first record; the
+// index of other files is empty
+struct PriceIndexEntry {
+  uint64_t first_position;  // in the position array
+  uint64_t position_cnt;
+};
+
+struct PriceIndexFooter {
+  uint64_t entry_cnt;       // the symbol count, or 0 for an empty index
+  uint64_t position_cnt;
+};
+
+// offsets of the parts of a quote or trade file
+struct FileSections {
+  size_t data_size;         // the data section follows the header
+  size_t symbol_map;
+  size_t block_index;       // compressed files
+  size_t block_cnt;
+  size_t block_records;
+  size_t time_index;        // v5
+  size_t buckets;
+  size_t bucket_cnt;
+  size_t directory;         // v6
+  size_t slot_cnt;
+  size_t price_index;       // v8
+  size_t price_entry_cnt;
+  size_t positions;
+  size_t position_cnt;
+};
+
+// bytes at the end of the file that describe its trailer
+inline size_t TrailerFooterSize(int version) {
+  size_t size = 0;
+  if (HasPriceIndex(version)) {
+    size = sizeof(TimeIndexFooter) + sizeof(SymbolDirectoryFooter) + sizeof(PriceIndexFooter);
+  } else if (HasSymbolDirectory(version)) {
+    size = sizeof(TimeIndexFooter) + sizeof(SymbolDirectoryFooter);
+  } else if (HasTimeIndex(version)) {
+    size = sizeof(TimeIndexFooter);
+  }
+  return IsCompressedFileVersion(version) ? size + sizeof(BlockIndexFooter) : size;
+}
+
+// locates the sections of a file of file_size bytes whose records take record_width bytes uncompressed; footer holds
+// the last TrailerFooterSize bytes of the file; false if the sizes do not add up
+inline bool LocateFileSections(const FileHeader& fh, size_t record_width, size_t file_size, const char* footer,
+                               FileSections& sections) {
+  const size_t header_size = FileHeaderSize(fh.version);
+  const size_t footer_size = TrailerFooterSize(fh.version);
+  sections = FileSections{(size_t)fh.rec_cnt * record_width, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  if (fh.symb_cnt < 0 || fh.rec_cnt < 0 || (uint64_t)fh.symb_cnt > file_size / SymbolMapSize(fh.version)) {
+    return false;
+  }
+  const size_t map_size = (size_t)fh.symb_cnt * SymbolMapSize(fh.version);
+  if (file_size < header_size + map_size + footer_size || (footer_size && nullptr == footer)) {
+    return false;
+  }
+  const size_t available = file_size - header_size - map_size - footer_size;    // for the data and the indexes
+  size_t index_size = 0;
+  if (HasTimeIndex(fh.version)) {
+    TimeIndexFooter time_footer;
+    memcpy(&time_footer, footer, sizeof(time_footer));
+    sections.bucket_cnt = (size_t)time_footer.bucket_cnt;
+    index_size = (size_t)fh.symb_cnt * sizeof(TimeIndexEntry) + sections.bucket_cnt * sizeof(uint64_t);
+    if (time_footer.bucket_cnt > available / sizeof(uint64_t) || index_size > available) {
+      return false;
+    }
+  }
+  if (HasSymbolDirectory(fh.version)) {
+    SymbolDirectoryFooter directory_footer;
+    memcpy(&directory_footer, footer + sizeof(TimeIndexFooter), sizeof(directory_footer));
+    sections.slot_cnt = (size_t)directory_footer.slot_cnt;
+    if (0 == sections.slot_cnt || (sections.slot_cnt & (sections.slot_cnt - 1))
+        || sections.slot_cnt <= (size_t)fh.symb_cnt || sections.slot_cnt > (available - index_size) / sizeof(uint32_t)) {
+      return false;
+    }
+    index_size += sections.slot_cnt * sizeof(uint32_t);
+  }
+  if (HasPriceIndex(fh.version)) {
+    PriceIndexFooter price_footer;
+    memcpy(&price_footer, footer + sizeof(TimeIndexFooter) + sizeof(SymbolDirectoryFooter), sizeof(price_footer));
+    sections.price_entry_cnt = (size_t)price_footer.entry_cnt;
+    sections.position_cnt = (size_t)price_footer.position_cnt;
+    if ((sections.price_entry_cnt && sections.price_entry_cnt != (size_t)fh.symb_cnt)
+        || sections.position_cnt > (available - index_size) / sizeof(uint32_t)
+        || sections.price_entry_cnt * sizeof(PriceIndexEntry) > available - index_size
+                                                                - sections.position_cnt * sizeof(uint32_t)) {
+      return false;
+    }
+    index_size += sections.price_entry_cnt * sizeof(PriceIndexEntry) + sections.position_cnt * sizeof(uint32_t);
+  }
+  if (IsCompressedFileVersion(fh.version)) {
+    BlockIndexFooter block_footer;
+    memcpy(&block_footer, footer + footer_size - sizeof(block_footer), sizeof(block_footer));
+    if (0 == block_footer.block_records || block_footer.block_cnt > (available - index_size) / sizeof(BlockIndexEntry)) {
+      return false;
+    }
+    sections.block_cnt = (size_t)block_footer.block_cnt;
+    sections.block_records = block_footer.block_records;
+    index_size += sections.block_cnt * sizeof(BlockIndexEntry);
+    sections.data_size = available - index_size;
+  }
+  sections.symbol_map = header_size + sections.data_size;
+  sections.time_index = sections.symbol_map + map_size;
+  sections.buckets = sections.time_index + (size_t)fh.symb_cnt * sizeof(TimeIndexEntry);
+  sections.directory = sections.buckets + sections.bucket_cnt * sizeof(uint64_t);
+  sections.price_index = sections.directory + sections.slot_cnt * sizeof(uint32_t);
+  sections.positions = sections.price_index + sections.price_entry_cnt * sizeof(PriceIndexEntry);
+  sections.block_index = HasTimeIndex(fh.version) ? sections.positions + sections.position_cnt * sizeof(uint32_t)
+                                                  : sections.symbol_map + map_size;
+  return sections.symbol_map + map_size + index_size + footer_size == file_size;
+}
+
+
 
 inline RecordType RecordTypeFromString(const std::string type_name) {
   if (type_name == typeid(Security).name()) {
@@ -129,6 +842,14 @@ inline RecordType RecordTypeFromString(const std::string type_name) {
     return RecordType::NbboPrice;
   } else if (type_name == typeid(Trade).name()) {
     return RecordType::Trade;
+  } else if (type_name == typeid(ExchangeBbo).name()) {
+    return RecordType::ExchangeBbo;
+  } else if (type_name == typeid(TradeNbbo).name()) {
+    return RecordType::TradeNbbo;
+  } else if (type_name == typeid(Bar).name()) {
+    return RecordType::Bar;
+  } else if (type_name == typeid(DailySummary).name()) {
+    return RecordType::DailySummary;
   } else if (type_name == "master") {
     return RecordType::SecMaster;
   } else if (type_name == "quote") {
@@ -137,27 +858,50 @@ inline RecordType RecordTypeFromString(const std::string type_name) {
     return RecordType::NbboPrice;
   } else if (type_name == "trade") {
     return RecordType::Trade;
+  } else if (type_name == "bbo") {
+    return RecordType::ExchangeBbo;
+  } else if (type_name == "trade-nbbo") {
+    return RecordType::TradeNbbo;
+  } else if (type_name == "bar") {
+    return RecordType::Bar;
   } else {
     return RecordType::NA;
   }
 }
 
+// quote and trade files of a day are split into partitions, named by the first letter of their symbols or, when
+// listed in a manifest, by the partition number
 inline
-boost::filesystem::path MkDataFilePath(const std::string& data_dir, RecordType type, Date date, char symbol_group = 0) {
+boost::filesystem::path MkDataFilePath(const std::string& data_dir, RecordType type, Date date,
+                                       const std::string& partition = "") {
   std::ostringstream ss;
   boost::filesystem::path file_path(data_dir);
   const std::string yyyymmdd = boost::gregorian::to_iso_string(date);
   if (type == RecordType::SecMaster) {
     ss << yyyymmdd << ".sec-master" << ".dat";
   }
+  else if (type == RecordType::DailySummary) {
+    ss << yyyymmdd << ".summary" << ".dat";
+  }
+  else if (type == RecordType::NbboSnapshot) {
+    ss << yyyymmdd << ".snapshot" << ".dat";
+  }
   else if (type == RecordType::Nbbo) {
-    ss << yyyymmdd << ".nbbo." << symbol_group << ".dat";
+    ss << yyyymmdd << ".nbbo." << partition << ".dat";
   }
   else if (type == RecordType::NbboPrice) {
-    ss << yyyymmdd << ".nbbo-po." << symbol_group << ".dat";
+    ss << yyyymmdd << ".nbbo-po." << partition << ".dat";
+  }
+  else if (type == RecordType::ExchangeBbo) {
+    ss << yyyymmdd << ".bbo." << partition << ".dat";
   }
-  else if (type == RecordType::Trade) {
-    ss << yyyymmdd << ".trd" << ".dat";
+  else if (type == RecordType::Trade || type == RecordType::TradeNbbo || type == RecordType::Bar) {
+    // whole-day file unless partitioned
+    ss << yyyymmdd << (type == RecordType::Trade ? ".trd" : type == RecordType::TradeNbbo ? ".trd-nbbo" : ".bar");
+    if (partition.size()) {
+      ss << "." << partition;
+    }
+    ss << ".dat";
   }
   file_path /= ss.str();
   if (false == boost::filesystem::exists(file_path) && boost::filesystem::is_regular_file(file_path)) {
@@ -166,6 +910,69 @@ boost::filesystem::path MkDataFilePath(const std::string& data_dir, RecordType t
   return file_path;
 }
 
+inline
+boost::filesystem::path MkDataFilePath(const std::string& data_dir, RecordType type, Date date, char symbol_group) {
+  return MkDataFilePath(data_dir, type, date, symbol_group ? std::string(1, symbol_group) : std::string());
+}
+
+// taq-prep --symbol-group all lists the partitions of a day's files in symbol order, one partition|lowest symbol|
+// highest symbol line each; a symbol belongs to the last partition whose lowest symbol does not sort after it
+struct PartitionEntry {
+  std::string partition;
+  std::string first_symbol;
+  std::string last_symbol;
+};
+
+inline boost::filesystem::path MkManifestPath(const std::string& data_dir, RecordType type, Date date) {
+  boost::filesystem::path file_path(MkDataFilePath(data_dir, type, date, "manifest"));
+  return file_path.replace_extension();
+}
+
+// false if the manifest does not exist
+inline bool ReadPartitionManifest(const boost::filesystem::path& file_path, std::vector<PartitionEntry>& entries) {
+  std::ifstream is(file_path.string());
+  if (false == is.is_open()) {
+    return false;
+  }
+  entries.clear();
+  std::string line;
+  while (std::getline(is, line)) {
+    const size_t first = line.find('|');
+    const size_t last = first == std::string::npos ? first : line.find('|', first + 1);
+    if (last == std::string::npos || line.find('|', last + 1) != std::string::npos || 0 == first) {
+      throw std::domain_error("Invalid partition manifest : " + file_path.string());
+    }
+    PartitionEntry entry{line.substr(0, first), line.substr(first + 1, last - first - 1), line.substr(last + 1)};
+    if (entries.size() && entries.back().last_symbol >= entry.first_symbol) {
+      throw std::domain_error("Partition manifest out of order : " + file_path.string());
+    }
+    entries.push_back(std::move(entry));
+  }
+  return true;
+}
+
+// written next to the partition files once they are complete
+inline void WritePartitionManifest(const boost::filesystem::path& file_path, const std::vector<PartitionEntry>& entries) {
+  boost::filesystem::path tmp_path(file_path);
+  tmp_path += ".tmp";
+  {
+    std::ofstream os(tmp_path.string(), std::ios::out | std::ios::trunc);
+    for (const PartitionEntry& entry : entries) {
+      os << entry.partition << '|' << entry.first_symbol << '|' << entry.last_symbol << '\n';
+    }
+    if (false == os.good()) {
+      throw std::domain_error("Failed to write partition manifest : " + file_path.string());
+    }
+  }
+  boost::filesystem::rename(tmp_path, file_path);
+}
+
+inline const PartitionEntry* FindPartition(const std::vector<PartitionEntry>& entries, std::string_view symbol) {
+  auto found = std::upper_bound(entries.begin(), entries.end(), symbol,
+                                [](std::string_view l, const PartitionEntry& r) { return l < r.first_symbol; });
+  return found == entries.begin() ? nullptr : &*(found - 1);
+}
+
 }
 
 #endif
@@ -2,12 +2,14 @@
 #define TAQ_TIME_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "boost/date_time/local_time_adjustor.hpp"
 #include "boost/date_time/c_local_time_adjustor.hpp"
 
 #include "taq-exception.h"
+#include "taq-parse.h"
 
 namespace Taq {
 
@@ -20,36 +22,67 @@ inline Time ZeroTime() {
   return Time(boost::posix_time::seconds(0));
 }
 
-inline Time MkTaqTime(const std::string & timestamp) {
+inline Time TimeFromNanos(int64_t nanos) {
+  return boost::posix_time::nanoseconds(nanos);
+}
+
+inline int64_t NanosFromTime(const Time& time) {
+  return time.total_nanoseconds();
+}
+
+inline Time MkTaqTime(std::string_view timestamp) {
+  int64_t nanos;
+  if (ParseTaqTime(timestamp, nanos)) {
+    return boost::posix_time::nanoseconds(nanos);
+  }
   try {
-    return  boost::posix_time::hours(                 stoi(timestamp.substr(0,2)) )
-          + boost::posix_time::minutes(               stoi(timestamp.substr(2,2)) )
-          + boost::posix_time::seconds(               stoi(timestamp.substr(4,2)) )
-          + boost::posix_time::nanoseconds(           stoi(timestamp.substr(6,9)) );
+    const std::string ts(timestamp);
+    return  boost::posix_time::hours(                 stoi(ts.substr(0,2)) )
+          + boost::posix_time::minutes(               stoi(ts.substr(2,2)) )
+          + boost::posix_time::seconds(               stoi(ts.substr(4,2)) )
+          + boost::posix_time::nanoseconds(           stoi(ts.substr(6,9)) );
   } catch (...) {
     throw Exception(ErrorType::InvalidTimestamp);
   }
 }
 
-inline Date MkTaqDate(const std::string & yyyymmdd) {
+// TAQ time HHMMSSnnnnnnnnn -> nanoseconds since midnight
+inline int64_t MkTaqNanos(std::string_view timestamp) {
+  int64_t nanos;
+  return ParseTaqTime(timestamp, nanos) ? nanos : NanosFromTime(MkTaqTime(timestamp));
+}
+
+inline Date MkTaqDate(std::string_view yyyymmdd) {
   try {
-    return  boost::gregorian::from_undelimited_string(yyyymmdd);
+    int year, month, day;
+    if (ParseTaqDate(yyyymmdd, year, month, day)) {
+      return Date(year, month, day);
+    }
+    return  boost::gregorian::from_undelimited_string(std::string(yyyymmdd));
   } catch (...) {
     throw Exception(ErrorType::InvalidDate);
   }
 }
 
-inline Time MkTime(const std::string& time) {
+inline Time MkTime(std::string_view time) {
+  int64_t nanos;
+  if (ParseIsoTime(time, nanos)) {
+    return boost::posix_time::nanoseconds(nanos);
+  }
   try {
-    return  boost::posix_time::duration_from_string(time);
+    return  boost::posix_time::duration_from_string(std::string(time));
   } catch (...) {
     throw Exception(ErrorType::InvalidTimestamp);
   }
 }
 
-inline Date MkDate(const std::string& yyyymmdd) {
+inline Date MkDate(std::string_view yyyymmdd) {
   try {
-    return boost::gregorian::from_string(yyyymmdd);
+    int year, month, day;
+    if (ParseIsoDate(yyyymmdd, year, month, day)) {
+      return Date(year, month, day);
+    }
+    return boost::gregorian::from_string(std::string(yyyymmdd));
   } catch (...) {
     throw Exception(ErrorType::InvalidDate);
   }
@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+# Ingest rate of taq-prep in MB/s of input: writes a synthetic day of quotes and trades and times each taq-prep
+# binary given over the same files, e.g. the current build against one built from an older revision. With --read, the
+# quotes are prepared instead as v3, v8 and compressed v8 files by the first taq-prep, and the size of each is reported
+# with the rates of a taq-ctrl scan and of tick-calc Quote requests, both reading from a dropped page cache. With
+# --trades, only the trade prep is timed, over a recorded trade file and the sec master of its day.
+#   bench-taqprep.py [--size-mb 100] [--runs 3] [--threads 1] taq-prep [taq-prep ...]
+#   bench-taqprep.py --trades trades.psv --master master.psv [--runs 3] [--threads 1] taq-prep [taq-prep ...]
+#   bench-taqprep.py --read [--requests 10000] [--taq-ctrl taq-ctrl] [--tick-calc tick-calc] taq-prep
+import argparse
+import glob
+import json
+import os
+import random
+import shutil
+import socket
+import subprocess
+import tempfile
+import time
+
+DATE = "20200803"
+EXCHANGES = "ABCDJKMNPTVXYZ"
+MASTER_HEADER = ("Symbol|Security_Description|CUSIP|Security_Type|SIP_Symbol|Old_Symbol|Test_Symbol_Flag|Listed_Exchange"
+                 "|Tape|Unit_Of_Trade|Round_Lot|NYSE_Industry_Code|Shares_Outstanding|Halt_Delay_Reason"
+                 "|Specialist_Clearing_Agent|Specialist_Clearing_Number|Specialist_Post_Number|Specialist_Panel"
+                 "|TradedOnNYSEMKT|TradedOnNASDAQBX|TradedOnNSX|TradedOnFINRA|TradedOnISE|TradedOnEdgeA|TradedOnEdgeX"
+                 "|TradedOnCHX|TradedOnNYSE|TradedOnArca|TradedOnNasdaq|TradedOnCBOE|TradedOnPSX|TradedOnBATSY|TradedOnBATS"
+                 "|TradedOnIEX|Tick_Pilot_Indicator|Effective_Date\n")
+QUOTE_HEADER = ("Time|Exchange|Symbol|Bid_Price|Bid_Size|Offer_Price|Offer_Size|Quote_Condition|Sequence_Number"
+                "|National_BBO_Ind|FINRA_BBO_Indicator|FINRA_ADF_MPID_Indicator|Quote_Cancel_Correction|Source_Of_Quote"
+                "|Retail_Interest_Indicator|Short_Sale_Restriction_Indicator|LULD_BBO_Indicator"
+                "|SIP_Generated_Message_Identifier|National_BBO_LULD_Indicator|Participant_Timestamp|FINRA_ADF_Timestamp"
+                "|FINRA_ADF_Market_Participant_Quote_Indicator|Security_Status_Indicator\n")
+TRADE_HEADER = ("Time|Exchange|Symbol|Sale_Condition|Trade_Volume|Trade_Price|Trade_Stop_Stock_Indicator"
+                "|Trade_Correction_Indicator|Sequence_Number|Trade_Id|Source_of_Trade|Trade_Reporting_Facility"
+                "|Participant_Timestamp|Trade_Reporting_Facility_TRF_Timestamp|Trade_Through_Exempt_Indicator\n")
+SALE_CONDITIONS = ["@   ", "@  I", "@F  ", "@ TI", "@O X", "@6 X", "@  L", "@4  ", "R   ", "@ Z ", "@5  ", "@ 7 "]
+
+def TaqTime(nanos : int) -> str:
+  return "{:02d}{:02d}{:02d}{:09d}".format(nanos // 3600000000000, nanos // 60000000000 % 60,
+                                           nanos // 1000000000 % 60, nanos % 1000000000)
+
+def Symbols(count : int):
+  return sorted("S{:04d}".format(i) for i in range(count))
+
+def WriteSecmaster(path : str, symbols):
+  base = "{}|Test symbol|CUSIP|A|{}|X|Y|N|A|1|100|100|10000| |    |    |  |  |1|1|1|1|1|1|1|1|1|1|1|1|1|1|1|1| |\n"
+  with open(path, "w") as f:
+    f.write(MASTER_HEADER)
+    for symbol in symbols:
+      f.write(base.format(symbol, symbol))
+    f.write("END|{}|{}\n".format(DATE, len(symbols)))
+
+def WriteQuotes(path : str, symbols, size_mb : int):
+  row = "{}|{}|{}|{:.2f}|{}|{:.2f}|{}|R|{}|2| | | |C| | | | | |{}| | | \n"
+  per_symbol = size_mb * 1024 * 1024 // (len(symbols) * len(row.format(TaqTime(0), "N", "S0000", 10, 1, 10, 1, 1, "")))
+  seq = 0
+  with open(path, "w") as f:
+    f.write(QUOTE_HEADER)
+    for symbol in symbols:
+      mid = random.uniform(10, 500)
+      for nanos in sorted(random.randint(4 * 3600 * 10**9, 20 * 3600 * 10**9) for _ in range(per_symbol)):
+        seq += 1
+        mid += random.choice([-0.01, 0, 0, 0.01])
+        ts = TaqTime(nanos)
+        f.write(row.format(ts, random.choice(EXCHANGES), symbol, mid - random.choice([0.01, 0.02]), random.randint(1, 9),
+                           mid + random.choice([0.01, 0.02]), random.randint(1, 9), seq, ts))
+    f.write("END|{}|{}\n".format(DATE, seq))
+
+def WriteTrades(path : str, symbols, size_mb : int):
+  row = "{}|{}|{}|{}|{}|{:.4f}| |{}|{}|{}|C||{}||0\n"
+  per_symbol = size_mb * 1024 * 1024 // (len(symbols) * len(row.format(TaqTime(0), "N", "S0000", "@   ", 100, 10, "00", 1, 1, "")))
+  seq = 0
+  with open(path, "w") as f:
+    f.write(TRADE_HEADER)
+    for symbol in symbols:
+      price = random.uniform(10, 500)
+      for nanos in sorted(random.randint(4 * 3600 * 10**9, 20 * 3600 * 10**9) for _ in range(per_symbol)):
+        seq += 1
+        price += random.choice([-0.01, 0, 0.01])
+        ts = TaqTime(nanos)
+        f.write(row.format(ts, random.choice(EXCHANGES), symbol, random.choice(SALE_CONDITIONS),
+                           random.choice([1, 10, 100, 250]), price, random.choice(["00", "00", "01"]), seq, seq, ts))
+    f.write("END|{}|{}\n".format(DATE, seq))
+
+def BestTime(cmd : str, runs : int) -> float:
+  best = None
+  for _ in range(runs):
+    start = time.perf_counter()
+    subprocess.run(cmd, shell=True, check=True, stdout=subprocess.DEVNULL)
+    elapsed = time.perf_counter() - start
+    best = elapsed if best is None else min(best, elapsed)
+  return best
+
+# quote file layouts of --read, the first the uncompressed format the others are compared with
+READ_FORMATS = [("v3", "--file-version 3"), ("v8", "--file-version 8"), ("v8 compressed", "--file-version 8 --compress")]
+
+def DropPageCache() -> bool:
+  os.sync()
+  try:
+    with open("/proc/sys/vm/drop_caches", "w") as f:
+      f.write("3\n")
+    return True
+  except OSError:
+    return False
+
+def StartTickCalc(tick_calc : str, data_dir : str, port : int):
+  proc = subprocess.Popen([tick_calc, "-d", data_dir, "-l", data_dir, "-t", str(port)], stdout=subprocess.DEVNULL)
+  for _ in range(100):
+    try:
+      socket.create_connection(("127.0.0.1", port)).close()
+      return proc
+    except OSError:
+      time.sleep(0.1)
+  proc.kill()
+  raise Exception("tick-calc did not accept connections on port {}".format(port))
+
+def QuoteRequests(port : int, requests) -> int:
+  hdr = {"request_id": "bench-taqprep", "function_list": ["Quote"], "argument_list": ["Symbol", "Timestamp"],
+         "separator": "|", "input_sorted": False, "input_cnt": len(requests), "output_format": "psv",
+         "time_zone": "America/New_York"}
+  with socket.create_connection(("127.0.0.1", port)) as sock:
+    sock.sendall((json.dumps(hdr) + "\n" + "".join("{}|{}\n".format(*r) for r in requests)).encode())
+    reply = b"".join(iter(lambda: sock.recv(1 << 20), b""))
+  return reply.count(b"\n") - 1
+
+def ReadRates(args, work_dir : str, master : str, quotes : str, symbols):
+  taq_prep = args.taq_prep[0]
+  day = "{}-{}-{}T".format(DATE[:4], DATE[4:6], DATE[6:])
+  requests = [(random.choice(symbols), day + "{:02d}:{:02d}:{:02d}".format(random.randint(4, 19), random.randint(0, 59),
+                                                                            random.randint(0, 59)))
+              for _ in range(args.requests)]
+  # the scan rate is in MB of the quote psv, so that formats of different sizes compare by the records they read
+  psv_mb = os.path.getsize(quotes) / (1024 * 1024)
+  cold = True
+  print("{:16} {:>10} {:>10} {:>12}".format("quote file", "MB", "scan MB/s", "Quote req/s"))
+  print("{:16} {:>10.1f}".format("psv", psv_mb))
+  for name, options in READ_FORMATS:
+    out_dir = os.path.join(work_dir, "out")
+    os.makedirs(out_dir, exist_ok=True)
+    prep = "{} -d {} -o {} {}".format(taq_prep, DATE, out_dir, options)
+    subprocess.run("{} -t master -i {}".format(prep, master), shell=True, check=True, stdout=subprocess.DEVNULL)
+    subprocess.run("{} -t quote -s S -i {}".format(prep, quotes), shell=True, check=True, stdout=subprocess.DEVNULL)
+    files = glob.glob(os.path.join(out_dir, "{}.nbbo*.dat".format(DATE)))
+    size_mb = sum(os.path.getsize(path) for path in files) / (1024 * 1024)
+    cold = DropPageCache() and cold
+    start = time.perf_counter()
+    for path in files:
+      subprocess.run([args.taq_ctrl, "-f", path, "--no-header"], check=True, stdout=subprocess.DEVNULL)
+    scan_rate = psv_mb / (time.perf_counter() - start)
+    tick_calc = StartTickCalc(args.tick_calc, out_dir, args.port)
+    try:
+      cold = DropPageCache() and cold
+      start = time.perf_counter()
+      answered = QuoteRequests(args.port, requests)
+      request_rate = len(requests) / (time.perf_counter() - start)
+    finally:
+      tick_calc.terminate()
+      tick_calc.wait()
+    if answered != len(requests):
+      raise Exception("tick-calc answered {} of {} Quote requests".format(answered, len(requests)))
+    print("{:16} {:>10.1f} {:>10.1f} {:>12.0f}".format(name, size_mb, scan_rate, request_rate))
+    shutil.rmtree(out_dir)
+  if False == cold:
+    print("page cache could not be dropped (needs root), the rates above are of a warm cache")
+
+def MasterDate(master : str) -> str:
+  with open(master) as f:
+    trailer = f.readlines()[-1].split("|")
+  if trailer[0] != "END":
+    raise Exception("{} has no END trailer with the date of the sec master".format(master))
+  return trailer[1]
+
+def RecordedTradeRates(args, work_dir : str):
+  # a recorded day spans several symbol groups, so every group is written
+  date = MasterDate(args.master)
+  trades_mb = os.path.getsize(args.trades) / (1024 * 1024)
+  print("{:40} {:>12}".format("taq-prep", "trade MB/s"))
+  for taq_prep in args.taq_prep:
+    out_dir = os.path.join(work_dir, "out")
+    os.makedirs(out_dir, exist_ok=True)
+    prep = "{} -d {} -o {}".format(taq_prep, date, out_dir)
+    if args.threads > 1:
+      prep += " -j {}".format(args.threads)
+    subprocess.run("{} -t master -i {}".format(prep, args.master), shell=True, check=True, stdout=subprocess.DEVNULL)
+    elapsed = BestTime("{} -t trade -s all -i {}".format(prep, args.trades), args.runs)
+    print("{:40} {:>12.1f}".format(taq_prep, trades_mb / elapsed))
+    shutil.rmtree(out_dir)
+
+def main():
+  parser = argparse.ArgumentParser(description="taq-prep ingest rate")
+  parser.add_argument("taq_prep", nargs="+", help="taq-prep binaries to compare")
+  parser.add_argument("--size-mb", type=int, default=100, help="size of each of the quote and trade files")
+  parser.add_argument("--symbols", type=int, default=500)
+  parser.add_argument("--runs", type=int, default=3, help="best of this many runs")
+  parser.add_argument("--threads", type=int, default=1)
+  parser.add_argument("--read", action="store_true", help="file size and cold read rates of v3, v8 and compressed v8 quote files")
+  parser.add_argument("--requests", type=int, default=10000, help="Quote requests of --read")
+  parser.add_argument("--taq-ctrl", default="taq-ctrl")
+  parser.add_argument("--tick-calc", default="tick-calc")
+  parser.add_argument("--port", type=int, default=3090, help="tick-calc port of --read")
+  parser.add_argument("--trades", help="recorded trade file to time the trade prep over instead of the synthetic day")
+  parser.add_argument("--master", help="sec master of the day of --trades")
+  args = parser.parse_args()
+  if args.trades and not args.master:
+    parser.error("--trades requires --master")
+  random.seed(2)
+  work_dir = tempfile.mkdtemp(prefix="bench-taqprep-")
+  try:
+    if args.trades:
+      RecordedTradeRates(args, work_dir)
+      return
+    symbols = Symbols(args.symbols)
+    master, quotes, trades = [os.path.join(work_dir, name) for name in ("master.psv", "quotes.psv", "trades.psv")]
+    WriteSecmaster(master, symbols)
+    WriteQuotes(quotes, symbols, args.size_mb)
+    if args.read:
+      ReadRates(args, work_dir, master, quotes, symbols)
+      return
+    WriteTrades(trades, symbols, args.size_mb)
+    print("{:40} {:>12} {:>12}".format("taq-prep", "quote MB/s", "trade MB/s"))
+    for taq_prep in args.taq_prep:
+      out_dir = os.path.join(work_dir, "out")
+      os.makedirs(out_dir, exist_ok=True)
+      prep = "{} -d {} -o {}".format(taq_prep, DATE, out_dir)
+      if args.threads > 1:
+        prep += " -j {}".format(args.threads)
+      subprocess.run("{} -t master -i {}".format(prep, master), shell=True, check=True, stdout=subprocess.DEVNULL)
+      rates = []
+      for in_type, path in (("quote", quotes), ("trade", trades)):
+        elapsed = BestTime("{} -t {} -s S -i {}".format(prep, in_type, path), args.runs)
+        rates.append(os.path.getsize(path) / (1024 * 1024) / elapsed)
+      print("{:40} {:>12.1f} {:>12.1f}".format(taq_prep, rates[0], rates[1]))
+      shutil.rmtree(out_dir)
+  finally:
+    shutil.rmtree(work_dir)
+
+if __name__ == "__main__":
+  main()
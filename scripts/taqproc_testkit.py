@@ -11,6 +11,7 @@ from datetime import date
 
 symbols = []
 quotes = {}
+trades = {}
 requests = {}
 results = {}
 
@@ -76,24 +77,87 @@ def AddQuote(symbol : str, timestamp, bid : float, offer: float, **kwargs):
   symb_grp = symbol[:1]
   if not symb_grp in quotes:
     quotes[symb_grp] = []
-  quotes[symb_grp].append((ts.time(), rec))
+  quotes[symb_grp].append((symbol, ts.time(), rec))
 
-def MakeSymbolQuotes(yyyymmdd : str, symb_grp : str, quote_list):
+def MakeSymbolQuotes(yyyymmdd : str, symb_grp : str, quote_list, options = "", in_type = "quote"):
   data = "\n".join(quote_list)
   tmp = tempfile.NamedTemporaryFile(mode='w')
   tmp.write(data)
   tmp.flush()
-  cmd = "taq-prep -t quote -d {} -s {} -i {} ".format(yyyymmdd, symb_grp, tmp.name)
+  cmd = "taq-prep -t {} -d {} -s {} -i {} {}".format(in_type, yyyymmdd, symb_grp, tmp.name, options)
   proc = subprocess.run(cmd,shell=True, capture_output=True)
   tmp.close()
+  return proc.returncode
 
-def MakeQuotes(yyyymmdd : str):
+def MakeQuotes(yyyymmdd : str, options = "", ordered = True, in_type = "quote"):
+  # quotes of a group are ordered by symbol, then time, unless ordered is False, which keeps the order they were added
+  # in; options are passed on to taq-prep, which builds the quote products listed in in_type, e.g. quote,bbo; returns
+  # the highest exit code of the taq-prep runs
   global quotes
+  retval = 0
   for k, v in quotes.items():
-    v.sort()
-    symb_quotes = [ x[1] for x in v ]
-    MakeSymbolQuotes(yyyymmdd, k,  symb_quotes)
+    if ordered:
+      v.sort()
+    symb_quotes = [ x[2] for x in v ]
+    retval = max(retval, MakeSymbolQuotes(yyyymmdd, k,  symb_quotes, options, in_type))
   quotes = {}
+  return retval
+
+def SaveQuotes(file_name : str):
+  # the quotes added so far, every group ordered by symbol and time, as a taq-prep input file, e.g. the --quote-files
+  # of trade-nbbo; they stay in place for MakeQuotes
+  global quotes
+  with open(file_name, "w") as f:
+    f.write("\n".join([ x[2] for k in sorted(quotes.keys()) for x in sorted(quotes[k]) ]))
+
+def AddTrade(symbol : str, timestamp, price : float, qty : int, **kwargs):
+  # Time|Exchange|Symbol|Sale_Condition|Trade_Volume|Trade_Price|Trade_Stop_Stock_Indicator
+  # |Trade_Correction_Indicator|Sequence_Number|Trade_Id|Source_of_Trade|Trade_Reporting_Facility
+  # |Participant_Timestamp|Trade_Reporting_Facility_TRF_Timestamp|Trade_Through_Exempt_Indicator
+  global trades
+  taq_time = ToTaqTime(timestamp)
+  ts = datetime.strptime(taq_time, "%H:%M:%S.%f")
+  Time = ts.strftime("%H%M%S%f000")
+  Exchange = "N" if "Exchange" not in kwargs.keys() else kwargs["Exchange"]
+  Sale_Condition = "@   " if "Sale_Condition" not in kwargs.keys() else kwargs["Sale_Condition"]
+  Trade_Correction_Indicator = "00" if "Trade_Correction_Indicator" not in kwargs.keys() else kwargs["Trade_Correction_Indicator"]
+  Source_of_Trade = "C" if "Source_of_Trade" not in kwargs.keys() else kwargs["Source_of_Trade"]
+  symb_grp = symbol[:1]
+  if not symb_grp in trades:
+    trades[symb_grp] = []
+  seq = len(trades[symb_grp]) + 1
+  base = "{}|{}|{}|{}|{}|{}| |{}|{}|{}|{}||{}||0"
+  rec = base.format(Time, Exchange, symbol, Sale_Condition, qty, price, Trade_Correction_Indicator, seq, seq,
+                    Source_of_Trade, Time)
+  trades[symb_grp].append((symbol, ts.time(), seq, rec))
+
+def MakeTrades(yyyymmdd : str, options = "", ordered = True, in_type = "trade"):
+  # trades of a group are ordered by symbol, then time, unless ordered is False; trades of equal time keep the order
+  # they were added in; options are passed on to taq-prep, which builds the trade product in_type, e.g. trade-nbbo
+  global trades
+  for k, v in trades.items():
+    if ordered:
+      v.sort()
+    data = "\n".join([ x[3] for x in v ])
+    tmp = tempfile.NamedTemporaryFile(mode='w')
+    tmp.write(data)
+    tmp.flush()
+    cmd = "taq-prep -t {} -d {} -s {} -i {} {}".format(in_type, yyyymmdd, k, tmp.name, options)
+    proc = subprocess.run(cmd,shell=True, capture_output=True)
+    tmp.close()
+  trades = {}
+
+def FileRecords(file_name : str, symbol_list):
+  # records of the symbols in a quote or trade file as taq-ctrl shows them, one line each
+  cmd = "taq-ctrl -f {} --no-header -s {}".format(file_name, ",".join(symbol_list))
+  proc = subprocess.run(cmd, shell=True, capture_output=True, check=True)
+  return proc.stdout.decode().splitlines()
+
+def TradeRecords(yyyymmdd : str, symb_grp : str, symbol_list):
+  # trade records of the symbols as taq-ctrl shows them
+  fields = ["Symbol", "Time", "Price", "Qty", "Exchange", "TRF", "LTE", "VE", "ISO"]
+  lines = FileRecords("{}.trd.{}.dat".format(yyyymmdd, symb_grp), symbol_list)
+  return [ dict(zip(fields, line.split(","))) for line in lines ]
 
 def AddFunctionRequest(**kwargs):
   global requests
@@ -2,7 +2,10 @@
 
 import unittest
 import os, signal
+import random
+import socket
 import subprocess
+import time
 import taqproc_testkit as tk
 import taqpy
 
@@ -17,8 +20,16 @@ class TaqptTest(unittest.TestCase):
     tk.AddSymbol("XLK", Listed_Exchange="P", Tape="B")
     tk.AddSymbol("AMZN", Listed_Exchange="Q", Tape="C")
     tk.MakeSecmaster('20200801')
-    cls.tickcalc = subprocess.Popen("tick-calc -d /home/edaniley/Work/taq-proc/data -v on", shell=True, stdout=subprocess.PIPE)
+    # taq-prep writes to the working directory, so tick-calc serves the same directory; it is started without a
+    # shell so that the pid is tick-calc's own, and requests wait until it accepts connections
+    cls.tickcalc = subprocess.Popen(["tick-calc", "-d", os.getcwd(), "-v", "on"], stdout=subprocess.PIPE)
     print("Started tick-calc  pid:{}".format(cls.tickcalc.pid))
+    for attempt in range(100):
+      try:
+        socket.create_connection(("127.0.0.1", 3090)).close()
+        break
+      except OSError:
+        time.sleep(0.1)
 
   @classmethod
   def tearDownClass(cls):
@@ -27,6 +38,8 @@ class TaqptTest(unittest.TestCase):
     while line:
       print(line.decode()[:-1])
       line = cls.tickcalc.stdout.readline()
+    cls.tickcalc.stdout.close()
+    cls.tickcalc.wait()
 
 
   def test_Quote(self):
@@ -49,6 +62,360 @@ class TaqptTest(unittest.TestCase):
     self.assertEqual(df.loc[0]["BestBidPx"], 2.02)
     self.assertEqual(df.loc[1]["BestBidPx"], 1.01)
 
+  def test_TradeEligibility(self):
+    # recorded sample: last trade (LTE) and volume (VE) eligibility as the taq-prep of the original string-based
+    # condition lookup wrote them; the rules of codes that depend on earlier trades of the symbol are
+    #   '1' CTA O: first eligible trade of the exchange          '2' CTA P, Z, 4: first eligible trade
+    #   '3' CTA L: not after a trade from another exchange, nor when the source of the trade is the primary exchange
+    #   '4' UTP G, P, Z, 4: first eligible trade                  '5' UTP L: before 16:01:30
+    # and correction indicators from 02 on make a trade neither
+    # (symbol, time, exchange, sale condition, correction indicator, source, LTE, VE)
+    sample = [
+      ("AMZN", "09:30:00.000001", "Q", "@  G", "00", "N", "Y", "Y"),
+      ("AMZN", "09:30:01.000001", "Q", "@ P ", "00", "N", "N", "Y"),
+      ("AMZN", "09:30:02.000001", "Q", "@   ", "00", "N", "Y", "Y"),
+      ("AMZN", "09:30:03.000001", "D", "@ & ", "00", "N", "Y", "Y"),
+      ("AMZN", "16:01:29.999999", "Q", "@ L ", "00", "N", "Y", "Y"),
+      ("AMZN", "16:01:30.000000", "Q", "@ L ", "00", "N", "N", "Y"),
+      ("AMZN", "16:02:00.000001", "Q", "@  4", "00", "N", "N", "Y"),
+      ("AMZN", "16:03:00.000001", "Q", "@  1", "00", "N", "Y", "Y"),
+      ("AMZN", "16:04:00.000001", "Q", "@  Z", "00", "N", "N", "Y"),
+      ("AMZN", "16:05:00.000001", "Q", "@ E ", "00", "N", "N", "N"),
+      ("AMZN", "16:06:00.000001", "Q", "@   ", "10", "N", "N", "N"),
+      ("AMZN", "16:07:00.000001", "Q", "@   ", "12", "N", "N", "N"),
+      ("BAC",  "09:30:00.000001", "D", "@ Z ", "00", "C", "Y", "Y"),
+      ("BAC",  "09:30:01.000001", "D", "@ L ", "00", "C", "Y", "Y"),
+      ("BAC",  "09:30:02.000001", "D", "@ L ", "00", "N", "N", "Y"),
+      ("BAC",  "09:30:03.000001", "T", "@ L ", "00", "C", "N", "Y"),
+      ("BAC",  "09:30:04.000001", "D", "@  4", "00", "C", "N", "Y"),
+      ("TEST", "09:29:00.000001", "N", "@O  ", "00", "C", "Y", "Y"),
+      ("TEST", "09:29:01.000001", "N", "@O  ", "00", "C", "N", "Y"),
+      ("TEST", "09:29:02.000001", "P", "@O  ", "00", "C", "Y", "Y"),
+      ("TEST", "09:30:00.000001", "N", "@P  ", "00", "C", "N", "Y"),
+      ("TEST", "09:30:01.000001", "N", "@   ", "00", "C", "Y", "Y"),
+      ("TEST", "09:30:02.000001", "N", "@ L ", "00", "C", "Y", "Y"),
+      ("TEST", "09:30:03.000001", "P", "@ L ", "00", "C", "N", "Y"),
+      ("TEST", "09:30:04.000001", "N", "@  4", "00", "C", "N", "Y"),
+      ("TEST", "09:30:05.000001", "N", "@   ", "01", "C", "Y", "Y"),
+      ("TEST", "09:30:06.000001", "N", "@   ", "07", "C", "N", "N"),
+      ("TEST", "09:30:07.000001", "N", "@   ", "08", "C", "N", "N"),
+      ("TEST", "09:30:08.000001", "N", "@  5", "00", "C", "Y", "Y"),
+      ("TEST", "09:30:09.000001", "N", "M   ", "00", "C", "N", "N"),
+      ("TEST", "09:30:10.000001", "N", "@ 9 ", "00", "C", "Y", "N"),
+      ("TEST", "09:30:11.000001", "N", "@ Q ", "00", "C", "N", "N"),
+      ("TEST", "09:30:12.000001", "N", "@O  ", "01", "C", "N", "Y"),
+      ("TEST", "16:05:00.000001", "Z", "@O 6", "00", "C", "Y", "Y"),
+    ]
+    for symbol, timestamp, exchange, cond, correction, source, lte, ve in sample:
+      tk.AddTrade(symbol, timestamp, 10.0, 100, Exchange=exchange, Sale_Condition=cond,
+                  Trade_Correction_Indicator=correction, Source_of_Trade=source)
+    tk.MakeTrades('20200801')
+
+    records = []
+    for symb_grp, symbol in (("A", "AMZN"), ("B", "BAC"), ("T", "TEST")):
+      records += tk.TradeRecords('20200801', symb_grp, [symbol])
+    self.assertEqual(len(records), len(sample))
+    for record, expected in zip(records, sample):
+      symbol, timestamp, exchange, cond = expected[:4]
+      self.assertEqual((record["Symbol"], record["Exchange"]), (symbol, exchange))
+      self.assertEqual((record["LTE"], record["VE"]), expected[6:], "{} {} '{}'".format(symbol, timestamp, cond))
+
+  def test_SortedInput(self):
+    # --sort with a 1 MB budget spills 3 MB of shuffled quotes or trades to several sorted runs, more than the budget
+    # has merge buffers for, and merges them in several passes; the files must be the ones the same input gives when
+    # it is already ordered by symbol and time
+    tk.AddSymbol("XLE", Listed_Exchange="P", Tape="B")
+    tk.AddSymbol("XLF", Listed_Exchange="P", Tape="B")
+    tk.AddSymbol("XLK", Listed_Exchange="P", Tape="B")
+    tk.MakeSecmaster('20200802')
+    rng = random.Random(11)
+    quotes, trades = [], []
+    for symbol in ("XLE", "XLF", "XLK"):
+      # unique times, so the order of equal keys does not depend on the input order
+      for micros in rng.sample(range(9 * 3600 * 10**6, 16 * 3600 * 10**6), 15000):
+        timestamp = "{:02d}:{:02d}:{:02d}.{:06d}".format(micros // 3600000000, micros // 60000000 % 60,
+                                                         micros // 1000000 % 60, micros % 1000000)
+        bid = round(rng.uniform(10, 11), 2)
+        quotes.append((symbol, timestamp, bid, bid + 0.01, rng.choice("NPTZ")))
+        trades.append((symbol, timestamp, bid, rng.randint(1, 10) * 100, rng.choice("NPTZ")))
+
+    def MakeFiles(options, ordered):
+      for symbol, timestamp, bid, offer, exchange in quotes:
+        tk.AddQuote(symbol, timestamp, bid, offer, Exchange=exchange)
+      tk.MakeQuotes('20200802', options, ordered)
+      for symbol, timestamp, price, qty, exchange in trades:
+        tk.AddTrade(symbol, timestamp, price, qty, Exchange=exchange)
+      tk.MakeTrades('20200802', options, ordered)
+      files = {}
+      for name in ("20200802.nbbo.X.dat", "20200802.trd.X.dat", "20200802.summary.dat"):
+        with open(name, "rb") as f:
+          files[name] = f.read()
+      return files
+
+    ordered_files = MakeFiles("", True)
+    rng.shuffle(quotes)
+    rng.shuffle(trades)
+    sorted_files = MakeFiles("--sort --sort-memory 1", False)
+    for name, data in ordered_files.items():
+      self.assertEqual(sorted_files[name], data, name)
+
+  def test_CompressedFiles(self):
+    # the same quotes and trades prepared with and without --compress on two dates: taq-ctrl must show the same records,
+    # and Quote the same NBBO at times spread over several blocks of 4096 records, at quote times and between them
+    rng = random.Random(15)
+    quotes, trades = [], []
+    for symbol in ("CAT", "CSCO"):
+      for micros in sorted(rng.sample(range(9 * 3600 * 10**6, 16 * 3600 * 10**6), 10000)):
+        timestamp = "{:02d}:{:02d}:{:02d}.{:06d}".format(micros // 3600000000, micros // 60000000 % 60,
+                                                         micros // 1000000 % 60, micros % 1000000)
+        bid = round(rng.uniform(10, 11), 2)
+        quotes.append((symbol, timestamp, bid, bid + 0.01, rng.choice("NPTZ")))
+        trades.append((symbol, timestamp, bid, rng.randint(1, 10) * 100, rng.choice("NPTZ")))
+    request_times = [ timestamp for symbol, timestamp, bid, offer, exchange in rng.sample(quotes, 100) ]
+    request_times += [ "{:02d}:{:02d}:00.000000".format(hour, minute) for hour in range(9, 16) for minute in range(0, 60, 7) ]
+
+    def MakeFiles(yyyymmdd, options):
+      tk.AddSymbol("CAT")
+      tk.AddSymbol("CSCO")
+      tk.MakeSecmaster(yyyymmdd)
+      for symbol, timestamp, bid, offer, exchange in quotes:
+        tk.AddQuote(symbol, timestamp, bid, offer, Exchange=exchange)
+      tk.MakeQuotes(yyyymmdd, options)
+      for symbol, timestamp, price, qty, exchange in trades:
+        tk.AddTrade(symbol, timestamp, price, qty, Exchange=exchange)
+      tk.MakeTrades(yyyymmdd, options)
+      records = {}
+      for product in ("nbbo", "trd"):
+        records[product] = tk.FileRecords("{}.{}.C.dat".format(yyyymmdd, product), ["CAT", "CSCO"])
+      for symbol in ("CAT", "CSCO"):
+        for timestamp in request_times:
+          day = "{}-{}-{}T".format(yyyymmdd[:4], yyyymmdd[4:6], yyyymmdd[6:])
+          tk.AddRequest(function_name="Quote", Symbol=symbol, Timestamp=day + timestamp)
+      results = tk.ExecuteRequests(yyyymmdd)
+      return records, results["Quote"][1]
+
+    plain_records, plain_quotes = MakeFiles('20200803', "")
+    compressed_records, compressed_quotes = MakeFiles('20200804', "--compress")
+    self.assertLess(os.path.getsize("20200804.nbbo.C.dat"), os.path.getsize("20200803.nbbo.C.dat"))
+    self.assertLess(os.path.getsize("20200804.trd.C.dat"), os.path.getsize("20200803.trd.C.dat"))
+    self.assertEqual(len(plain_records["trd"]), 20000)
+    for symbol in ("CAT", "CSCO"):
+      self.assertGreater(len([ line for line in plain_records["nbbo"] if line.startswith("symbol:" + symbol + " ") ]),
+                         4096)
+    for product in ("nbbo", "trd"):
+      self.assertEqual(compressed_records[product], plain_records[product], product)
+    self.assertEqual(len(plain_quotes), 2 * len(request_times))
+    for column in plain_quotes.columns:
+      self.assertEqual(list(compressed_quotes[column]), list(plain_quotes[column]), column)
+
+  def test_VenueNbbo(self):
+    # three exchanges each set the best of one side in turn; VenueNbbo over every exchange must match Quote, and leaving
+    # out an exchange or listing the ones to keep must give the NBBO of the rest as of its last change
+    tk.AddSymbol("IBM")
+    tk.MakeSecmaster('20200805')
+    tk.AddQuote("IBM", '09:30:00.000001', 10.00, 10.05, Exchange="N", Bid_Size=1, Offer_Size=2)
+    tk.AddQuote("IBM", '09:30:01.000001', 10.01, 10.04, Exchange="P", Bid_Size=3, Offer_Size=4)
+    tk.AddQuote("IBM", '09:30:02.000001', 10.02, 10.06, Exchange="T", Bid_Size=5, Offer_Size=6)
+    tk.MakeQuotes('20200805', in_type="quote,bbo")
+
+    timestamp = "2020-08-05T09:30:03.000000"
+    venues = [ "-", "-T", "-P", "N", "np", "-NPT" ]
+    for exchanges in venues:
+      tk.AddRequest(function_name="VenueNbbo", Symbol="IBM", Timestamp=timestamp, Exchanges=exchanges)
+    tk.AddRequest(function_name="VenueNbbo", Symbol="IBM", Timestamp="2020-08-05T09:29:00.000000", Exchanges="-")
+    tk.AddRequest(function_name="Quote", Symbol="IBM", Timestamp=timestamp)
+    results = tk.ExecuteRequests("20200805")
+
+    df = results["VenueNbbo"][1]
+    rows = { df.loc[i]["ID"] : df.loc[i] for i in range(len(df)) }
+    # -NPT leaves no exchange that quoted and the request before the first quote has no NBBO yet
+    self.assertEqual(sorted(rows.keys()), [1, 2, 3, 4, 5])
+    expected = {
+      1 : ("09:30:02.000001000", 10.02, 500, 10.04, 400),
+      2 : ("09:30:01.000001000", 10.01, 300, 10.04, 400),
+      3 : ("09:30:02.000001000", 10.02, 500, 10.05, 200),
+      4 : ("09:30:00.000001000", 10.00, 100, 10.05, 200),
+      5 : ("09:30:01.000001000", 10.01, 300, 10.04, 400),
+    }
+    for id, (quote_time, bidp, bids, askp, asks) in expected.items():
+      row = rows[id]
+      self.assertEqual(row["Timestamp"], quote_time.encode(), venues[id - 1])
+      self.assertEqual((row["BestBidPx"], row["BestBidQty"], row["BestOfferPx"], row["BestOfferQty"]),
+                       (bidp, bids, askp, asks), venues[id - 1])
+    quote = results["Quote"][1].loc[0]
+    self.assertEqual((quote["BestBidPx"], quote["BestOfferPx"]), (rows[1]["BestBidPx"], rows[1]["BestOfferPx"]))
+
+  def test_TradeSign(self):
+    # trades at the midpoint take the side of the last price change, so a window that starts at one must seed the
+    # tick test from the trades before it: every window must sign its trades as the day-wide window does
+    tk.AddSymbol("GE")
+    tk.MakeSecmaster('20200806')
+    tk.AddQuote("GE", '09:30:00.000001', 10.00, 10.10)
+    tk.SaveQuotes("20200806.quotes.psv")
+    tk.MakeQuotes('20200806')
+    prices = [ 10.05, 10.04, 10.05, 10.05, 10.05, 10.08, 10.05 ]
+    for minute, price in enumerate(prices):
+      tk.AddTrade("GE", '09:{:02d}:00.000001'.format(31 + minute), price, 100)
+    tk.MakeTrades('20200806', "--quote-files 20200806.quotes.psv", in_type="trade-nbbo")
+
+    windows = [ ("09:00:00", "10:00:00") ] + [ ("09:{:02d}:00".format(31 + minute), "09:{:02d}:30".format(31 + minute))
+                                               for minute in range(len(prices)) ] + [ ("09:34:00", "09:36:30") ]
+    for start_time, end_time in windows:
+      tk.AddRequest(function_name="TradeSign", Symbol="GE", Date="2020-08-06", StartTime=start_time, EndTime=end_time)
+    results = tk.ExecuteRequests("20200806")
+
+    df = results["TradeSign"][1]
+    rows = {}
+    for i in range(len(df)):
+      row = df.loc[i]
+      rows.setdefault(row["ID"], []).append((row["Timestamp"], row["Side"], row["EffectiveSpread"]))
+    day = rows[1]
+    self.assertEqual([ side for timestamp, side, spread in day ], [ b"", b"S", b"B", b"B", b"B", b"B", b"S" ])
+    self.assertEqual(round(day[1][2], 4), 0.02)
+    self.assertEqual(round(day[5][2], 4), 0.06)
+    for minute in range(len(prices)):
+      self.assertEqual(rows[2 + minute], day[minute:minute + 1], windows[1 + minute])
+    self.assertEqual(rows[2 + len(prices)], day[3:6])
+
+  def test_Bars(self):
+    # 1-second bars folded into intervals of the requested length from the start time: an interval takes the open of
+    # its first bar, the close and midpoint of its last, the extremes and sums of all, and intervals without trades
+    # have no row; the end time cuts the last interval short
+    tk.AddSymbol("KO")
+    tk.MakeSecmaster('20200807')
+    tk.AddQuote("KO", '09:29:00.000001', 10.00, 10.10)
+    tk.SaveQuotes("20200807.quotes.psv")
+    tk.MakeQuotes('20200807')
+    trades = [ ('09:30:00.500000', 10.00, 100), ('09:30:01.200000', 10.05, 200), ('09:30:01.700000', 9.95, 300),
+               ('09:30:04.100000', 10.02, 100), ('09:30:12.000000', 10.10, 100) ]
+    for timestamp, price, qty in trades:
+      tk.AddTrade("KO", timestamp, price, qty)
+    tk.MakeTrades('20200807', "--quote-files 20200807.quotes.psv", in_type="bar")
+
+    requests = [ ("09:30:00", "09:30:15", 1), ("09:30:00", "09:30:15", 5), ("09:30:01", "09:30:15", 2),
+                 ("09:30:00", "09:30:02", 5) ]
+    for start_time, end_time, interval in requests:
+      tk.AddRequest(function_name="Bars", Symbol="KO", Date="2020-08-07", StartTime=start_time, EndTime=end_time,
+                    Interval=interval)
+    results = tk.ExecuteRequests("20200807")
+
+    df = results["Bars"][1]
+    fields = ("Timestamp", "OpenPx", "HighPx", "LowPx", "ClosePx", "Volume", "VeVolume", "TradeCount")
+    rows = {}
+    for i in range(len(df)):
+      rows.setdefault(df.loc[i]["ID"], []).append(tuple(df.loc[i][field] for field in fields))
+      self.assertEqual(df.loc[i]["MidPx"], 10.05)
+    self.assertEqual(rows[1], [
+      (b"09:30:00", 10.00, 10.00, 10.00, 10.00, 100, 100, 1),
+      (b"09:30:01", 10.05, 10.05, 9.95, 9.95, 500, 500, 2),
+      (b"09:30:04", 10.02, 10.02, 10.02, 10.02, 100, 100, 1),
+      (b"09:30:12", 10.10, 10.10, 10.10, 10.10, 100, 100, 1) ])
+    self.assertEqual(rows[2], [
+      (b"09:30:00", 10.00, 10.05, 9.95, 10.02, 700, 700, 4),
+      (b"09:30:10", 10.10, 10.10, 10.10, 10.10, 100, 100, 1) ])
+    self.assertEqual(rows[3], [
+      (b"09:30:01", 10.05, 10.05, 9.95, 9.95, 500, 500, 2),
+      (b"09:30:03", 10.02, 10.02, 10.02, 10.02, 100, 100, 1),
+      (b"09:30:11", 10.10, 10.10, 10.10, 10.10, 100, 100, 1) ])
+    self.assertEqual(rows[4], [ (b"09:30:00", 10.00, 10.05, 9.95, 9.95, 600, 600, 3) ])
+
+  def test_DailyStats(self):
+    # the quote and trade parts of a day's summary are written by separate taq-prep runs in either order and merge into
+    # one record per symbol; DailyStats adds the days of a range up and skips the days without a summary file, and the
+    # value of two days of a high-priced symbol, each within int64, must not overflow their sum
+    for yyyymmdd, trades_first in (("20200810", False), ("20200811", True)):
+      tk.AddSymbol("DIS")
+      tk.AddSymbol("DPZ")
+      tk.MakeSecmaster(yyyymmdd)
+      day = int(yyyymmdd[-2:]) - 10
+      tk.AddQuote("DIS", '09:30:00.000000', 10.00, 10.02)
+      tk.AddQuote("DIS", '10:00:00.000000', 10.01, 10.02)
+      tk.AddQuote("DIS", '10:00:00.000000', 10.01, 10.02, Exchange="P")
+      tk.AddTrade("DIS", '09:31:00.000001', 10.01 + day, 100)
+      tk.AddTrade("DIS", '11:00:00.000001', 10.03 + day, 300)
+      tk.AddTrade("DIS", '12:00:00.000001', 9.99 + day, 200, Sale_Condition="@ T ")
+      tk.AddTrade("DPZ", '10:00:00.000001', 500000.00, 10000000)
+      if trades_first:
+        tk.MakeTrades(yyyymmdd)
+      tk.MakeQuotes(yyyymmdd)
+      if not trades_first:
+        tk.MakeTrades(yyyymmdd)
+
+    tk.AddRequest(function_name="DailyStats", Symbol="DIS", StartDate="2020-08-08", EndDate="2020-08-11")
+    tk.AddRequest(function_name="DailyStats", Symbol="DIS", StartDate="2020-08-11", EndDate="2020-08-11")
+    tk.AddRequest(function_name="DailyStats", Symbol="DPZ", StartDate="2020-08-10", EndDate="2020-08-11")
+    results = tk.ExecuteRequests("20200810")
+
+    df = results["DailyStats"][1]
+    rows = { df.loc[i]["ID"] : df.loc[i] for i in range(len(df)) }
+    dis = rows[1]
+    self.assertEqual(dis["Days"], 2)
+    self.assertEqual((dis["OpenPx"], dis["HighPx"], dis["LowPx"], dis["ClosePx"]), (10.01, 11.03, 10.01, 11.03))
+    self.assertEqual((dis["Volume"], dis["VeVolume"], dis["AvgVeVolume"]), (1200, 1200, 600))
+    self.assertAlmostEqual(dis["Vwap"], (10.01 * 100 + 10.03 * 300 + 9.99 * 200 + 11.01 * 100 + 11.03 * 300
+                                         + 10.99 * 200) / 1200, 4)
+    self.assertEqual((dis["TradeCount"], dis["QuoteCount"], dis["NbboCount"]), (6, 6, 6))
+    # 30 minutes at two cents and 6 hours at one cent a day; tick-calc prints 6 significant digits
+    self.assertAlmostEqual(dis["AvgSpread"], (0.5 * 0.02 + 6 * 0.01) / 6.5, 7)
+    self.assertAlmostEqual(dis["NbboUpdateRate"], 6 / (2 * 6.5 * 3600), 9)
+    self.assertEqual((rows[2]["Days"], rows[2]["OpenPx"], rows[2]["Volume"]), (1, 11.01, 600))
+    self.assertEqual(rows[3]["Vwap"], 500000.00)
+
+  def test_Snapshot(self):
+    # group A is prepared with a snapshot grid and group M without one, so the snapshot file has no column of MSFT; on
+    # the grid AAPL is read from the file and MSFT from its nbbo file, off the grid both come from the nbbo files
+    tk.AddSymbol("AAPL", Listed_Exchange="Q", Tape="C")
+    tk.AddSymbol("MSFT", Listed_Exchange="Q", Tape="C")
+    tk.MakeSecmaster('20200812')
+    tk.AddQuote("AAPL", '09:59:00.000000', 100.00, 100.02)
+    tk.AddQuote("AAPL", '10:00:30.000000', 100.01, 100.03)
+    tk.MakeQuotes('20200812', "--snapshot-interval 60")
+    tk.AddQuote("MSFT", '09:59:30.000000', 200.00, 200.04)
+    tk.AddQuote("MSFT", '10:00:00.000000', 200.01, 200.04)
+    tk.MakeQuotes('20200812')
+    snapshot = tk.FileRecords("20200812.snapshot.dat", ["AAPL", "MSFT"])
+    self.assertTrue(any(line.startswith("AAPL,10:00:00,") for line in snapshot))
+    self.assertFalse(any(line.startswith("MSFT,") for line in snapshot))
+
+    requests = [ ("AAPL", "10:00:00"), ("MSFT", "10:00:00"), ("AAPL", "10:00:45"), ("MSFT", "09:59:45"),
+                 ("", "10:00:00"), ("", "10:00:45"), ("AAPL", "09:00:00"), ("MSFT", "09:00:00") ]
+    for symbol, timestamp in requests:
+      tk.AddRequest(function_name="Snapshot", Symbol=symbol, Timestamp="2020-08-12T{}.000000".format(timestamp))
+    results = tk.ExecuteRequests("20200812")
+
+    df = results["Snapshot"][1]
+    rows = {}
+    for i in range(len(df)):
+      row = df.loc[i]
+      rows.setdefault(row["ID"], []).append((row["Symbol"], row["Timestamp"], row["BestBidPx"], row["BestOfferPx"]))
+    aapl_at_10 = (b"AAPL", b"09:59:00", 100.00, 100.02)
+    msft_at_10 = (b"MSFT", b"10:00:00", 200.01, 200.04)
+    aapl_after_10 = (b"AAPL", b"10:00:30", 100.01, 100.03)
+    self.assertEqual(rows[1], [ aapl_at_10 ])
+    self.assertEqual(rows[2], [ msft_at_10 ])
+    self.assertEqual(rows[3], [ aapl_after_10 ])
+    self.assertEqual(rows[4], [ (b"MSFT", b"09:59:30", 200.00, 200.04) ])
+    self.assertEqual(sorted(rows[5]), [ aapl_at_10, msft_at_10 ])
+    self.assertEqual(sorted(rows[6]), [ aapl_after_10, msft_at_10 ])
+    # before the first quote, on the grid from the file and from the nbbo file
+    self.assertNotIn(7, rows)
+    self.assertNotIn(8, rows)
+
+    # a later run with the grid writes its own columns in place and keeps the others; one with another grid is refused
+    # and leaves the file as it was
+    tk.AddQuote("MSFT", '09:59:30.000000', 200.00, 200.04)
+    tk.AddQuote("MSFT", '10:00:00.000000', 200.01, 200.04)
+    self.assertEqual(tk.MakeQuotes('20200812', "--snapshot-interval 60"), 0)
+    snapshot = tk.FileRecords("20200812.snapshot.dat", ["AAPL", "MSFT"])
+    self.assertIn("AAPL,10:00:00,09:59:00,100,1,100.02,1", snapshot)
+    self.assertIn("MSFT,10:00:00,10:00:00,200.01,1,200.04,1", snapshot)
+    with open("20200812.snapshot.dat", "rb") as f:
+      snapshot_file = f.read()
+    tk.AddQuote("AAPL", '09:59:00.000000', 100.00, 100.02)
+    self.assertNotEqual(tk.MakeQuotes('20200812', "--snapshot-interval 30"), 0)
+    with open("20200812.snapshot.dat", "rb") as f:
+      self.assertEqual(f.read(), snapshot_file)
+
 
 if __name__ == "__main__":
   unittest.main()
@@ -13,6 +13,7 @@
 #include <boost/interprocess/mapped_region.hpp>
 #include "boost-algorithm-string.h"
 #include "taq-proc.h"
+#include "taq-block.h"
 
 using namespace std;
 using namespace Taq;
@@ -29,7 +30,7 @@ struct separate_thousands : numpunct<char> {
   string_type do_grouping() const override { return "\3"; }
 };
 
-string ToString(int value, int width) {
+string ToString(int64_t value, int width) {
   ostringstream ss;
   ss.imbue(locale(""));
   ss << value;
@@ -39,7 +40,7 @@ string ToString(int value, int width) {
 }
 
 void HandleSecMasterFile(const FileHeader& fh , const mm::mapped_region& mm_region) {
-  if (sizeof(fh) + fh.symb_cnt * sizeof(Security) != mm_region.get_size()) {
+  if (fh.symb_cnt < 0 || FileHeaderSize(fh.version) + (size_t)fh.symb_cnt * sizeof(Security) != mm_region.get_size()) {
     throw domain_error("Input file corruption : " + file_path);
   }
   if (false == no_header) {
@@ -57,8 +58,8 @@ void HandleSecMasterFile(const FileHeader& fh , const mm::mapped_region& mm_regi
       cout << "cta_symb,utp_symb,prim_exch,tape,lot_size" << endl;
     }
   }
-  const Security* symbols = (const Security*)((char*)(mm_region.get_address()) + sizeof(fh));
-  for (auto i = 0; i < fh.symb_cnt; i++) {
+  const Security* symbols = (const Security*)((char*)(mm_region.get_address()) + FileHeaderSize(fh.version));
+  for (int64_t i = 0; i < fh.symb_cnt; i++) {
     const Security& sec = symbols[i];
     if (pretty) {
       string cta_symb(sec.symb); cta_symb.append(12 - cta_symb.size(), ' ');
@@ -73,12 +74,133 @@ void HandleSecMasterFile(const FileHeader& fh , const mm::mapped_region& mm_regi
   }
 }
 
+void ShowSummary(const DailySummary& rec) {
+  const DailySummary::Trades& trd = rec.trades;
+  const DailySummary::Quotes& quo = rec.quotes;
+  const double vwap = trd.ve_volume ? (double)trd.ve_value / trd.ve_volume / PRICE_TICKS_PER_UNIT : .0;
+  const double spread = quo.two_sided_time ? quo.spread_time / quo.two_sided_time / PRICE_TICKS_PER_UNIT : .0;
+  const string parts = string(rec.parts & DailySummary::TRADES ? "T" : "") + (rec.parts & DailySummary::QUOTES ? "Q" : "");
+  if (pretty) {
+    cout << "symbol:" << rec.symb << " parts:" << parts << " trades:" << trd.trade_cnt << " volume:" << trd.volume
+         << " ve_volume:" << trd.ve_volume << " lte_volume:" << trd.lte_volume << " vwap:" << vwap
+         << " open:" << PriceFromTicks(trd.open) << " high:" << PriceFromTicks(trd.high) << " low:"
+         << PriceFromTicks(trd.low) << " close:" << PriceFromTicks(trd.close) << " quotes:" << quo.quote_cnt
+         << " nbbo:" << quo.nbbo_cnt << " session_nbbo:" << quo.session_nbbo_cnt << " spread:" << spread << endl;
+  } else {
+    cout << rec.symb << ',' << parts << ',' << trd.trade_cnt << ',' << trd.volume << ',' << trd.ve_volume << ','
+         << trd.lte_volume << ',' << vwap << ',' << PriceFromTicks(trd.open) << ',' << PriceFromTicks(trd.high) << ','
+         << PriceFromTicks(trd.low) << ',' << PriceFromTicks(trd.close) << ',' << quo.quote_cnt << ',' << quo.nbbo_cnt
+         << ',' << quo.session_nbbo_cnt << ',' << spread << endl;
+  }
+}
+
+void HandleSummaryFile(const FileHeader& fh, const mm::mapped_region& mm_region) {
+  const char* base = (const char*)mm_region.get_address();
+  const size_t file_size = mm_region.get_size();
+  SymbolDirectoryFooter footer{0};
+  if (file_size >= sizeof(footer)) {
+    memcpy(&footer, base + file_size - sizeof(footer), sizeof(footer));
+  }
+  if (fh.symb_cnt < 0 || 0 == footer.slot_cnt || footer.slot_cnt > file_size / sizeof(uint32_t)
+      || SummaryFileSize(fh.version, (size_t)fh.symb_cnt, footer.slot_cnt) != file_size) {
+    throw domain_error("Input file corruption : " + file_path);
+  }
+  if (false == no_header) {
+    auto thousands = make_unique<separate_thousands>();
+    auto saved_locale = cout.imbue(locale(cout.getloc(), thousands.release()));
+    cout << "date file     " << file_path << endl;
+    cout << "file size     " << file_size << endl;
+    cout << "record type   " "DailySummary" << endl;
+    cout << "record size   " << sizeof(DailySummary) << endl;
+    cout << "symbol count  " << fh.symb_cnt << endl << endl;
+    cout.imbue(saved_locale);
+    if (false == pretty) {
+      cout << "symbol,parts,trades,volume,ve_volume,lte_volume,vwap,open,high,low,close,quotes,nbbo,session_nbbo,spread"
+           << endl;
+    }
+  }
+  const DailySummary* records = (const DailySummary*)(base + FileHeaderSize(fh.version));
+  if (query_symbol.size()) {
+    const uint32_t* slots = (const uint32_t*)(base + FileHeaderSize(fh.version) + fh.symb_cnt * sizeof(DailySummary));
+    vector<string> symbol_list;
+    boost::split(symbol_list, query_symbol, boost::is_any_of(","));
+    for (const string& symbol : symbol_list) {
+      const DailySummary* rec = FindSummary(records, (size_t)fh.symb_cnt, slots, footer.slot_cnt, symbol);
+      if (rec) {
+        ShowSummary(*rec);
+      }
+    }
+    return;
+  }
+  for (int64_t i = 0; i < fh.symb_cnt; i++) {
+    if (records[i].parts) {
+      ShowSummary(records[i]);
+    }
+  }
+}
+
+// the column of each security of the sec master, or of the -s symbols, a line per grid time with an NBBO
+void HandleSnapshotFile(const FileHeader& fh, const mm::mapped_region& mm_region) {
+  const char* base = (const char*)mm_region.get_address();
+  const size_t file_size = mm_region.get_size();
+  SnapshotGrid grid;
+  if (file_size >= sizeof(grid)) {
+    memcpy(&grid, base + file_size - sizeof(grid), sizeof(grid));
+  }
+  if (fh.symb_cnt < 0 || grid.interval <= 0 || grid.time_cnt > file_size
+      || SnapshotFileSize(fh.version, (size_t)fh.symb_cnt, grid.time_cnt) != file_size) {
+    throw domain_error("Input file corruption : " + file_path);
+  }
+  if (false == no_header) {
+    auto thousands = make_unique<separate_thousands>();
+    auto saved_locale = cout.imbue(locale(cout.getloc(), thousands.release()));
+    cout << "date file     " << file_path << endl;
+    cout << "file size     " << file_size << endl;
+    cout << "record type   " "NbboSnapshot" << endl;
+    cout << "record size   " << sizeof(Nbbo) << endl;
+    cout << "symbol count  " << fh.symb_cnt << endl;
+    cout << "time count    " << grid.time_cnt << endl;
+    cout.imbue(saved_locale);
+    cout << "times         " << TimeFromNanos(grid.Time(0)) << " to " << TimeFromNanos(grid.Time(grid.time_cnt - 1))
+         << " every " << grid.interval / Bar::NANOS << "s" << endl << endl;
+    if (false == pretty) {
+      cout << "symbol,snapshot_time,time,bid,bid_size,offer,offer_size" << endl;
+    }
+  }
+  const Nbbo* rows = (const Nbbo*)(base + FileHeaderSize(fh.version));
+  const Symbol* symbols = (const Symbol*)(rows + fh.symb_cnt * grid.time_cnt);
+  vector<string> symbol_list;
+  if (query_symbol.size()) {
+    boost::split(symbol_list, query_symbol, boost::is_any_of(","));
+  }
+  for (int64_t i = 0; i < fh.symb_cnt; i++) {
+    const string symbol(symbols[i], strnlen(symbols[i], sizeof(Symbol)));
+    if (symbol_list.size() && find(symbol_list.begin(), symbol_list.end(), symbol) == symbol_list.end()) {
+      continue;
+    }
+    for (size_t t = 0; t < grid.time_cnt; t++) {
+      const Nbbo& rec = rows[t * fh.symb_cnt + i];
+      if (rec.time == SnapshotGrid::NO_NBBO || rec.time == SnapshotGrid::NO_COLUMN) {
+        continue;
+      }
+      if (pretty) {
+        cout << "symbol:" << symbol << " snapshot:" << TimeFromNanos(grid.Time(t)) << " time:" << TimeFromNanos(rec.time)
+             << " bid:[ " << PriceFromTicks(rec.bidp) << " " << rec.bids << " ] offer: [" << PriceFromTicks(rec.askp)
+             << " " << rec.asks << " ]" << endl;
+      } else {
+        cout << symbol << ',' << TimeFromNanos(grid.Time(t)) << ',' << TimeFromNanos(rec.time) << ','
+             << PriceFromTicks(rec.bidp) << ',' << rec.bids << ',' << PriceFromTicks(rec.askp) << ',' << rec.asks << endl;
+      }
+    }
+  }
+}
+
 void ShowRecords(const string & symb, const Nbbo* rec, const Nbbo* end) {
   cout << setprecision(4);
   do {
-    cout << "symbol:" << symb << " time:" << rec->time
-      << " bid:[ " << rec->bidp << " " << rec->bids
-      << " ] offer: [" << rec->askp << " " << rec->asks
+    cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time)
+      << " bid:[ " << PriceFromTicks(rec->bidp) << " " << rec->bids
+      << " ] offer: [" << PriceFromTicks(rec->askp) << " " << rec->asks
       << " ]" << endl;
   } while (++rec < end);
 }
@@ -86,19 +208,30 @@ void ShowRecords(const string & symb, const Nbbo* rec, const Nbbo* end) {
 void ShowRecords(const string& symb, const NbboPrice *rec, const NbboPrice * end) {
   cout << setprecision(4);
   do {
-    cout << "symbol:" << symb << " time:" << rec->time << " bid:" << rec->bidp << " offer:" << rec->askp << endl;
+    cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time) << " bid:" << PriceFromTicks(rec->bidp)
+         << " offer:" << PriceFromTicks(rec->askp) << endl;
+  } while (++rec < end);
+}
+
+void ShowRecords(const string& symb, const ExchangeBbo *rec, const ExchangeBbo * end) {
+  cout << setprecision(4);
+  do {
+    cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time) << " exch:" << rec->exch
+      << " bid:[ " << PriceFromTicks(rec->bidp) << " " << rec->bids
+      << " ] offer: [" << PriceFromTicks(rec->askp) << " " << rec->asks
+      << " ]" << endl;
   } while (++rec < end);
 }
 
 void ShowRecords(const string& symb, const Trade* rec, const Trade* end) {
   do {
     if (pretty) {
-      cout << "symbol:" << symb << " time:" << rec->time << " price:" << rec->price << " qty:" << rec->qty
+      cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time) << " price:" << PriceFromTicks(rec->price) << " qty:" << rec->qty
            << " exch:" << (char)rec->attr.exch << " trf:'" << (char)rec->attr.exch
            << "' lte:" << (rec->attr.lte ? 'Y' : 'N') << " ve:" << (rec->attr.ve ? 'Y' : 'N') 
            << " iso:" << (rec->attr.iso ? 'Y' : 'N')  << endl;
     } else {
-      cout << symb << ',' << rec->time << ',' << rec->price << ',' << rec->qty
+      cout << symb << ',' << TimeFromNanos(rec->time) << ',' << PriceFromTicks(rec->price) << ',' << rec->qty
         << ',' << (char)rec->attr.exch << ',' << (char)rec->attr.exch
         << ',' << (rec->attr.lte ? 'Y' : 'N') << ',' << (rec->attr.ve ? 'Y' : 'N')
         << ',' << (rec->attr.iso ? 'Y' : 'N') << endl;
@@ -107,55 +240,148 @@ void ShowRecords(const string& symb, const Trade* rec, const Trade* end) {
   } while (++rec < end);
 }
 
-void ShowSymbolRecords(const FileHeader& fh, const mm::mapped_region& mm_region, const SymbolMap* symbol_map) {
+void ShowRecords(const string& symb, const TradeNbbo* rec, const TradeNbbo* end) {
+  do {
+    if (pretty) {
+      cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time) << " price:" << PriceFromTicks(rec->price) << " qty:" << rec->qty
+           << " exch:" << (char)rec->attr.exch << " bid:" << PriceFromTicks(rec->bidp) << " offer:" << PriceFromTicks(rec->askp)
+           << " quote time:" << (rec->quote_time < 0 ? string("none") : to_simple_string(TimeFromNanos(rec->quote_time))) << endl;
+    } else {
+      cout << symb << ',' << TimeFromNanos(rec->time) << ',' << PriceFromTicks(rec->price) << ',' << rec->qty
+        << ',' << (char)rec->attr.exch << ',' << PriceFromTicks(rec->bidp) << ',' << PriceFromTicks(rec->askp)
+        << ',' << (rec->quote_time < 0 ? string() : to_simple_string(TimeFromNanos(rec->quote_time))) << endl;
+    }
+  } while (++rec < end);
+}
+
+void ShowRecords(const string& symb, const Bar* rec, const Bar* end) {
+  do {
+    if (pretty) {
+      cout << "symbol:" << symb << " time:" << TimeFromNanos(rec->time) << " open:" << PriceFromTicks(rec->open)
+           << " high:" << PriceFromTicks(rec->high) << " low:" << PriceFromTicks(rec->low)
+           << " close:" << PriceFromTicks(rec->close) << " volume:" << rec->volume << " ve volume:" << rec->ve_volume
+           << " trades:" << rec->trade_cnt << " mid:" << PriceFromTicks(rec->mid) << endl;
+    } else {
+      cout << symb << ',' << TimeFromNanos(rec->time) << ',' << PriceFromTicks(rec->open)
+        << ',' << PriceFromTicks(rec->high) << ',' << PriceFromTicks(rec->low) << ',' << PriceFromTicks(rec->close) << ',' << rec->volume
+        << ',' << rec->ve_volume << ',' << rec->trade_cnt << ',' << PriceFromTicks(rec->mid) << endl;
+    }
+  } while (++rec < end);
+}
+
+FileSections LocateSections(const FileHeader& fh, size_t rec_size, const mm::mapped_region& mm_region) {
+  const char* file = (const char*)mm_region.get_address();
+  const size_t file_size = mm_region.get_size();
+  const size_t footer_size = TrailerFooterSize(fh.version);
+  const char* footer = file_size >= FileHeaderSize(fh.version) + footer_size ? file + file_size - footer_size : nullptr;
+  FileSections sections;
+  if (false == LocateFileSections(fh, rec_size, file_size, footer, sections)
+      || false == ValidateBlockIndex(fh, sections, (const BlockIndexEntry*)(file + sections.block_index))) {
+    throw domain_error("Input file corruption : " + file_path);
+  }
+  return sections;
+}
+
+// the symbol map of the file, converted into wide_map for files before v7
+const SymbolMap* LoadSymbolMap(const FileHeader& fh, const FileSections& sections, const mm::mapped_region& mm_region,
+                               vector<SymbolMap>& wide_map) {
+  const char* map = (const char*)(mm_region.get_address()) + sections.symbol_map;
+  if (HasWideCounts(fh.version)) {
+    return (const SymbolMap*)map;
+  }
+  wide_map.resize((size_t)fh.symb_cnt, SymbolMap("", 0, 0));
+  ReadSymbolMapV1(map, wide_map.size(), wide_map.data());
+  return wide_map.data();
+}
+
+// the blocks of a compressed segment are decompressed one after another
+template <typename T>
+void ShowSegment(const string& symb, const FileHeader& fh, const FileSections& sections, const mm::mapped_region& mm_region,
+                 const SymbolMap& map) {
+  const size_t rec_cnt = map.end - map.start + 1;
+  const char* data = (char*)(mm_region.get_address()) + FileHeaderSize(fh.version);
+  vector<T> records;
+  records.reserve(rec_cnt);
+  if (IsCompressedFileVersion(fh.version)) {
+    const BlockIndexEntry* blocks = (const BlockIndexEntry*)((char*)(mm_region.get_address()) + sections.block_index);
+    const BlockIndexEntry* block = lower_bound(blocks, blocks + sections.block_cnt, map.start,
+      [](const BlockIndexEntry& entry, int64_t record) { return entry.first_record < record; });
+    vector<char> columns;
+    for (; block < blocks + sections.block_cnt && block->first_record <= map.end; block++) {
+      columns.resize(block->record_cnt * RecordWidth<T>(fh.version));
+      DecodeBlock(RecordLayout<T>::fields, std::size(RecordLayout<T>::fields), block->record_cnt, data + block->offset,
+                  block->size, columns.data(), columns.size());
+      for (size_t i = 0; i < block->record_cnt; i++) {
+        records.push_back(GatherRecord<T>(columns.data(), block->record_cnt, i, FILE_VERSION_FIXED_POINT));
+      }
+    }
+  } else {
+    const char* segment = data + (map.start - 1) * RecordWidth<T>(fh.version);
+    for (size_t i = 0; i < rec_cnt; i++) {
+      records.push_back(GatherRecord<T>(segment, rec_cnt, i, fh.version));
+    }
+  }
+  ShowRecords(symb, records.data(), records.data() + records.size());
+}
+
+void ShowSymbolRecords(const FileHeader& fh, const FileSections& sections, const mm::mapped_region& mm_region,
+                       const SymbolMap* symbol_map) {
   vector<string> symbol_list;
   boost::split(symbol_list, query_symbol, boost::is_any_of(","));
   for (const string & symbol: symbol_list) {
     const SymbolMap *symb = nullptr;
-    for (int i = 0; i < fh.symb_cnt; i ++) {
-      if (symbol == string(symbol_map[i].symb)) {
-        symb = symbol_map + i;
-        break;
+    if (HasSymbolDirectory(fh.version)) {
+      const uint32_t* slots = (const uint32_t*)((const char*)(mm_region.get_address()) + sections.directory);
+      symb = FindSymbol(symbol_map, fh.symb_cnt, slots, sections.slot_cnt, symbol);
+    } else {
+      for (int64_t i = 0; i < fh.symb_cnt; i ++) {
+        if (symbol == string(symbol_map[i].symb)) {
+          symb = symbol_map + i;
+          break;
+        }
       }
     }
     if (symb) {
-      const int rec_cnt = symb->end - symb->start + 1;
       if (fh.type == RecordType::Nbbo) {
-        const Nbbo* begin = (const Nbbo*)((char*)(mm_region.get_address()) + sizeof(fh) + (symb->start - 1) * sizeof(Nbbo));
-        const Nbbo* end = begin + rec_cnt;
-        ShowRecords(symbol, begin, end);
+        ShowSegment<Nbbo>(symbol, fh, sections, mm_region, *symb);
       } else if (fh.type == RecordType::NbboPrice) {
-        const NbboPrice* begin = (const NbboPrice*)((char*)(mm_region.get_address()) + sizeof(fh) + (symb->start - 1) * sizeof(NbboPrice));
-        const NbboPrice* end = begin + rec_cnt;
-        ShowRecords(symbol, begin, end);
+        ShowSegment<NbboPrice>(symbol, fh, sections, mm_region, *symb);
+      } else if (fh.type == RecordType::ExchangeBbo) {
+        ShowSegment<ExchangeBbo>(symbol, fh, sections, mm_region, *symb);
       } else if (fh.type == RecordType::Trade) {
-        const Trade* begin = (const Trade*)((char*)(mm_region.get_address()) + sizeof(fh) + (symb->start - 1) * sizeof(Trade));
-        const Trade* end = begin + rec_cnt;
-        ShowRecords(symbol, begin, end);
+        ShowSegment<Trade>(symbol, fh, sections, mm_region, *symb);
+      } else if (fh.type == RecordType::TradeNbbo) {
+        ShowSegment<TradeNbbo>(symbol, fh, sections, mm_region, *symb);
+      } else if (fh.type == RecordType::Bar) {
+        ShowSegment<Bar>(symbol, fh, sections, mm_region, *symb);
       }
     }
   }
 }
 
 void HandleNbboFile(const FileHeader& fh, const mm::mapped_region & mm_region) {
-  const size_t rec_size = fh.type == RecordType::Nbbo ? sizeof(Nbbo) : sizeof(NbboPrice);
-  if ((sizeof(fh) + fh.symb_cnt * sizeof(SymbolMap) + fh.rec_cnt  * rec_size)  != mm_region.get_size()) {
-    throw domain_error("Input file corruption : " + file_path);
-  }
+  const size_t rec_size = RecordWidth(fh.type, fh.version);
+  const FileSections sections = LocateSections(fh, rec_size, mm_region);
   if (false == no_header) {
     auto thousands = make_unique<separate_thousands>();
     auto saved_locale = cout.imbue(locale(cout.getloc(), thousands.release()));
     cout << "date file     " << file_path << endl;
     cout << "file size     " << mm_region.get_size() << endl;
-    cout << "record type   " << (fh.type == RecordType::Nbbo ? "Nbbo (with size)" : "Nbbo (price only)") << endl;
-    cout << "record size   " << (fh.type == RecordType::Nbbo ? sizeof(Nbbo) : sizeof(NbboPrice)) << endl;
-    cout << "symbol count  " << fh.symb_cnt << endl << endl;
+    cout << "record type   " << (fh.type == RecordType::Nbbo ? "Nbbo (with size)"
+                                  : fh.type == RecordType::NbboPrice ? "Nbbo (price only)" : "Exchange BBO") << endl;
+    cout << "record size   " << rec_size << endl;
+    cout << "symbol count  " << fh.symb_cnt << endl;
+    if (sections.price_entry_cnt) {
+      cout << "price changes " << sections.position_cnt << endl;
+    }
+    cout << endl;
     cout.imbue(saved_locale);
   }
-  const SymbolMap* symbol_map = (const SymbolMap*)((char*)(mm_region.get_address()) + sizeof(fh) + fh.rec_cnt * rec_size);
+  vector<SymbolMap> wide_map;
+  const SymbolMap* symbol_map = LoadSymbolMap(fh, sections, mm_region, wide_map);
   if (query_symbol.empty()) {
-    vector<pair<string, int>> symbols;
-    for (int i = 0; i < fh.symb_cnt; i++) {
+    vector<pair<string, int64_t>> symbols;
+    for (int64_t i = 0; i < fh.symb_cnt; i++) {
       const SymbolMap& map = symbol_map[i];
       symbols.push_back(make_pair(map.symb, map.end - map.start + 1));
     }
@@ -171,28 +397,29 @@ void HandleNbboFile(const FileHeader& fh, const mm::mapped_region & mm_region) {
       }
     }
   } else {
-    ShowSymbolRecords(fh, mm_region, symbol_map);
+    ShowSymbolRecords(fh, sections, mm_region, symbol_map);
   }
 }
 
 void HandleTradeFile(const FileHeader& fh, const mm::mapped_region& mm_region) {
-  if ((sizeof(fh) + fh.symb_cnt * sizeof(SymbolMap) + fh.rec_cnt * sizeof(Trade)) != mm_region.get_size()) {
-    throw domain_error("Input file corruption : " + file_path);
-  }
+  const size_t rec_size = RecordWidth(fh.type, fh.version);
+  const FileSections sections = LocateSections(fh, rec_size, mm_region);
   if (false == no_header) {
     auto thousands = make_unique<separate_thousands>();
     auto saved_locale = cout.imbue(locale(cout.getloc(), thousands.release()));
     cout << "date file     " << file_path << endl;
     cout << "file size     " << mm_region.get_size() << endl;
-    cout << "record type   " "Trade" << endl;
-    cout << "record type   " << sizeof(Trade) << endl;
+    cout << "record type   " << (fh.type == RecordType::Trade ? "Trade"
+                                  : fh.type == RecordType::TradeNbbo ? "Trade NBBO" : "1-second bar") << endl;
+    cout << "record size   " << rec_size << endl;
     cout << "symbol count  " << fh.symb_cnt << endl << endl;
     cout.imbue(saved_locale);
   }
-  const SymbolMap* symbol_map = (const SymbolMap*)((char*)(mm_region.get_address()) + sizeof(fh) + fh.rec_cnt * sizeof(Trade));
+  vector<SymbolMap> wide_map;
+  const SymbolMap* symbol_map = LoadSymbolMap(fh, sections, mm_region, wide_map);
   if (query_symbol.empty()) {
-    vector<pair<string, int>> symbols;
-    for (int i = 0; i < fh.symb_cnt; i++) {
+    vector<pair<string, int64_t>> symbols;
+    for (int64_t i = 0; i < fh.symb_cnt; i++) {
       const SymbolMap& map = symbol_map[i];
       symbols.push_back(make_pair(map.symb, map.end - map.start + 1));
     }
@@ -209,7 +436,7 @@ void HandleTradeFile(const FileHeader& fh, const mm::mapped_region& mm_region) {
       }
     }
   } else {
-    ShowSymbolRecords(fh, mm_region, symbol_map);
+    ShowSymbolRecords(fh, sections, mm_region, symbol_map);
   }
 }
 
@@ -243,19 +470,31 @@ int main(int argc, char** argv) {
       throw domain_error("Input file not found : " + file_path);
     }
     const size_t file_size = (size_t)fs::file_size(file_path);
-    if (file_size < sizeof(FileHeader)) {
+    if (file_size < sizeof(FileHeaderV1)) {
       throw domain_error("Input file size too small to accomodate header : " + file_path);
     }
     mm::file_mapping mmfile(file_path.c_str(), mm::read_only);
     mm::mapped_region mmreg(mmfile, mm::read_only);
-    const FileHeader& fh = *(FileHeader*)mmreg.get_address();
+    FileHeader fh(FILE_VERSION_PACKED);
+    if (false == ReadFileHeader((const char*)mmreg.get_address(), file_size, fh)) {
+      throw domain_error("Input file size too small to accomodate header : " + file_path);
+    }
+    if (fh.type != RecordType::SecMaster && false == IsSupportedFileVersion(fh.version)) {
+      throw domain_error("Unsupported file version : " + file_path);
+    }
     if (fh.type == RecordType::SecMaster) {
       HandleSecMasterFile(fh, mmreg);
     }
-    else if (fh.type == RecordType::Nbbo || fh.type == RecordType::NbboPrice) {
+    else if (fh.type == RecordType::DailySummary) {
+      HandleSummaryFile(fh, mmreg);
+    }
+    else if (fh.type == RecordType::NbboSnapshot) {
+      HandleSnapshotFile(fh, mmreg);
+    }
+    else if (fh.type == RecordType::Nbbo || fh.type == RecordType::NbboPrice || fh.type == RecordType::ExchangeBbo) {
       HandleNbboFile(fh, mmreg);
     }
-    else if (fh.type == RecordType::Trade) {
+    else if (fh.type == RecordType::Trade || fh.type == RecordType::TradeNbbo || fh.type == RecordType::Bar) {
       HandleTradeFile(fh, mmreg);
     }
   }
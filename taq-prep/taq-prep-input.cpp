@@ -0,0 +1,621 @@
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/restrict.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "taq-prep.h"
+
+using namespace std;
+using namespace Taq;
+namespace fs = boost::filesystem;
+namespace mm = boost::interprocess;
+namespace io = boost::iostreams;
+
+namespace taq_prep {
+
+static const size_t BLOCK_SIZE = 64;
+static const size_t STREAM_BUFFER_SIZE = 16 * 1024 * 1024;
+static const size_t DECOMPRESS_BLOCK_SIZE = 4 * 1024 * 1024;
+static const int DECOMPRESS_BUFFER_SIZE = 1024 * 1024; // boost default of 4KB per filter dominates decompression time
+static const size_t DECOMPRESS_QUEUE_DEPTH = 8;
+static const size_t DECOMPRESS_AHEAD = 1;   // files decompressed ahead of the one being read
+
+static inline int LowestBit(uint64_t mask) {
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward64(&idx, mask);
+  return (int)idx;
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+
+// bit i is set when block[i] is either field separator '|' or line terminator '\n'
+static inline uint64_t SeparatorMask(const char* block) {
+#if defined(__AVX2__)
+  const __m256i pipe = _mm256_set1_epi8('|');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+  const __m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+  const uint32_t mask_lo = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, pipe), _mm256_cmpeq_epi8(lo, newline)));
+  const uint32_t mask_hi = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, pipe), _mm256_cmpeq_epi8(hi, newline)));
+  return (uint64_t)mask_lo | ((uint64_t)mask_hi << 32);
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128i pipe = _mm_set1_epi8('|');
+  const __m128i newline = _mm_set1_epi8('\n');
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+    const uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, pipe), _mm_cmpeq_epi8(chunk, newline)));
+    mask |= (uint64_t)bits << (16 * i);
+  }
+  return mask;
+#else
+  uint64_t mask = 0;
+  for (size_t i = 0; i < BLOCK_SIZE; i++) {
+    mask |= (uint64_t)(block[i] == '|' || block[i] == '\n') << i;
+  }
+  return mask;
+#endif
+}
+
+// splits complete lines of [data, data + size) into rows and hands them to consumer; when final is set an unterminated
+// last line is emitted as well; returns number of bytes consumed
+static size_t TokenizeRows(const char* data, size_t size, bool final, const RowConsumer& consumer) {
+  PsvRow row;
+  row.Clear(data);
+  const char* field_start = data;
+  const char* line_start = data;
+  for (size_t pos = 0; pos < size; pos += BLOCK_SIZE) {
+    uint64_t mask;
+    if (pos + BLOCK_SIZE <= size) {
+      mask = SeparatorMask(data + pos);
+    } else {
+      char tail[BLOCK_SIZE] = {};
+      memcpy(tail, data + pos, size - pos);
+      mask = SeparatorMask(tail) & ((uint64_t(1) << (size - pos)) - 1);
+    }
+    while (mask) {
+      const char* sep = data + pos + LowestBit(mask);
+      mask &= mask - 1;
+      row.Push(field_start, sep);
+      field_start = sep + 1;
+      if (*sep == '\n') {
+        consumer(row);
+        line_start = field_start;
+        row.Clear(line_start);
+      }
+    }
+  }
+  if (final && line_start < data + size) {
+    row.Push(field_start, data + size);
+    consumer(row);
+    line_start = data + size;
+  }
+  return line_start - data;
+}
+
+// hands [begin, end) of the file to visit as one mapped view
+static void MapFileRange(const string& path, uint64_t begin, uint64_t end,
+                         const function<void(const char*, size_t)>& visit) {
+  if (begin >= end) {
+    return;
+  }
+  mm::file_mapping mmfile(path.c_str(), mm::read_only);
+  mm::mapped_region mmreg(mmfile, mm::read_only, begin, end - begin);
+  mmreg.advise(mm::mapped_region::advice_sequential);
+  visit((const char*)mmreg.get_address(), mmreg.get_size());
+}
+
+static void ReadMappedFile(const string& path, uint64_t begin, uint64_t end, const RowConsumer& consumer) {
+  MapFileRange(path, begin, end, [&](const char* data, size_t size) { TokenizeRows(data, size, true, consumer); });
+}
+
+void ReadInputShard(const InputShard& shard, const RowConsumer& consumer) {
+  for (const InputSegment& segment : shard) {
+    ReadMappedFile(segment.path, segment.begin, segment.end, consumer);
+  }
+}
+
+void ReadInputBuffer(const char* data, size_t size, const RowConsumer& consumer) {
+  TokenizeRows(data, size, true, consumer);
+}
+
+// tokenizes a sequential source through a rolling buffer; reader returns 0 at end of input
+static void ReadBlocks(const BlockReader& reader, const RowConsumer& consumer) {
+  vector<char> buffer(STREAM_BUFFER_SIZE);
+  size_t buffered = 0;
+  bool eof = false;
+  while (!eof) {
+    if (buffered == buffer.size()) { // line longer than buffer
+      buffer.resize(buffer.size() * 2);
+    }
+    const size_t cnt = reader(buffer.data() + buffered, buffer.size() - buffered);
+    eof = cnt == 0;
+    buffered += cnt;
+    const size_t consumed = TokenizeRows(buffer.data(), buffered, eof, consumer);
+    memmove(buffer.data(), buffer.data() + consumed, buffered - consumed);
+    buffered -= consumed;
+  }
+}
+
+void ReadInputStream(istream& is, const RowConsumer& consumer) {
+  ReadBlocks([&](char* data, size_t size) {
+    is.read(data, size);
+    return (size_t)is.gcount();
+  }, consumer);
+}
+
+void ReadInputBlocks(const BlockReader& reader, const RowConsumer& consumer) {
+  ReadBlocks(reader, consumer);
+}
+
+bool IsCompressedInput(const string& path) {
+  const string ext = fs::path(path).extension().string();
+  return ext == ".gz" || ext == ".zst" || ext == ".zip";
+}
+
+bool IsCompressedInput(const vector<string>& files) {
+  return any_of(files.begin(), files.end(), [](const string& path) { return IsCompressedInput(path); });
+}
+
+static uint32_t LittleEndian(const unsigned char* p, int size) {
+  uint32_t val = 0;
+  for (int i = size - 1; i >= 0; i--) {
+    val = (val << 8) | p[i];
+  }
+  return val;
+}
+
+// data of the first entry of a zip archive, which is how single-file archives are published
+static void OpenZipEntry(const string& path, io::filtering_istream& is) {
+  unsigned char hdr[30];
+  ifstream file(path, ios::in | ios::binary);
+  if (!file.read((char*)hdr, sizeof(hdr)) || LittleEndian(hdr, 4) != 0x04034b50) {
+    throw domain_error("not a zip archive");
+  }
+  const uint32_t flags = LittleEndian(hdr + 6, 2);
+  const uint32_t method = LittleEndian(hdr + 8, 2);
+  const uint32_t compressed_size = LittleEndian(hdr + 18, 4);
+  const uint64_t offset = sizeof(hdr) + LittleEndian(hdr + 26, 2) + LittleEndian(hdr + 28, 2);
+  const bool size_known = (flags & 0x08) == 0 && compressed_size != 0xFFFFFFFF;
+  if (flags & 0x01) {
+    throw domain_error("encrypted zip entry");
+  } else if (method == 8) { // deflate stream terminates itself
+    io::zlib_params params;
+    params.noheader = true;
+    is.push(io::zlib_decompressor(params, DECOMPRESS_BUFFER_SIZE), DECOMPRESS_BUFFER_SIZE);
+    is.push(io::restrict(io::file_source(path, ios::in | ios::binary), offset), DECOMPRESS_BUFFER_SIZE);
+  } else if (method == 0 && size_known) {
+    is.push(io::restrict(io::file_source(path, ios::in | ios::binary), offset, compressed_size), DECOMPRESS_BUFFER_SIZE);
+  } else {
+    throw domain_error("unsupported zip compression method " + to_string(method));
+  }
+}
+
+static void OpenDecompressor(const string& path, io::filtering_istream& is) {
+  const string ext = fs::path(path).extension().string();
+  if (ext == ".zip") {
+    OpenZipEntry(path, is);
+    return;
+  } else if (ext == ".gz") {
+    is.push(io::gzip_decompressor(io::gzip::default_window_bits, DECOMPRESS_BUFFER_SIZE), DECOMPRESS_BUFFER_SIZE);
+  } else if (ext == ".zst") {
+    is.push(io::zstd_decompressor(DECOMPRESS_BUFFER_SIZE), DECOMPRESS_BUFFER_SIZE);
+  }
+  is.push(io::file_source(path, ios::in | ios::binary), DECOMPRESS_BUFFER_SIZE);
+}
+
+// decompresses a file on its own thread into a bounded queue of blocks, so decompression overlaps with parsing
+class DecompressedFile {
+public:
+  explicit DecompressedFile(const string& path)
+    : block_pos_(0), done_(false), cancelled_(false), worker_([this, path]() { Decompress(path); }) {}
+  ~DecompressedFile() {
+    {
+      lock_guard<mutex> lock(mtx_);
+      cancelled_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+  // copies up to size decompressed bytes; returns 0 at end of file
+  size_t Read(char* data, size_t size) {
+    size_t copied = 0;
+    while (copied < size) {
+      if (block_pos_ == block_.size()) {
+        unique_lock<mutex> lock(mtx_);
+        cv_.wait(lock, [this]() { return blocks_.size() || done_; });
+        if (blocks_.empty()) {
+          if (error_) {
+            rethrow_exception(error_);
+          }
+          break;
+        }
+        block_ = move(blocks_.front());
+        blocks_.pop_front();
+        block_pos_ = 0;
+        cv_.notify_all();
+      }
+      const size_t cnt = min(size - copied, block_.size() - block_pos_);
+      memcpy(data + copied, block_.data() + block_pos_, cnt);
+      block_pos_ += cnt;
+      copied += cnt;
+    }
+    return copied;
+  }
+
+private:
+  void Decompress(const string& path) {
+    try {
+      io::filtering_istream is;
+      OpenDecompressor(path, is);
+      is.exceptions(ios::badbit); // filter errors are otherwise reported as end of file
+      while (true) {
+        vector<char> block(DECOMPRESS_BLOCK_SIZE);
+        is.read(block.data(), block.size());
+        block.resize((size_t)is.gcount());
+        if (block.empty()) {
+          break;
+        }
+        unique_lock<mutex> lock(mtx_);
+        cv_.wait(lock, [this]() { return blocks_.size() < DECOMPRESS_QUEUE_DEPTH || cancelled_; });
+        if (cancelled_) {
+          break;
+        }
+        blocks_.push_back(move(block));
+        cv_.notify_all();
+      }
+    } catch (const exception& ex) {
+      lock_guard<mutex> lock(mtx_);
+      error_ = make_exception_ptr(domain_error(path + ": " + ex.what()));
+    }
+    lock_guard<mutex> lock(mtx_);
+    done_ = true;
+    cv_.notify_all();
+  }
+
+  vector<char> block_;
+  size_t block_pos_;
+  deque<vector<char>> blocks_;
+  bool done_;
+  bool cancelled_;
+  exception_ptr error_;
+  mutex mtx_;
+  condition_variable cv_;
+  thread worker_;
+};
+
+// visits files in order; compressed files are handed over as DecompressedFile, started ahead of their turn
+static void ForEachInputFile(const vector<string>& files, const function<void(const string&, DecompressedFile*)>& visit) {
+  deque<unique_ptr<DecompressedFile>> ahead;
+  size_t next = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    for (; next < files.size() && next <= i + DECOMPRESS_AHEAD; next++) {
+      ahead.push_back(IsCompressedInput(files[next]) ? make_unique<DecompressedFile>(files[next]) : nullptr);
+    }
+    const unique_ptr<DecompressedFile> file = move(ahead.front());
+    ahead.pop_front();
+    visit(files[i], file.get());
+  }
+}
+
+void ReadInputFiles(const vector<string>& files, const RowConsumer& consumer) {
+  ForEachInputFile(files, [&](const string& path, DecompressedFile* file) {
+    if (file) {
+      ReadBlocks([&](char* data, size_t size) { return file->Read(data, size); }, consumer);
+    } else {
+      ReadMappedFile(path, 0, (uint64_t)fs::file_size(path), consumer);
+    }
+  });
+}
+
+struct InputPosition {
+  size_t file_idx;
+  uint64_t offset;
+};
+
+static bool IsDataRecord(string_view line) {
+  return !(line.empty() || line[0] == '|' || line.substr(0, 5) == "Time|" || line.substr(0, 4) == "END|" || line == "END");
+}
+
+static string_view Field(string_view line, int column) {
+  for (int i = 0; i < column; i++) {
+    const size_t sep = line.find('|');
+    if (sep == string_view::npos) {
+      return string_view();
+    }
+    line.remove_prefix(sep + 1);
+  }
+  return line.substr(0, line.find('|'));
+}
+
+// scans lines of [line, end) for the first data line whose symbol differs from symbol, which is taken from the first
+// data line when empty; line is left at the first unscanned line; an unterminated last line is scanned only when final
+static const char* FindSymbolChange(const char*& line, const char* end, bool final, int symbol_column, string& symbol) {
+  while (line < end) {
+    const char* nl = (const char*)memchr(line, '\n', end - line);
+    if (!nl && !final) {
+      break;
+    }
+    const char* line_end = nl ? nl : end;
+    const string_view text(line, line_end - line);
+    if (IsDataRecord(text)) {
+      const string_view line_symbol = Field(text, symbol_column);
+      if (symbol.empty()) {
+        symbol = line_symbol;
+      } else if (symbol != line_symbol) {
+        return line;
+      }
+    }
+    line = nl ? nl + 1 : end;
+  }
+  return nullptr;
+}
+
+// first line start at or after pos that is followed by a change of symbol; no symbol is split across the position
+static InputPosition NextSymbolBoundary(const vector<string>& files, const vector<uint64_t>& file_sizes,
+                                        InputPosition pos, int symbol_column) {
+  string first_symbol;
+  for (; pos.file_idx < files.size(); pos.file_idx++, pos.offset = 0) {
+    if (pos.offset >= file_sizes[pos.file_idx]) {
+      continue;
+    }
+    mm::file_mapping mmfile(files[pos.file_idx].c_str(), mm::read_only);
+    mm::mapped_region mmreg(mmfile, mm::read_only);
+    const char* data = (const char*)mmreg.get_address();
+    const char* end = data + mmreg.get_size();
+    const char* line = data + pos.offset;
+    if (pos.offset && line[-1] != '\n') { // move to the next line start
+      const char* nl = (const char*)memchr(line, '\n', end - line);
+      line = nl ? nl + 1 : end;
+    }
+    const char* change = FindSymbolChange(line, end, true, symbol_column, first_symbol);
+    if (change) {
+      return InputPosition{pos.file_idx, (uint64_t)(change - data)};
+    }
+  }
+  return pos;
+}
+
+vector<InputShard> SplitInputFiles(const vector<string>& files, size_t shard_cnt, int symbol_column) {
+  vector<uint64_t> file_sizes;
+  uint64_t total_size = 0;
+  for (const auto& file : files) {
+    file_sizes.push_back((uint64_t)fs::file_size(file));
+    total_size += file_sizes.back();
+  }
+  // cut points are spread evenly by byte count, then moved forward to the next symbol boundary
+  vector<InputPosition> cuts = { InputPosition{0, 0} };
+  for (size_t i = 1; i < shard_cnt; i++) {
+    uint64_t target = total_size * i / shard_cnt;
+    InputPosition pos{0, 0};
+    while (pos.file_idx < files.size() && target >= file_sizes[pos.file_idx]) {
+      target -= file_sizes[pos.file_idx++];
+    }
+    if (pos.file_idx == files.size()) {
+      break;
+    }
+    pos.offset = target;
+    const InputPosition& last = cuts.back();
+    if (pos.file_idx < last.file_idx || (pos.file_idx == last.file_idx && pos.offset <= last.offset)) {
+      continue; // previous boundary search already moved past this target
+    }
+    pos = NextSymbolBoundary(files, file_sizes, pos, symbol_column);
+    if (pos.file_idx == files.size()) {
+      break;      // the last symbol runs to the end of input, later targets would scan it again
+    }
+    if (pos.file_idx != last.file_idx || pos.offset != last.offset) {
+      cuts.push_back(pos);
+    }
+  }
+  cuts.push_back(InputPosition{files.size(), 0});
+  // each shard covers [cut[i], cut[i+1]) as a list of per-file byte ranges
+  vector<InputShard> shards;
+  for (size_t i = 0; i + 1 < cuts.size(); i++) {
+    const InputPosition& from = cuts[i];
+    const InputPosition& to = cuts[i + 1];
+    InputShard shard;
+    for (size_t file_idx = from.file_idx; file_idx < files.size() && file_idx <= to.file_idx; file_idx++) {
+      const uint64_t begin = file_idx == from.file_idx ? from.offset : 0;
+      const uint64_t end = file_idx == to.file_idx ? to.offset : file_sizes[file_idx];
+      if (begin < end) {
+        shard.push_back(InputSegment{files[file_idx], begin, end});
+      }
+    }
+    if (shard.size()) {
+      shards.push_back(move(shard));
+    }
+  }
+  return shards;
+}
+
+uint64_t InputChunk::size() const {
+  uint64_t total = buffer.size();
+  for (const InputSegment& segment : segments) {
+    total += segment.end - segment.begin;
+  }
+  return total;
+}
+
+// the chunk's own buffer, or each of its file ranges in turn, with the offset of the view in the chunk
+static void VisitChunk(const InputChunk& chunk, const function<void(const char*, size_t, uint64_t)>& visit) {
+  if (chunk.buffer.size()) {
+    visit(chunk.buffer.data(), chunk.buffer.size(), 0);
+  }
+  uint64_t offset = chunk.buffer.size();
+  for (const InputSegment& segment : chunk.segments) {
+    MapFileRange(segment.path, segment.begin, segment.end, [&](const char* data, size_t size) {
+      visit(data, size, offset);
+    });
+    offset += segment.end - segment.begin;
+  }
+}
+
+void ReadInputChunk(const InputChunk& chunk, const ChunkRowConsumer& consumer) {
+  VisitChunk(chunk, [&](const char* data, size_t size, uint64_t offset) {
+    TokenizeRows(data, size, true, [&](const PsvRow& row) { consumer(row, offset + (row.Line().data() - data)); });
+  });
+}
+
+// symbols of the first and the last data line of a chunk, empty if it has none
+void ChunkSymbolRange(const InputChunk& chunk, int symbol_column, string& first, string& last) {
+  first.clear();
+  last.clear();
+  VisitChunk(chunk, [&](const char* data, size_t size, uint64_t) {
+    const string_view text(data, size);
+    string_view view_first, view_last;
+    for (size_t pos = 0; pos < text.size() && view_first.empty(); ) {
+      const size_t nl = min(text.find('\n', pos), text.size());
+      const string_view line = text.substr(pos, nl - pos);
+      if (IsDataRecord(line)) {
+        view_first = Field(line, symbol_column);
+      }
+      pos = nl + 1;
+    }
+    for (size_t end = text.size(); end > 0 && view_last.empty(); ) {
+      const size_t nl = end > 1 ? text.rfind('\n', end - 2) : string_view::npos;
+      const size_t start = nl == string_view::npos ? 0 : nl + 1;
+      const string_view line = text.substr(start, end - start - (text[end - 1] == '\n' ? 1 : 0));
+      if (IsDataRecord(line)) {
+        view_last = Field(line, symbol_column);
+      }
+      end = start;
+    }
+    if (first.empty()) {
+      first = view_first;
+    }
+    if (view_last.size()) {
+      last = view_last;
+    }
+  });
+}
+
+// collects input into chunks of about chunk_size bytes, each cut at a symbol boundary
+class InputChunker {
+public:
+  InputChunker(size_t chunk_size, int symbol_column, const ChunkConsumer& consumer)
+    : chunk_size_(chunk_size), symbol_column_(symbol_column), consumer_(consumer), scan_pos_(0) {
+    chunk_.reserve(chunk_size_ + DECOMPRESS_BLOCK_SIZE);
+  }
+  void Read(const BlockReader& reader) {
+    while (true) {
+      const size_t filled = chunk_.size();
+      chunk_.resize(filled + DECOMPRESS_BLOCK_SIZE);
+      const size_t cnt = reader(chunk_.data() + filled, DECOMPRESS_BLOCK_SIZE);
+      chunk_.resize(filled + cnt);
+      if (cnt == 0) {
+        break;
+      }
+      Cut();
+    }
+    if (chunk_.size() && chunk_.back() != '\n') { // sources are not joined mid-line
+      chunk_.push_back('\n');
+    }
+  }
+  void Finish() {
+    if (chunk_.size()) {
+      consumer_(InputChunk{move(chunk_), {}});
+    }
+  }
+
+private:
+  void Cut() {
+    while (chunk_.size() >= chunk_size_) {
+      const char* data = chunk_.data();
+      const char* end = data + chunk_.size();
+      if (scan_pos_ == 0) {
+        const char* nl = (const char*)memchr(data + chunk_size_ - 1, '\n', end - (data + chunk_size_ - 1));
+        if (!nl) {
+          return;
+        }
+        scan_pos_ = nl + 1 - data;
+        symbol_.clear();
+      }
+      const char* line = data + scan_pos_;
+      const char* cut = FindSymbolChange(line, end, false, symbol_column_, symbol_);
+      scan_pos_ = line - data;
+      if (!cut) {
+        return;
+      }
+      vector<char> rest;
+      rest.reserve(chunk_size_ + DECOMPRESS_BLOCK_SIZE);
+      rest.assign(cut, end);
+      chunk_.resize(cut - data);
+      consumer_(InputChunk{move(chunk_), {}});
+      chunk_ = move(rest);
+      scan_pos_ = 0;
+    }
+  }
+
+  const size_t chunk_size_;
+  const int symbol_column_;
+  const ChunkConsumer& consumer_;
+  vector<char> chunk_;
+  size_t scan_pos_; // next line to examine for a symbol change, 0 until chunk_size is reached
+  string symbol_;
+};
+
+// reads files as one stream and hands it over in chunks of about chunk_size bytes, each cut at a symbol boundary;
+// uncompressed files are not copied, their chunks are file ranges, so a symbol of any size costs no memory but the
+// mapping while it is read
+void ReadInputChunks(const vector<string>& files, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer) {
+  if (false == IsCompressedInput(files)) {
+    uint64_t total_size = 0;
+    for (const auto& file : files) {
+      total_size += (uint64_t)fs::file_size(file);
+    }
+    for (InputShard& shard : SplitInputFiles(files, (size_t)(total_size / chunk_size) + 1, symbol_column)) {
+      consumer(InputChunk{{}, move(shard)});
+    }
+    return;
+  }
+  InputChunker chunker(chunk_size, symbol_column, consumer);
+  ForEachInputFile(files, [&](const string& path, DecompressedFile* file) {
+    if (file) {
+      chunker.Read([&](char* data, size_t size) { return file->Read(data, size); });
+    } else {
+      ifstream plain(path, ios::in | ios::binary);
+      chunker.Read([&](char* data, size_t size) {
+        plain.read(data, size);
+        return (size_t)plain.gcount();
+      });
+    }
+  });
+  chunker.Finish();
+}
+
+void ReadInputStreamChunks(istream& is, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer) {
+  ReadInputBlockChunks([&](char* data, size_t size) {
+    is.read(data, size);
+    return (size_t)is.gcount();
+  }, chunk_size, symbol_column, consumer);
+}
+
+void ReadInputBlockChunks(const BlockReader& reader, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer) {
+  InputChunker chunker(chunk_size, symbol_column, consumer);
+  chunker.Read(reader);
+  chunker.Finish();
+}
+
+}
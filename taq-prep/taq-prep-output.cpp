@@ -0,0 +1,330 @@
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "taq-prep.h"
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace mm = boost::interprocess;
+
+namespace taq_prep {
+
+MappedFileBuf::MappedFileBuf() : capacity_(0) {}
+
+MappedFileBuf::~MappedFileBuf() {
+  if (IsOpen()) {
+    region_.reset();
+    boost::system::error_code ec;
+    fs::remove(tmp_path_, ec);
+  }
+}
+
+void MappedFileBuf::Open(const string & path) {
+  if (IsOpen()) {
+    throw(logic_error("Output file already open: " + path_));
+  }
+  tmp_path_ = path + ".tmp";
+  if (false == ofstream(tmp_path_, ios::out | ios::binary | ios::trunc).good()) {
+    throw(domain_error("Failed to create output file: " + tmp_path_));
+  }
+  path_ = path;
+  Map(INITIAL_CAPACITY, 0);
+}
+
+void MappedFileBuf::Map(size_t capacity, size_t written) {
+  region_.reset();
+  fs::resize_file(tmp_path_, capacity);
+  mm::file_mapping mmfile(tmp_path_.c_str(), mm::read_write);
+  region_.reset(new mm::mapped_region(mmfile, mm::read_write));
+  capacity_ = capacity;
+  char * base = (char*)region_->get_address();
+  setp(base, base + capacity_);
+  Advance(written);
+}
+
+// pbump takes an int
+void MappedFileBuf::Advance(size_t size) {
+  for (; size > INT_MAX; size -= INT_MAX) {
+    pbump(INT_MAX);
+  }
+  pbump((int)size);
+}
+
+void MappedFileBuf::Reserve(size_t size) {
+  if (false == IsOpen()) {
+    throw(logic_error("Output file is not open"));
+  }
+  const size_t written = Written();
+  if (written + size > capacity_) {
+    Map(max(capacity_ * 2, written + size), written);
+  }
+}
+
+MappedFileBuf::int_type MappedFileBuf::overflow(int_type ch) {
+  if (traits_type::eq_int_type(ch, traits_type::eof())) {
+    return traits_type::not_eof(ch);
+  }
+  Reserve(1);
+  *pptr() = traits_type::to_char_type(ch);
+  pbump(1);
+  return ch;
+}
+
+streamsize MappedFileBuf::xsputn(const char * data, streamsize size) {
+  Reserve((size_t)size);
+  memcpy(pptr(), data, (size_t)size);
+  Advance((size_t)size);
+  return size;
+}
+
+void MappedFileBuf::Overwrite(size_t offset, const void * data, size_t size) {
+  if (offset + size > Written()) {
+    throw(logic_error("Overwrite past the end of output file: " + path_));
+  }
+  memcpy(pbase() + offset, data, size);
+}
+
+void MappedFileBuf::Commit() {
+  const size_t written = Written();
+  region_.reset();
+  setp(nullptr, nullptr);
+  capacity_ = 0;
+  fs::resize_file(tmp_path_, written);
+  fs::rename(tmp_path_, path_);
+  path_.clear();
+}
+
+template <typename T>
+static vector<Taq::FieldLayout> Fields() {
+  return vector<Taq::FieldLayout>(begin(Taq::RecordLayout<T>::fields), end(Taq::RecordLayout<T>::fields));
+}
+
+SegmentWriter::SegmentWriter(Taq::RecordType type, int version)
+  : version_(version), compress_(Taq::IsCompressedFileVersion(version)), segment_record_cnt_(0), block_bytes_(0),
+    block_record_cnt_(0), index_prices_(type == Taq::RecordType::Nbbo && Taq::HasPriceIndex(version)),
+    segment_first_position_(0) {
+  if (type == Taq::RecordType::Nbbo) {
+    record_size_ = sizeof(Taq::Nbbo);
+    fields_ = Fields<Taq::Nbbo>();
+  } else if (type == Taq::RecordType::NbboPrice) {
+    record_size_ = sizeof(Taq::NbboPrice);
+    fields_ = Fields<Taq::NbboPrice>();
+  } else if (type == Taq::RecordType::Trade) {
+    record_size_ = sizeof(Taq::Trade);
+    fields_ = Fields<Taq::Trade>();
+  } else if (type == Taq::RecordType::ExchangeBbo) {
+    record_size_ = sizeof(Taq::ExchangeBbo);
+    fields_ = Fields<Taq::ExchangeBbo>();
+  } else if (type == Taq::RecordType::TradeNbbo) {
+    record_size_ = sizeof(Taq::TradeNbbo);
+    fields_ = Fields<Taq::TradeNbbo>();
+  } else if (type == Taq::RecordType::Bar) {
+    record_size_ = sizeof(Taq::Bar);
+    fields_ = Fields<Taq::Bar>();
+  } else {
+    throw(logic_error("No segment layout for record type"));
+  }
+  if (false == Taq::IsSupportedFileVersion(version_)) {
+    throw(domain_error("Unsupported file version: " + to_string(version_)));
+  }
+  packed_.resize(record_size_);
+  columns_.resize(fields_.size());
+}
+
+void SegmentWriter::Write(ostream & os, const void * record) {
+  segment_record_cnt_++;
+  if (version_ == Taq::FILE_VERSION_PACKED) {
+    memset(packed_.data(), 0, record_size_);      // padding between the fields is written as zeros
+    for (const Taq::FieldLayout & field : fields_) {
+      Taq::WriteField(field, version_, (const char*)record + field.offset, packed_.data() + field.offset);
+    }
+    os.write(packed_.data(), record_size_);
+    return;
+  }
+  for (size_t i = 0; i < fields_.size(); i++) {
+    vector<char> & column = columns_[i];
+    column.resize(column.size() + fields_[i].size);
+    Taq::WriteField(fields_[i], version_, (const char*)record + fields_[i].offset, column.data() + column.size() - fields_[i].size);
+  }
+  if (compress_ && columns_[0].size() == Taq::BLOCK_RECORDS * fields_[0].size) {
+    WriteBlock(os);
+  }
+}
+
+// positions count the records of the segment, whether or not some were written as blocks already
+void SegmentWriter::MarkPriceChange() {
+  if (false == index_prices_) {
+    return;
+  }
+  const size_t position = segment_record_cnt_ - 1;
+  if (position > UINT32_MAX) {
+    throw(domain_error("Too many records of a symbol for the price index"));
+  }
+  positions_.push_back((uint32_t)position);
+}
+
+void SegmentWriter::Finish(ostream & os) {
+  if (compress_ && columns_[0].size()) {
+    WriteBlock(os);
+  }
+  segment_record_cnt_ = 0;
+  if (Taq::HasTimeIndex(version_)) {
+    if (false == compress_) {
+      times_.resize(columns_[0].size() / sizeof(int64_t));
+      memcpy(times_.data(), columns_[0].data(), columns_[0].size());
+    }
+    IndexTimes();
+  }
+  if (index_prices_) {
+    price_index_.push_back(Taq::PriceIndexEntry{segment_first_position_, positions_.size() - segment_first_position_});
+    segment_first_position_ = positions_.size();
+  }
+  for (vector<char> & column : columns_) {
+    os.write(column.data(), column.size());
+    column.clear();
+  }
+}
+
+// buckets of equal width that hold TIME_INDEX_BUCKET_RECORDS records on average over the symbol's trading span
+void SegmentWriter::IndexTimes() {
+  const vector<int64_t> & times = times_;
+  const size_t record_cnt = times.size();
+  const int64_t span = times.back() - times.front();
+  const int64_t bucket_width = span / (int64_t)(record_cnt / Taq::TIME_INDEX_BUCKET_RECORDS + 1) + 1;
+  const Taq::TimeIndexEntry entry{times.front(), bucket_width, buckets_.size(), (uint64_t)(span / bucket_width + 1)};
+  size_t record = 0;
+  for (uint64_t bucket = 0; bucket < entry.bucket_cnt; bucket++) {
+    const int64_t bucket_start = entry.first_time + (int64_t)bucket * bucket_width;
+    while (record < record_cnt && times[record] < bucket_start) {
+      record++;
+    }
+    buckets_.push_back(record);
+  }
+  time_index_.push_back(entry);
+  times_.clear();
+}
+
+// the first field of every record type is its time
+void SegmentWriter::WriteBlock(ostream & os) {
+  const size_t record_cnt = columns_[0].size() / fields_[0].size;
+  int64_t first_time;
+  memcpy(&first_time, columns_[0].data(), sizeof(first_time));
+  if (Taq::HasTimeIndex(version_)) {     // indexed when the segment is finished
+    const size_t time_cnt = times_.size();
+    times_.resize(time_cnt + record_cnt);
+    memcpy(times_.data() + time_cnt, columns_[0].data(), columns_[0].size());
+  }
+  block_.clear();
+  for (vector<char> & column : columns_) {
+    block_.insert(block_.end(), column.begin(), column.end());
+    column.clear();
+  }
+  Taq::EncodeBlock(fields_.data(), fields_.size(), record_cnt, block_.data(), block_.size(), compressed_);
+  os.write(compressed_.data(), compressed_.size());
+  blocks_.push_back(Taq::BlockIndexEntry{block_bytes_, (uint32_t)compressed_.size(), (uint32_t)record_cnt,
+                                         block_record_cnt_ + 1, first_time});
+  block_bytes_ += compressed_.size();
+  block_record_cnt_ += record_cnt;
+}
+
+void SegmentWriter::Append(const SegmentWriter & other) {
+  for (Taq::BlockIndexEntry block : other.blocks_) {
+    block.offset += block_bytes_;
+    block.first_record += block_record_cnt_;
+    blocks_.push_back(block);
+  }
+  block_bytes_ += other.block_bytes_;
+  block_record_cnt_ += other.block_record_cnt_;
+  for (Taq::TimeIndexEntry entry : other.time_index_) {
+    entry.first_bucket += buckets_.size();
+    time_index_.push_back(entry);
+  }
+  buckets_.insert(buckets_.end(), other.buckets_.begin(), other.buckets_.end());
+  for (Taq::PriceIndexEntry entry : other.price_index_) {
+    entry.first_position += positions_.size();
+    price_index_.push_back(entry);
+  }
+  positions_.insert(positions_.end(), other.positions_.begin(), other.positions_.end());
+  segment_first_position_ = positions_.size();
+}
+
+void SegmentWriter::WriteTrailer(ostream & os, const vector<Taq::SymbolMap> & symbol_map) const {
+  for (const Taq::SymbolMap & sm : symbol_map) {
+    if (Taq::HasWideCounts(version_)) {
+      char entry[sizeof(sm)] = {};    // without the padding after the symbol, so identical input gives identical files
+      memcpy(entry + offsetof(Taq::SymbolMap, symb), sm.symb, sizeof(sm.symb));
+      memcpy(entry + offsetof(Taq::SymbolMap, start), &sm.start, sizeof(sm.start));
+      memcpy(entry + offsetof(Taq::SymbolMap, end), &sm.end, sizeof(sm.end));
+      os.write(entry, sizeof(entry));
+      continue;
+    }
+    if (sm.end > INT_MAX) {
+      throw(domain_error("Too many records for file version " + to_string(Taq::FileLayoutVersion(version_)) + ", use --file-version 7"));
+    }
+    Taq::SymbolMapV1 entry;
+    memcpy(entry.symb, sm.symb, sizeof(entry.symb));
+    entry.start = (int)sm.start;
+    entry.end = (int)sm.end;
+    os.write((const char*)&entry, sizeof(entry));
+  }
+  vector<uint32_t> slots;
+  if (Taq::HasTimeIndex(version_)) {
+    os.write((const char*)time_index_.data(), time_index_.size() * sizeof(Taq::TimeIndexEntry));
+    os.write((const char*)buckets_.data(), buckets_.size() * sizeof(uint64_t));
+    if (Taq::HasSymbolDirectory(version_)) {
+      slots.resize(Taq::SymbolDirectorySlots(symbol_map.size()));
+      Taq::BuildSymbolDirectory(symbol_map.data(), symbol_map.size(), slots.data(), slots.size());
+      os.write((const char*)slots.data(), slots.size() * sizeof(uint32_t));
+    }
+    if (Taq::HasPriceIndex(version_)) {
+      os.write((const char*)price_index_.data(), price_index_.size() * sizeof(Taq::PriceIndexEntry));
+      os.write((const char*)positions_.data(), positions_.size() * sizeof(uint32_t));
+    }
+  }
+  if (compress_) {
+    os.write((const char*)blocks_.data(), blocks_.size() * sizeof(Taq::BlockIndexEntry));
+  }
+  if (Taq::HasTimeIndex(version_)) {
+    const Taq::TimeIndexFooter footer{buckets_.size()};
+    os.write((const char*)&footer, sizeof(footer));
+    if (Taq::HasSymbolDirectory(version_)) {
+      const Taq::SymbolDirectoryFooter directory_footer{slots.size()};
+      os.write((const char*)&directory_footer, sizeof(directory_footer));
+    }
+    if (Taq::HasPriceIndex(version_)) {
+      const Taq::PriceIndexFooter price_footer{price_index_.size(), positions_.size()};
+      os.write((const char*)&price_footer, sizeof(price_footer));
+    }
+  }
+  if (compress_) {
+    const Taq::BlockIndexFooter block_footer{blocks_.size(), Taq::BLOCK_RECORDS, 0};
+    os.write((const char*)&block_footer, sizeof(block_footer));
+  }
+}
+
+static void EncodeHeader(const OutputFile & output, char * header) {
+  if (false == Taq::WriteFileHeader(output.hdr, header)) {
+    throw(domain_error("Too many records for file version " + to_string(Taq::FileLayoutVersion(output.hdr.version))
+                       + ", use --file-version 7: "
+                       + output.path));
+  }
+}
+
+void OutputFile::WriteHeader() {
+  char header[sizeof(Taq::FileHeader)];
+  EncodeHeader(*this, header);
+  stream.write(header, Taq::FileHeaderSize(hdr.version));
+}
+
+void OutputFile::RewriteHeader() {
+  char header[sizeof(Taq::FileHeader)];
+  EncodeHeader(*this, header);
+  buffer.Overwrite(0, header, Taq::FileHeaderSize(hdr.version));
+}
+
+}
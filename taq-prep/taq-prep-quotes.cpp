@@ -2,19 +2,28 @@
 
 #include <vector>
 #include <unordered_map>
-#include <map>
+#include <set>
 #include <algorithm>
 #include <iterator>
 #include <numeric>
 #include <limits>
+#include <optional>
 #include <sstream>
-#include "boost-algorithm-string.h"
+#include <thread>
+#include <future>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <boost/filesystem.hpp>
 
 #include "taq-prep.h"
 #include "taq-time.h"
+#include "taq-nbbo.h"
 
 using namespace std;
 using namespace Taq;
+namespace fs = boost::filesystem;
 
 namespace taq_prep {
 
@@ -23,27 +32,18 @@ struct BboSide {
   int size;
   bool is_set;
   BboSide() : price(.0), size(0), is_set(false) { }
-  BboSide(const string &price, const string &size) : price(stod(price)), size(stoi(size)), is_set(false) { }
+  BboSide(string_view price, string_view size) : price(ParseDouble(price)), size(ParseInt(size)), is_set(false) { }
 };
 
 struct Bbo {
   BboSide bid;
   BboSide offer;
   Bbo() = default;
-  Bbo(const vector<string> & row) :
+  Bbo(const PsvRow & row) :
     bid(row[QCOL_Bid_Price], row[QCOL_Bid_Size]),
     offer(row[QCOL_Offer_Price], row[QCOL_Offer_Size]) { }
 };
 
-struct NbboSide{
-  enum Side {BID, OFFER};
-  double price;
-  int size;
-  ExchangeMask exch_mask;
-  NbboSide(Side side) : price( side == BID ? 0 : numeric_limits<double>::max()), size(0) { }
-};
-
-
 struct Nbbo {
   NbboSide bid;
   NbboSide offer;
@@ -52,19 +52,59 @@ struct Nbbo {
 
 struct NbboTableEntry {
   Nbbo current_nbbo;
-  BboSide exchange_bids[Exch_Max];
-  BboSide exchange_offers[Exch_Max];
-  //vector<Taq::Nbbo> out_nbbo;
-  NbboTableEntry() = default;
+  ExchangeBook exchange_bids;
+  ExchangeBook exchange_offers;
+  NbboTableEntry() : exchange_bids(NbboSide::BID), exchange_offers(NbboSide::OFFER) {}
 };
 
-typedef map<string, NbboTableEntry> NbboTable;
+// output bookkeeping of one product (nbbo, nbbo-po or bbo) built from the quote stream
+struct QuoteProduct {
+  RecordType type;
+  vector<SymbolMap> symbol_map;
+  SymbolId last_symbol;
+  int64_t rec_cnt;
+  SegmentWriter writer;
+  QuoteProduct(RecordType type, int version)
+    : type(type), last_symbol(SymbolTable::NO_SYMBOL), rec_cnt(0), writer(type, version) {}
+};
 
-static NbboTable nbbo;
-static RecordType record_type = RecordType::NbboPrice;
+// the daily summary of a symbol so far, the NBBO spread since its last change, and the snapshot of its NBBO
+struct QuoteActivity {
+  DailySummary summary;
+  int64_t last_change;
+  int64_t spread;           // in ticks, -1 without a two-sided, uncrossed NBBO
+  optional<Taq::Nbbo> nbbo;         // the last nbbo record
+  vector<Taq::Nbbo> snapshot;       // at the grid times before it
+  QuoteActivity() : last_change(0), spread(-1) {}
+};
 
+// NBBO state and output bookkeeping for a contiguous, symbol-aligned slice of the input; all requested products
+// share one NBBO computation, kept per symbol id of the shard's own symbol table
+struct QuoteShard {
+  SymbolTable symbols;
+  vector<NbboTableEntry> nbbo;
+  vector<QuoteActivity> activity;
+  vector<DailySummary> summaries;   // of the finished shard
+  const SnapshotGrid grid;          // without times unless --snapshot-interval
+  vector<SnapshotColumn> snapshots; // of the finished shard
+  vector<QuoteProduct> products;
+  QuoteShard(const AppContext & ctx) : grid(ctx.snapshot_interval * Bar::NANOS) {
+    for (const OutputFile & output : ctx.outputs) {
+      products.emplace_back(output.type, output.hdr.version);
+    }
+  }
+};
+
+enum NbboChange {
+  NBBO_PRICE_CHANGE = 1,
+  NBBO_SIZE_CHANGE = 2,
+  EXCHANGE_BBO_CHANGE = 4     // the quote of the exchange changed, whether or not the NBBO did
+};
 
-static void ValidateQuote(const vector<string> & row, Bbo & bbo) {
+static const size_t QUOTE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+
+static void ValidateQuote(const PsvRow & row, Bbo & bbo) {
     const char src = row[QCOL_Source_Of_Quote][0];
     const char cond = row[QCOL_Quote_Condition][0];
     if (src == 'C') {
@@ -82,102 +122,122 @@ static void ValidateQuote(const vector<string> & row, Bbo & bbo) {
     }
 }
 
-static void ResetNbboSide(NbboTableEntry & entry, NbboSide::Side side) {
+static int UpdateNbboSide(NbboTableEntry & entry, NbboSide::Side side, int exch_idx, const BboSide & new_quote) {
   NbboSide & best_quote = side == NbboSide::BID ? entry.current_nbbo.bid : entry.current_nbbo.offer;
-  const BboSide * exchange_quotes = side == NbboSide::BID  ? entry.exchange_bids : entry.exchange_offers;
-  auto is_better = side == NbboSide::BID
-    ? [] (double bid, double best_bid) { return bid > best_bid; }
-    : [] (double offer, double best_offer) { return offer < best_offer; };
-
-  best_quote.price = side == NbboSide::BID ? 0 : numeric_limits<double>::max();
-  best_quote.size = 0;
-  best_quote.exch_mask.reset();
-  for (int i = 0; i < Exch_Max; i ++ ) {
-    const BboSide & quote = exchange_quotes[i];
-    if (quote.is_set) {
-      if (is_better(quote.price, best_quote.price)) { // replace best quote
-        best_quote.exch_mask.reset();
-        best_quote.exch_mask.set(i);
-        best_quote.price = quote.price;
-        best_quote.size = quote.size;
-      } else if (quote.price == best_quote.price) { // join best quote
-        best_quote.exch_mask.set(i);
-        best_quote.size += quote.size;
-      }
-    }
+  const double previous_best_price = best_quote.price;
+  const int previous_best_size = best_quote.size;
+  if (side == NbboSide::BID) {
+    Taq::UpdateNbboSide<NbboSide::BID>(entry.exchange_bids, best_quote, exch_idx, new_quote.is_set, new_quote.price,
+                                       new_quote.size);
+  } else {
+    Taq::UpdateNbboSide<NbboSide::OFFER>(entry.exchange_offers, best_quote, exch_idx, new_quote.is_set,
+                                         new_quote.price, new_quote.size);
   }
+  return (best_quote.price != previous_best_price ? NBBO_PRICE_CHANGE : 0)
+       | (best_quote.size != previous_best_size ? NBBO_SIZE_CHANGE : 0);
 }
 
-static bool UpdateNbboSide(NbboTableEntry & entry, NbboSide::Side side, int exch_idx, const BboSide & new_quote) {
-  BboSide & current_quote = side == NbboSide::BID ? entry.exchange_bids[exch_idx] : entry.exchange_offers[exch_idx];
-  NbboSide & best_quote = side == NbboSide::BID ? entry.current_nbbo.bid : entry.current_nbbo.offer;
-  const double previous_best_price = best_quote.price;
-  const int previous_best_size = best_quote.size;
-  auto is_better = side == NbboSide::BID
-    ? [] (double bid, double best_bid) { return bid > best_bid; }
-    : [] (double offer, double best_offer) { return offer < best_offer; };
-  if (new_quote.is_set) {
-    if (is_better(new_quote.price, best_quote.price)) {               // replace best quote
-      best_quote.exch_mask.reset();
-      best_quote.exch_mask.set(exch_idx);
-      best_quote.price = new_quote.price;
-      best_quote.size = new_quote.size;
-    } else if (new_quote.price == best_quote.price) {                 // match best quote
-      if (best_quote.exch_mask.test(exch_idx)) {                      // was a conributor already - adjust size of best quote
-        best_quote.size += (new_quote.size - current_quote.size);
-      } else {                                                        // join best quote
-        best_quote.exch_mask.set(exch_idx);
-        best_quote.size += new_quote.size;
-      }
-    } else if (best_quote.exch_mask.test(exch_idx)) {                 // was a conributor to best quote
-      if (best_quote.exch_mask.count() > 1) {                         // remove from best quote
-        best_quote.size -= current_quote.size;
-        best_quote.exch_mask.set(exch_idx, 0);
-      } else {                                                        // was the sole conributor - reset best quote
-        current_quote = new_quote;
-        ResetNbboSide(entry, side);
+static bool IsBookChange(const ExchangeBook & book, int exch_idx, const BboSide & quote) {
+  return (bool)(book.set_mask & (1u << exch_idx)) != quote.is_set
+    || (quote.is_set && (book.price[exch_idx] != quote.price || book.size[exch_idx] != quote.size));
+}
+
+static int UpdateNbbo(QuoteShard & shard, SymbolId symbol_id, char exchange, const Bbo & bbo, const Nbbo *& current_nbbo) {
+  const int exch_idx = exchange - 'A';
+  if (symbol_id == shard.nbbo.size()) {
+    shard.nbbo.emplace_back();
+  }
+  NbboTableEntry & entry = shard.nbbo[symbol_id];
+  current_nbbo = &entry.current_nbbo;
+  const int exchange_change = IsBookChange(entry.exchange_bids, exch_idx, bbo.bid)
+                              || IsBookChange(entry.exchange_offers, exch_idx, bbo.offer) ? EXCHANGE_BBO_CHANGE : 0;
+  return UpdateNbboSide(entry, NbboSide::BID, exch_idx, bbo.bid) | UpdateNbboSide(entry, NbboSide::OFFER, exch_idx, bbo.offer)
+       | exchange_change;
+}
+
+static bool IsProductChange(RecordType type, int changes) {
+  if (type == RecordType::NbboPrice) {
+    return changes & NBBO_PRICE_CHANGE;
+  } else if (type == RecordType::ExchangeBbo) {
+    return changes & EXCHANGE_BBO_CHANGE;
+  }
+  return changes & (NBBO_PRICE_CHANGE | NBBO_SIZE_CHANGE);
+}
+
+// writes a record of each product that reflects the change: nbbo on any nbbo change, nbbo-po on price change only,
+// bbo on any change of the exchange's quote; v8 nbbo files index their price changes, so a quote day needs no nbbo-po
+// file
+static void WriteNbbo(QuoteShard & shard, int changes, int64_t time, string_view symbol, SymbolId symbol_id,
+                      const Nbbo & nbbo, char exchange, const Bbo & bbo, const vector<ostream*> & os) {
+  for (size_t i = 0; i < shard.products.size(); i++) {
+    QuoteProduct & product = shard.products[i];
+    if (false == IsProductChange(product.type, changes)) {
+      continue;
+    }
+    product.rec_cnt++;
+    if (product.last_symbol != symbol_id) {
+      if (product.symbol_map.size()) {
+        product.symbol_map.rbegin()->end = product.rec_cnt - 1;
+        product.writer.Finish(*os[i]);
       }
-    } else if (best_quote.exch_mask.count() == 0) {
-      throw(logic_error("should not be here"));
-    }
-  } else if (best_quote.exch_mask.test(exch_idx)) {                 // was a conributor to best quote
-      if (best_quote.exch_mask.count() > 1) {                       // remove from best quote
-        best_quote.size -= current_quote.size;
-        best_quote.exch_mask.set(exch_idx, 0);
-      } else {                                                      // was the sole conributor - reset best quote
-        current_quote = new_quote;
-        ResetNbboSide(entry, side);
+      product.symbol_map.push_back(SymbolMap(symbol, product.rec_cnt, 0));
+      product.last_symbol = symbol_id;
+    }
+    if (product.type == RecordType::NbboPrice) {
+      Taq::NbboPrice record(time, MkPriceTicks(nbbo.bid.price), MkPriceTicks(nbbo.offer.price));
+      product.writer.Write(*os[i], &record);
+    } else if (product.type == RecordType::ExchangeBbo) {
+      const double bid = bbo.bid.is_set ? bbo.bid.price : NbboSide::NoPrice(NbboSide::BID);
+      const double offer = bbo.offer.is_set ? bbo.offer.price : NbboSide::NoPrice(NbboSide::OFFER);
+      Taq::ExchangeBbo record(time, MkPriceTicks(bid), MkPriceTicks(offer), bbo.bid.is_set ? bbo.bid.size : 0,
+                              bbo.offer.is_set ? bbo.offer.size : 0, exchange);
+      product.writer.Write(*os[i], &record);
+    } else {
+      Taq::Nbbo record(time, MkPriceTicks(nbbo.bid.price), MkPriceTicks(nbbo.offer.price), nbbo.bid.size, nbbo.offer.size);
+      product.writer.Write(*os[i], &record);
+      if (changes & NBBO_PRICE_CHANGE) {
+        product.writer.MarkPriceChange();
       }
+    }
   }
-  current_quote = new_quote;
-  if (best_quote.size == 0) {
-    best_quote.price = side == NbboSide::BID ? 0 : numeric_limits<double>::max();
-  } else if (best_quote.size < 0) {
-    throw(logic_error("Negative best quote size"));
+}
+
+// the spread of the NBBO since its last change, over the part of the regular hours until time
+static void AddSpreadTime(QuoteActivity & activity, int64_t time) {
+  const int64_t from = max(activity.last_change, DailySummary::REGULAR_OPEN);
+  const int64_t to = min(time, DailySummary::REGULAR_CLOSE);
+  if (activity.spread >= 0 && to > from) {
+    activity.summary.quotes.two_sided_time += to - from;
+    activity.summary.quotes.spread_time += (double)activity.spread * (double)(to - from);
   }
-  return record_type == RecordType::NbboPrice
-        ? best_quote.price != previous_best_price
-        : best_quote.size != previous_best_size || best_quote.price != previous_best_price;
 }
 
-static bool UpdateNbbo(const string & timestamp, const string & symbol, const string & exchange, const Bbo & bbo, ofstream & os) {
-  const int exch_idx = exchange[0] - 'A';
-  NbboTableEntry & entry = nbbo[symbol];
-  bool update_nbbo = UpdateNbboSide(entry, NbboSide::BID, exch_idx, bbo.bid);
-  update_nbbo |= UpdateNbboSide(entry, NbboSide::OFFER, exch_idx, bbo.offer);
-  if (update_nbbo && record_type == RecordType::NbboPrice) {
-    Taq::NbboPrice record(MkTaqTime(timestamp), entry.current_nbbo.bid.price, entry.current_nbbo.offer.price);
-    os.write((const char*)&record, sizeof(record));
-  } else if (update_nbbo && record_type == RecordType::Nbbo) {
-    Taq::Nbbo record(MkTaqTime(timestamp),
-      entry.current_nbbo.bid.price, entry.current_nbbo.offer.price,
-      entry.current_nbbo.bid.size, entry.current_nbbo.offer.size);
-    os.write((const char*)&record, sizeof(record));
+static void TrackNbbo(QuoteActivity & activity, int64_t time, const Nbbo & nbbo) {
+  AddSpreadTime(activity, time);
+  DailySummary::Quotes & quotes = activity.summary.quotes;
+  quotes.nbbo_cnt++;
+  quotes.session_nbbo_cnt += time >= DailySummary::REGULAR_OPEN && time < DailySummary::REGULAR_CLOSE ? 1 : 0;
+  const int64_t bidp = MkPriceTicks(nbbo.bid.price);
+  const int64_t askp = MkPriceTicks(nbbo.offer.price);
+  activity.spread = nbbo.bid.size > 0 && nbbo.offer.size > 0 && askp >= bidp ? askp - bidp : -1;
+  activity.last_change = time;
+}
+
+// the grid times before time take the last NBBO so far; a grid time is only taken once a later record comes, so it gets
+// the last of the records at that very time
+static void FillSnapshot(const SnapshotGrid & grid, QuoteActivity & activity, int64_t time) {
+  while (activity.snapshot.size() < grid.time_cnt && grid.Time(activity.snapshot.size()) < time) {
+    activity.snapshot.push_back(activity.nbbo ? *activity.nbbo : Taq::Nbbo(SnapshotGrid::NO_NBBO, 0, 0, 0, 0));
   }
-  return update_nbbo;
 }
 
-static bool ValidateInputRecord(const vector<string> & row) {
+static void TrackSnapshot(const SnapshotGrid & grid, QuoteActivity & activity, int64_t time, const Nbbo & nbbo) {
+  FillSnapshot(grid, activity, time);
+  activity.nbbo.emplace(time, MkPriceTicks(nbbo.bid.price), MkPriceTicks(nbbo.offer.price), nbbo.bid.size,
+                        nbbo.offer.size);
+}
+
+static bool ValidateInputRecord(const PsvRow & row) {
   if (row[0] == "Time" || row[0] == "END" || row[0].size() == 0)
     return false;
   if (row.size() != QCOL_Max) {
@@ -191,42 +251,410 @@ static bool ValidateInputRecord(const vector<string> & row) {
   return true;
 }
 
-int ProcessQuotes(AppContext & ctx, istream & is) {
-  record_type = RecordTypeFromString(ctx.input_type);
-  vector<SymbolMap> symbol_map;
-  SymbolMap * current = nullptr;
-  int rec_cnt = 0;
-  ctx.output.write((const char*)&ctx.output_file_hdr, sizeof(ctx.output_file_hdr));
-  while (false == is.eof()) {
-    string line;
-    getline(is, line);
-    vector<string> row;
-    boost::split(row, line, boost::is_any_of("|"));
-    if (ValidateInputRecord(row)) {
-      Bbo bbo(row);
-      ValidateQuote(row, bbo);
-      if (UpdateNbbo(row[QCOL_Time], row[QCOL_Symbol], row[QCOL_Exchange], bbo, ctx.output)) {
-        rec_cnt++;
-        if (!current || current->symb != row[QCOL_Symbol]) {
-          if (current) {
-            current->end = rec_cnt - 1;
+static void ProcessQuote(QuoteShard & shard, const PsvRow & row, const vector<ostream*> & os) {
+  Bbo bbo(row);
+  ValidateQuote(row, bbo);
+  const Nbbo * nbbo = nullptr;
+  const SymbolId symbol_id = shard.symbols.Intern(row[QCOL_Symbol]);
+  const char exchange = row[QCOL_Exchange][0];
+  const int changes = UpdateNbbo(shard, symbol_id, exchange, bbo, nbbo);
+  if (symbol_id == shard.activity.size()) {
+    shard.activity.emplace_back();
+    DailySummary & summary = shard.activity.back().summary;
+    memcpy(summary.symb, row[QCOL_Symbol].data(), min(row[QCOL_Symbol].size(), sizeof(Symbol) - 1));
+    summary.parts = DailySummary::QUOTES;
+  }
+  QuoteActivity & activity = shard.activity[symbol_id];
+  activity.summary.quotes.quote_cnt++;
+  if (changes) {
+    const int64_t time = MkTaqNanos(row[QCOL_Time]);
+    if (changes & (NBBO_PRICE_CHANGE | NBBO_SIZE_CHANGE)) {
+      TrackNbbo(activity, time, *nbbo);
+      if (shard.grid.time_cnt) {
+        TrackSnapshot(shard.grid, activity, time, *nbbo);
+      }
+    }
+    WriteNbbo(shard, changes, time, row[QCOL_Symbol], symbol_id, *nbbo, exchange, bbo, os);
+  }
+}
+
+static void ProcessQuoteRow(QuoteShard & shard, const PsvRow & row, const vector<ostream*> & os) {
+  if (ValidateInputRecord(row)) {
+    ProcessQuote(shard, row, os);
+  }
+}
+
+static void FinishQuoteShard(QuoteShard & shard, const vector<ostream*> & os) {
+  for (QuoteActivity & activity : shard.activity) {
+    AddSpreadTime(activity, DailySummary::REGULAR_CLOSE);
+    shard.summaries.push_back(activity.summary);
+    if (shard.grid.time_cnt) {
+      FillSnapshot(shard.grid, activity, numeric_limits<int64_t>::max());
+      shard.snapshots.push_back(SnapshotColumn{activity.summary.symb, move(activity.snapshot)});
+    }
+  }
+  for (size_t i = 0; i < shard.products.size(); i++) {
+    QuoteProduct & product = shard.products[i];
+    if (product.symbol_map.size()) {
+      product.symbol_map.rbegin()->end = product.rec_cnt;
+      product.writer.Finish(*os[i]);
+    }
+  }
+}
+
+static void AddSummaries(AppContext & ctx, QuoteShard & shard) {
+  ctx.summaries.insert(ctx.summaries.end(), shard.summaries.begin(), shard.summaries.end());
+  move(shard.snapshots.begin(), shard.snapshots.end(), back_inserter(ctx.snapshots));
+  shard.snapshots.clear();
+}
+
+static void AppendQuoteShard(vector<QuoteProduct> & products, const QuoteShard & shard) {
+  for (size_t i = 0; i < products.size(); i++) {
+    QuoteProduct & product = products[i];
+    for (SymbolMap sm : shard.products[i].symbol_map) {
+      sm.start += product.rec_cnt;
+      sm.end += product.rec_cnt;
+      product.symbol_map.push_back(sm);
+    }
+    product.rec_cnt += shard.products[i].rec_cnt;
+    product.writer.Append(shard.products[i].writer);
+  }
+}
+
+static vector<ostream*> OutputStreams(AppContext & ctx) {
+  vector<ostream*> os;
+  for (OutputFile & output : ctx.outputs) {
+    output.WriteHeader();
+    os.push_back(&output.stream);
+  }
+  return os;
+}
+
+static void FinishQuoteFiles(AppContext & ctx, const vector<QuoteProduct> & products) {
+  for (size_t i = 0; i < products.size(); i++) {
+    OutputFile & output = ctx.outputs[i];
+    products[i].writer.WriteTrailer(output.stream, products[i].symbol_map);
+    output.hdr.symb_cnt = (int64_t)products[i].symbol_map.size();
+    output.hdr.rec_cnt = products[i].rec_cnt;
+    output.hdr.type = products[i].type;
+  }
+}
+
+int ProcessQuotes(AppContext & ctx, const InputReader & input) {
+  QuoteShard shard(ctx);
+  const vector<ostream*> os = OutputStreams(ctx);
+  input([&](const PsvRow & row) { ProcessQuoteRow(shard, row, os); });
+  FinishQuoteShard(shard, os);
+  FinishQuoteFiles(ctx, shard.products);
+  AddSummaries(ctx, shard);
+  return 0;
+}
+
+// records of one partition within a chunk, buffered per product
+struct QuoteSegment {
+  string group;
+  string first_symbol;   // in sort order
+  string last_symbol;
+  QuoteShard shard;
+  vector<stringstream> buffers;     // read back into the output files, so opened in and out
+  vector<ostream*> os;
+  QuoteSegment(const AppContext & ctx, const string & group) : group(group), shard(ctx), buffers(ctx.outputs.size()) {
+    for (auto & buffer : buffers) {
+      os.push_back(&buffer);
+    }
+  }
+};
+
+// input that cannot be split by byte offset (compressed or whole-day) is cut into chunks at symbol boundaries;
+// chunks are processed concurrently and their records are appended in input order; with --symbol-group all each
+// partition's files are finished when the next partition starts
+static int ProcessQuoteChunks(AppContext & ctx, const function<void(const ChunkConsumer &)> & read_chunks) {
+  typedef vector<QuoteSegment> QuoteChunk;
+  deque<future<QuoteChunk>> pending;
+  vector<QuoteProduct> products = QuoteShard(ctx).products;
+  vector<ostream*> os;
+  set<string> finished_groups;
+  string open_group;
+  uint64_t input_offset = 0;
+  if (false == ctx.all_symbol_groups) {
+    os = OutputStreams(ctx);
+    open_group = ctx.symb;
+  }
+  auto switch_group = [&](const string & group) {
+    if (open_group.size()) {
+      FinishQuoteFiles(ctx, products);
+      CloseOutputFiles(ctx);
+      finished_groups.insert(open_group);
+    }
+    if (finished_groups.count(group)) {
+      throw(domain_error("Input is not ordered by symbol group: " + group));
+    }
+    OpenOutputFiles(ctx, group);
+    os = OutputStreams(ctx);
+    products = QuoteShard(ctx).products;
+    open_group = group;
+  };
+  auto append_chunk = [&]() {
+    QuoteChunk chunk = pending.front().get();
+    pending.pop_front();
+    for (QuoteSegment & segment : chunk) {
+      if (segment.group != open_group) {
+        switch_group(segment.group);
+      }
+      if (ctx.all_symbol_groups) {
+        AddToPartition(ctx, segment.group, segment.first_symbol, segment.last_symbol);
+      }
+      for (size_t i = 0; i < os.size(); i++) {
+        if (segment.buffers[i].tellp() > 0) {   // inserting an empty buffer would set failbit
+          *os[i] << segment.buffers[i].rdbuf();
+        }
+      }
+      AppendQuoteShard(products, segment.shard);
+      AddSummaries(ctx, segment.shard);
+    }
+  };
+  read_chunks([&](InputChunk && input) {
+    if (pending.size() >= (size_t)ctx.thread_cnt) {
+      append_chunk();
+    }
+    const uint64_t offset = input_offset;
+    input_offset += input.size();
+    pending.push_back(async(launch::async, [&ctx, offset, input = move(input)]() {
+      QuoteChunk chunk;
+      string last_symbol;
+      ReadInputChunk(input, [&](const PsvRow & row, uint64_t row_offset) {
+        if (ValidateInputRecord(row)) {
+          const PsvField symbol = row[QCOL_Symbol];
+          if (chunk.empty() || last_symbol != symbol) {
+            const string group = ctx.all_symbol_groups ? SymbolPartition(ctx, symbol, offset + row_offset) : ctx.symb;
+            if (chunk.empty() || chunk.back().group != group) {
+              chunk.emplace_back(ctx, group);
+              chunk.back().first_symbol = symbol;
+              chunk.back().last_symbol = symbol;
+            }
+            last_symbol = symbol;
+            chunk.back().first_symbol = min<string_view>(chunk.back().first_symbol, symbol);
+            chunk.back().last_symbol = max<string_view>(chunk.back().last_symbol, symbol);
           }
-          symbol_map.push_back(SymbolMap(row[QCOL_Symbol], rec_cnt, 0));
-          current = &*symbol_map.rbegin();
+          ProcessQuote(chunk.back().shard, row, chunk.back().os);
         }
+      });
+      for (QuoteSegment & segment : chunk) {
+        FinishQuoteShard(segment.shard, segment.os);
       }
+      return chunk;
+    }));
+  });
+  while (pending.size()) {
+    append_chunk();
+  }
+  if (open_group.size()) {
+    FinishQuoteFiles(ctx, products);
+  }
+  return 0;
+}
+
+int ProcessQuoteStream(AppContext & ctx, istream & is) {
+  return ProcessQuoteChunks(ctx, [&](const ChunkConsumer & consumer) {
+    ReadInputStreamChunks(is, QUOTE_CHUNK_SIZE, QCOL_Symbol, consumer);
+  });
+}
+
+int ProcessQuoteBlocks(AppContext & ctx, const BlockReader & reader) {
+  return ProcessQuoteChunks(ctx, [&](const ChunkConsumer & consumer) {
+    ReadInputBlockChunks(reader, QUOTE_CHUNK_SIZE, QCOL_Symbol, consumer);
+  });
+}
+
+int ProcessQuoteFiles(AppContext & ctx) {
+  if (ctx.all_symbol_groups || IsCompressedInput(ctx.input_files)) {
+    return ProcessQuoteChunks(ctx, [&](const ChunkConsumer & consumer) {
+      ReadInputChunks(ctx.input_files, QUOTE_CHUNK_SIZE, QCOL_Symbol, consumer);
+    });
+  }
+  const vector<InputShard> input_shards = SplitInputFiles(ctx.input_files, ctx.thread_cnt, QCOL_Symbol);
+  const vector<ostream*> os = OutputStreams(ctx);
+  if (input_shards.size() <= 1) {
+    QuoteShard shard(ctx);
+    for (const InputShard & input : input_shards) {
+      ReadInputShard(input, [&](const PsvRow & row) { ProcessQuoteRow(shard, row, os); });
     }
+    FinishQuoteShard(shard, os);
+    FinishQuoteFiles(ctx, shard.products);
+    AddSummaries(ctx, shard);
+    return 0;
   }
-  if (current) {
-    current->end = rec_cnt;
+  // shards never split a symbol, so each worker keeps its own NBBO table and spools records to temporary files;
+  // the spooled blocks are then appended in input order, which reproduces the single-threaded record sequence
+  vector<QuoteShard> shards;
+  for (size_t i = 0; i < input_shards.size(); i++) {
+    shards.emplace_back(ctx);
   }
-  for (const auto & sm : symbol_map) {
-    ctx.output.write((const char*)&sm, sizeof(sm));
+  vector<vector<string>> spool_files(input_shards.size());
+  vector<string> errors(input_shards.size());
+  vector<thread> workers;
+  for (size_t i = 0; i < input_shards.size(); i++) {
+    for (const OutputFile & output : ctx.outputs) {
+      spool_files[i].push_back(output.path + ".shard." + to_string(i));
+    }
+    workers.push_back(thread([&, i]() {
+      try {
+        vector<ofstream> spools;
+        vector<ostream*> spool_os;
+        for (const string & spool_file : spool_files[i]) {
+          spools.emplace_back(spool_file, ios::out | ios::binary);
+        }
+        for (auto & spool : spools) {
+          spool_os.push_back(&spool);
+        }
+        ReadInputShard(input_shards[i], [&](const PsvRow & row) { ProcessQuoteRow(shards[i], row, spool_os); });
+        FinishQuoteShard(shards[i], spool_os);
+      } catch (const exception & ex) {
+        errors[i] = ex.what();
+      }
+    }));
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+  vector<QuoteProduct> products = QuoteShard(ctx).products;
+  for (size_t i = 0; i < shards.size(); i++) {
+    for (size_t j = 0; j < os.size(); j++) {
+      if (errors[i].empty() && shards[i].products[j].rec_cnt) {
+        ifstream is(spool_files[i][j], ios::in | ios::binary);
+        *os[j] << is.rdbuf();
+      }
+      fs::remove(spool_files[i][j]);
+    }
+    AppendQuoteShard(products, shards[i]);
+    AddSummaries(ctx, shards[i]);
+  }
+  for (const string & error : errors) {
+    if (error.size()) {
+      throw(domain_error(error));
+    }
   }
-  ctx.output_file_hdr.symb_cnt = (int)symbol_map.size();
-  ctx.output_file_hdr.rec_cnt = rec_cnt;
-  ctx.output_file_hdr.type = record_type;
+  FinishQuoteFiles(ctx, products);
   return 0;
 }
 
+// the NBBO changes of each symbol of a chunk, as the nbbo file records them; a chunk never splits a symbol
+static vector<pair<string, vector<Taq::Nbbo>>> ComputeNbboTimelines(const InputChunk & input) {
+  vector<pair<string, vector<Taq::Nbbo>>> timelines;
+  unique_ptr<NbboTableEntry> entry;
+  ReadInputChunk(input, [&](const PsvRow & row, uint64_t) {
+    if (false == ValidateInputRecord(row)) {
+      return;
+    }
+    const PsvField symbol = row[QCOL_Symbol];
+    if (timelines.empty() || timelines.back().first != symbol) {
+      if (timelines.size() && timelines.back().first > symbol) {
+        throw(domain_error("Quote input is not ordered by symbol: " + string(symbol)));
+      }
+      timelines.emplace_back(string(symbol), vector<Taq::Nbbo>());
+      entry = make_unique<NbboTableEntry>();
+    }
+    Bbo bbo(row);
+    ValidateQuote(row, bbo);
+    const int exch_idx = row[QCOL_Exchange][0] - 'A';
+    const int changes = UpdateNbboSide(*entry, NbboSide::BID, exch_idx, bbo.bid)
+                      | UpdateNbboSide(*entry, NbboSide::OFFER, exch_idx, bbo.offer);
+    if (changes) {
+      const Nbbo & nbbo = entry->current_nbbo;
+      timelines.back().second.emplace_back(MkTaqNanos(row[QCOL_Time]), MkPriceTicks(nbbo.bid.price),
+                                           MkPriceTicks(nbbo.offer.price), nbbo.bid.size, nbbo.offer.size);
+    }
+  });
+  return timelines;
+}
+
+// a reader thread cuts the quote files into chunks and queues a worker per chunk; Take consumes the chunks in order
+struct PrevailingQuotes::State {
+  struct Cancelled {};
+  typedef vector<pair<string, vector<Taq::Nbbo>>> Timelines;
+  size_t depth;
+  deque<future<Timelines>> chunks;
+  Timelines current;                // of the chunk being taken from
+  size_t current_pos = 0;
+  string last_symbol;               // of the quotes taken so far
+  bool done = false;
+  bool cancelled = false;
+  exception_ptr error;
+  mutex mtx;
+  condition_variable cv;
+  thread reader;
+};
+
+PrevailingQuotes::PrevailingQuotes(const vector<string> & quote_files, int thread_cnt) : state_(make_unique<State>()) {
+  State & state = *state_;
+  state.depth = (size_t)max(thread_cnt, 1) + 1;
+  state.reader = thread([&state, quote_files]() {
+    try {
+      ReadInputChunks(quote_files, QUOTE_CHUNK_SIZE, QCOL_Symbol, [&](InputChunk && input) {
+        unique_lock<mutex> lock(state.mtx);
+        state.cv.wait(lock, [&]() { return state.chunks.size() < state.depth || state.cancelled; });
+        if (state.cancelled) {
+          throw State::Cancelled();
+        }
+        state.chunks.push_back(async(launch::async, [input = move(input)]() { return ComputeNbboTimelines(input); }));
+        state.cv.notify_all();
+      });
+    } catch (const State::Cancelled &) {
+    } catch (const exception & ex) {
+      lock_guard<mutex> lock(state.mtx);
+      state.error = make_exception_ptr(domain_error(string("Quote input: ") + ex.what()));
+    }
+    lock_guard<mutex> lock(state.mtx);
+    state.done = true;
+    state.cv.notify_all();
+  });
+}
+
+PrevailingQuotes::~PrevailingQuotes() {
+  {
+    lock_guard<mutex> lock(state_->mtx);
+    state_->cancelled = true;
+  }
+  state_->cv.notify_all();
+  state_->reader.join();
+}
+
+NbboTimelines PrevailingQuotes::Take(const string & first, const string & last) {
+  State & state = *state_;
+  NbboTimelines timelines;
+  while (true) {
+    if (state.current_pos == state.current.size()) {
+      future<State::Timelines> chunk;
+      {
+        unique_lock<mutex> lock(state.mtx);
+        state.cv.wait(lock, [&]() { return state.chunks.size() || state.done; });
+        if (state.chunks.empty()) {
+          if (state.error) {
+            rethrow_exception(state.error);
+          }
+          return timelines;
+        }
+        chunk = move(state.chunks.front());
+        state.chunks.pop_front();
+        state.cv.notify_all();
+      }
+      state.current = chunk.get();
+      state.current_pos = 0;
+      continue;
+    }
+    auto & timeline = state.current[state.current_pos];
+    if (timeline.first > last) {
+      return timelines;
+    }
+    if (state.last_symbol.size() && timeline.first <= state.last_symbol) {
+      throw(domain_error("Quote input is not ordered by symbol: " + timeline.first));
+    }
+    state.last_symbol = timeline.first;
+    if (timeline.first >= first) {
+      timelines.insert(move(timeline));
+    }
+    state.current_pos++;
+  }
+}
+
 }
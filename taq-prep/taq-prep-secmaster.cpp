@@ -1,7 +1,7 @@
 
 
 #include <algorithm>
-#include "boost-algorithm-string.h"
+#include <cstring>
 
 #include "taq-prep.h"
 
@@ -10,46 +10,41 @@ using namespace Taq;
 
 namespace taq_prep {
 
- static void StringCopy(char* desc, const char* src, size_t len) {
-#ifdef _MSC_VER
-  strncpy_s(desc, len, src, len - 1);
-#else
-  strncpy(desc, src, len - 1);
-#endif
+ static void StringCopy(char* desc, string_view src, size_t len) {
+  memcpy(desc, src.data(), min(src.size(), len - 1));
   }
 
-int ProcessSecMaster(AppContext & ctx, istream & is) {
+int ProcessSecMaster(AppContext & ctx, const InputReader & input) {
   int cnt = 0;
   cnt++;
   vector<Security> sec_list;
-  while(!is.eof()) {
-    string line;
-    getline(is, line);
-    vector<string> row;
-    boost::split(row, line, boost::is_any_of("|"));
-    if (row[MCOL_Symbol] == "Symbol")
-      continue;
-    if (row[0] == "END")
-      break;
+  bool done = false;
+  input([&](const PsvRow & row) {
+    if (done || row[MCOL_Symbol] == "Symbol")
+      return;
+    if (row[0] == "END") {
+      done = true;
+      return;
+    }
     sec_list.push_back(Security());
     Security & sec =*sec_list.rbegin();
     try {
       memset((void *)&sec, 0, sizeof(sec));
 
-      StringCopy(sec.symb, row[MCOL_Symbol].c_str(), sizeof(sec.symb));
-      StringCopy(sec.CUSIP, row[MCOL_CUSIP].c_str(), sizeof(sec.CUSIP));
-      StringCopy(sec.type, row[MCOL_Security_Type].c_str(), sizeof(sec.type));
-      StringCopy(sec.sip_symb, row[MCOL_SIP_Symbol].c_str(), sizeof(sec.sip_symb));
-      StringCopy(sec.prev_symb, row[MCOL_Old_Symbol].c_str(), sizeof(sec.prev_symb));
-      StringCopy(sec.industry_code, row[MCOL_NYSE_Industry_Code].c_str(), sizeof(sec.industry_code));
+      StringCopy(sec.symb, row[MCOL_Symbol], sizeof(sec.symb));
+      StringCopy(sec.CUSIP, row[MCOL_CUSIP], sizeof(sec.CUSIP));
+      StringCopy(sec.type, row[MCOL_Security_Type], sizeof(sec.type));
+      StringCopy(sec.sip_symb, row[MCOL_SIP_Symbol], sizeof(sec.sip_symb));
+      StringCopy(sec.prev_symb, row[MCOL_Old_Symbol], sizeof(sec.prev_symb));
+      StringCopy(sec.industry_code, row[MCOL_NYSE_Industry_Code], sizeof(sec.industry_code));
 
       sec.test_flag = row[MCOL_Test_Symbol_Flag][0];
       sec.exch = row[MCOL_Listed_Exchange][0];
       sec.tape = row[MCOL_Tape][0];
       sec.halt_reason = row[MCOL_Halt_Delay_Reason][0];
-      sec.trd_unit = (uint8_t)stoi(row[MCOL_Unit_Of_Trade]);
-      sec.lot_size = (uint8_t)stoi(row[MCOL_Round_Lot]);
-      sec.shares_outstanding_m = row[MCOL_Shares_Outstanding].empty() ? .0 : stod(row[MCOL_Shares_Outstanding]);
+      sec.trd_unit = (uint8_t)ParseInt(row[MCOL_Unit_Of_Trade]);
+      sec.lot_size = (uint8_t)ParseInt(row[MCOL_Round_Lot]);
+      sec.shares_outstanding_m = row[MCOL_Shares_Outstanding].empty() ? .0 : ParseDouble(row[MCOL_Shares_Outstanding]);
 
       sec.exch_mask.set(Exch_A, row[MCOL_TradedOnNYSEMKT][0]);
       sec.exch_mask.set(Exch_B, row[MCOL_TradedOnNASDAQBX][0]);
@@ -80,19 +75,20 @@ int ProcessSecMaster(AppContext & ctx, istream & is) {
       if (MCOL_TradedOnMIAX < (int)row.size()) {
         sec.exch_mask.set(Exch_H, row[MCOL_TradedOnMIAX][0]);
       }
-      const string utp_symb = sec.tape == 'C' ? row[MCOL_SIP_Symbol] : CtaToUtp(row[MCOL_Symbol]);
-      StringCopy(sec.utp_symb, utp_symb.c_str(), sizeof(sec.utp_symb));
+      const string utp_symb = sec.tape == 'C' ? string(row[MCOL_SIP_Symbol]) : CtaToUtp(string(row[MCOL_Symbol]));
+      StringCopy(sec.utp_symb, utp_symb, sizeof(sec.utp_symb));
     } catch (exception &ex) {
-      cerr << line << endl;
+      cerr << row.Line() << endl;
       cerr << "record-cnt:" << sec_list.size() << " err-text" << ex.what() << endl;
     }
-  }
-  ctx.output_file_hdr.symb_cnt = (int)sec_list.size();
-  ctx.output_file_hdr.rec_cnt = (int)sec_list.size();
-  ctx.output_file_hdr.type = RecordType::SecMaster;
-  ctx.output.write((const char*)&ctx.output_file_hdr, sizeof(ctx.output_file_hdr));
+  });
+  OutputFile & output = ctx.outputs.front();
+  output.hdr.symb_cnt = (int64_t)sec_list.size();
+  output.hdr.rec_cnt = (int64_t)sec_list.size();
+  output.hdr.type = RecordType::SecMaster;
+  output.WriteHeader();
   for (const Security& sec_out : sec_list) {
-    ctx.output.write((const char*)&sec_out, sizeof(sec_out));
+    output.stream.write((const char*)&sec_out, sizeof(sec_out));
   }
   return 0;
 }
@@ -0,0 +1,342 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <boost/filesystem.hpp>
+
+#include "taq-prep.h"
+#include "taq-parse.h"
+
+using namespace std;
+using namespace Taq;
+namespace fs = boost::filesystem;
+
+namespace taq_prep {
+
+// the file buffer of each run open in a merge, and of the run being written, comes out of the memory budget: a budget
+// too small for MAX_MERGE_RUNS buffers of RUN_BUFFER_SIZE merges fewer runs at a time, in more passes, with buffers no
+// smaller than MIN_RUN_BUFFER_SIZE
+static const size_t RUN_BUFFER_SIZE = 1024 * 1024;
+static const size_t MIN_RUN_BUFFER_SIZE = 256 * 1024;
+static const size_t MAX_MERGE_RUNS = 64;
+
+struct SortKey {
+  string_view symbol;
+  int64_t time;       // -1 when not a TAQ time, which downstream validation rejects anyway
+  uint64_t seq;
+};
+
+static bool operator<(const SortKey & lhs, const SortKey & rhs) {
+  if (lhs.symbol != rhs.symbol) {
+    return lhs.symbol < rhs.symbol;
+  }
+  if (lhs.time != rhs.time) {
+    return lhs.time < rhs.time;
+  }
+  return lhs.seq < rhs.seq;
+}
+
+static int64_t SortTime(string_view text) {
+  int64_t nanos;
+  return ParseTaqTime(text, nanos) ? nanos : -1;
+}
+
+static uint64_t SortSequence(string_view text) {
+  uint64_t seq = 0;
+  from_chars(text.data(), text.data() + text.size(), seq);
+  return seq;
+}
+
+// first eight bytes of the symbol, zero padded, in an integer that compares like the text
+static uint64_t SymbolPrefix(string_view symbol) {
+  uint64_t prefix = 0;
+  for (size_t i = 0; i < sizeof(prefix); i++) {
+    prefix = (prefix << 8) | (i < symbol.size() ? (uint8_t)symbol[i] : 0);
+  }
+  return prefix;
+}
+
+// row of the batch being collected; the symbol is kept as an offset since the batch buffer may still move, and its
+// prefix decides most comparisons without touching the batch buffer
+struct BatchRow {
+  size_t offset;
+  uint32_t size;
+  uint32_t symbol_offset;
+  uint32_t symbol_size;
+  uint64_t symbol_prefix;
+  int64_t time;
+  uint64_t seq;
+};
+
+// sorted run spilled to disk, read back one line at a time
+struct SortRun {
+  ifstream is;
+  vector<char> buffer;
+  string line;
+  SortKey key;
+};
+
+struct ExternalSort::State {
+  string tmp_dir;
+  size_t merge_fan_in;          // runs merged at a time
+  size_t run_buffer_size;
+  size_t batch_budget;          // of the batch, less the buffer it is spilled through
+  int symbol_column;
+  int time_column;
+  int seq_column;
+  vector<char> batch;
+  vector<BatchRow> rows;
+  vector<string> run_paths;
+  vector<string> merge_paths;   // runs written by the merge pass in progress
+  vector<unique_ptr<SortRun>> runs;
+  vector<size_t> heap;          // indexes of runs with a current line, as a min-heap on (key, run index)
+  bool reading = false;
+  size_t next_row = 0;          // next row of the in-memory batch when nothing was spilled
+  string line;                  // current output line and the part of it not yet read
+  size_t line_pos = 0;
+
+  SortKey Key(const BatchRow & row) const {
+    return SortKey{string_view(batch.data() + row.offset + row.symbol_offset, row.symbol_size), row.time, row.seq};
+  }
+
+  SortKey LineKey(string_view line) const {
+    SortKey key{string_view(), -1, 0};
+    for (int col = 0; ; col++) {
+      const size_t sep = line.find('|');
+      const string_view field = line.substr(0, sep);
+      if (col == symbol_column) {
+        key.symbol = field;
+      } else if (col == time_column) {
+        key.time = SortTime(field);
+      } else if (col == seq_column) {
+        key.seq = SortSequence(field);
+      }
+      if (sep == string_view::npos) {
+        break;
+      }
+      line.remove_prefix(sep + 1);
+    }
+    return key;
+  }
+
+  bool RowLess(const BatchRow & lhs, const BatchRow & rhs) const {
+    if (lhs.symbol_prefix != rhs.symbol_prefix) {
+      return lhs.symbol_prefix < rhs.symbol_prefix;
+    }
+    if (lhs.symbol_size > sizeof(lhs.symbol_prefix) || rhs.symbol_size > sizeof(rhs.symbol_prefix)) {
+      return Key(lhs) < Key(rhs);
+    }
+    return lhs.time != rhs.time ? lhs.time < rhs.time : lhs.seq < rhs.seq;
+  }
+
+  void SortBatch() {
+    stable_sort(rows.begin(), rows.end(), [this](const BatchRow & lhs, const BatchRow & rhs) { return RowLess(lhs, rhs); });
+  }
+
+  string RunPath() const {
+    return (fs::path(tmp_dir) / fs::unique_path("taq-prep-%%%%-%%%%-%%%%.sort")).string();
+  }
+
+  void Spill() {
+    SortBatch();
+    const string path = RunPath();
+    run_paths.push_back(path);
+    ofstream os(path, ios::out | ios::binary);
+    vector<char> buffer(run_buffer_size);
+    os.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    for (const BatchRow & row : rows) {
+      os.write(batch.data() + row.offset, row.size);
+    }
+    if (false == os.flush().good()) {
+      throw(domain_error("Failed to write sort run: " + path));
+    }
+    batch.clear();
+    rows.clear();
+  }
+
+  bool Advance(SortRun & run) {
+    if (false == bool(getline(run.is, run.line))) {
+      return false;
+    }
+    run.key = LineKey(run.line);
+    return true;
+  }
+
+  bool HeapLess(size_t lhs, size_t rhs) const {   // std heaps put the greatest element first
+    const SortKey & lkey = runs[lhs]->key;
+    const SortKey & rkey = runs[rhs]->key;
+    return rkey < lkey || (false == (lkey < rkey) && rhs < lhs);
+  }
+
+  void OpenRuns(vector<string>::const_iterator first, vector<string>::const_iterator last) {
+    runs.clear();
+    heap.clear();
+    for (auto path = first; path != last; path++) {
+      unique_ptr<SortRun> run(new SortRun());
+      run->buffer.resize(run_buffer_size);
+      run->is.rdbuf()->pubsetbuf(run->buffer.data(), run->buffer.size());
+      run->is.open(*path, ios::in | ios::binary);
+      runs.push_back(move(run));
+      if (Advance(*runs.back())) {
+        heap.push_back(runs.size() - 1);
+      }
+    }
+    make_heap(heap.begin(), heap.end(), [this](size_t lhs, size_t rhs) { return HeapLess(lhs, rhs); });
+  }
+
+  // next line of the open runs, without its newline
+  bool MergeLine(string & merged) {
+    if (heap.empty()) {
+      return false;
+    }
+    auto heap_less = [this](size_t lhs, size_t rhs) { return HeapLess(lhs, rhs); };
+    pop_heap(heap.begin(), heap.end(), heap_less);
+    SortRun & run = *runs[heap.back()];
+    merged.swap(run.line);
+    if (Advance(run)) {
+      push_heap(heap.begin(), heap.end(), heap_less);
+    } else {
+      heap.pop_back();
+    }
+    return true;
+  }
+
+  // one pass merges each group of up to merge_fan_in consecutive runs into a run at the group's place, so that runs
+  // stay in input order and equal keys with them
+  void MergePass() {
+    for (size_t first = 0; first < run_paths.size(); first += merge_fan_in) {
+      const size_t last = min(first + merge_fan_in, run_paths.size());
+      if (last - first == 1) {
+        merge_paths.push_back(run_paths[first]);
+        continue;
+      }
+      OpenRuns(run_paths.begin() + first, run_paths.begin() + last);
+      const string path = RunPath();
+      merge_paths.push_back(path);
+      ofstream os(path, ios::out | ios::binary);
+      vector<char> buffer(run_buffer_size);
+      os.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+      string merged;
+      while (MergeLine(merged)) {
+        os.write(merged.data(), merged.size());
+        os.put('\n');
+      }
+      if (false == os.flush().good()) {
+        throw(domain_error("Failed to write sort run: " + path));
+      }
+      runs.clear();
+      for (size_t i = first; i < last; i++) {
+        boost::system::error_code ec;
+        fs::remove(run_paths[i], ec);
+      }
+    }
+    run_paths.swap(merge_paths);
+    merge_paths.clear();
+  }
+
+  void StartMerge() {
+    if (rows.size()) {
+      Spill();
+    }
+    vector<char>().swap(batch);       // the merge buffers have the budget to themselves
+    vector<BatchRow>().swap(rows);
+    while (run_paths.size() > merge_fan_in) {
+      MergePass();
+    }
+    OpenRuns(run_paths.begin(), run_paths.end());
+  }
+
+  bool NextLine() {
+    line.clear();
+    line_pos = 0;
+    if (run_paths.empty()) {
+      if (next_row == rows.size()) {
+        return false;
+      }
+      const BatchRow & row = rows[next_row++];
+      line.assign(batch.data() + row.offset, row.size);
+      return true;
+    }
+    if (false == MergeLine(line)) {
+      return false;
+    }
+    line.push_back('\n');
+    return true;
+  }
+};
+
+ExternalSort::ExternalSort(const string & tmp_dir, size_t memory_budget, int symbol_column, int time_column,
+                           int seq_column) : state_(new State()) {
+  state_->tmp_dir = tmp_dir;
+  // a merge pass holds merge_fan_in input buffers and one output buffer
+  state_->merge_fan_in = min(MAX_MERGE_RUNS, max<size_t>(3, memory_budget / MIN_RUN_BUFFER_SIZE) - 1);
+  state_->run_buffer_size = min(RUN_BUFFER_SIZE, memory_budget / (state_->merge_fan_in + 1));
+  state_->batch_budget = memory_budget - state_->run_buffer_size;
+  state_->symbol_column = symbol_column;
+  state_->time_column = time_column;
+  state_->seq_column = seq_column;
+}
+
+ExternalSort::~ExternalSort() {
+  state_->runs.clear();
+  for (const vector<string> * paths : { &state_->run_paths, &state_->merge_paths }) {
+    for (const string & path : *paths) {
+      boost::system::error_code ec;
+      fs::remove(path, ec);
+    }
+  }
+}
+
+void ExternalSort::Add(const PsvRow & row) {
+  State & state = *state_;
+  if (state.reading) {
+    throw(logic_error("ExternalSort: Add after Read"));
+  }
+  if (row[0] == "Time" || row[0] == "END" || row[0].size() == 0) {
+    return;
+  }
+  const string_view line = row.Line();
+  const PsvField symbol = row[state.symbol_column];
+  BatchRow batch_row;
+  batch_row.offset = state.batch.size();
+  batch_row.size = (uint32_t)line.size() + 1;
+  batch_row.symbol_offset = symbol.size() ? (uint32_t)(symbol.data() - line.data()) : 0;
+  batch_row.symbol_size = (uint32_t)symbol.size();
+  batch_row.symbol_prefix = SymbolPrefix(symbol);
+  batch_row.time = SortTime(row[state.time_column]);
+  batch_row.seq = SortSequence(row[state.seq_column]);
+  state.batch.insert(state.batch.end(), line.begin(), line.end());
+  state.batch.push_back('\n');
+  state.rows.push_back(batch_row);
+  if (state.batch.size() + state.rows.size() * sizeof(BatchRow) >= state.batch_budget) {
+    state.Spill();
+  }
+}
+
+size_t ExternalSort::Read(char * data, size_t size) {
+  State & state = *state_;
+  if (false == state.reading) {
+    state.reading = true;
+    if (state.run_paths.size()) {
+      state.StartMerge();
+    } else {
+      state.SortBatch();
+    }
+  }
+  size_t filled = 0;
+  while (filled < size) {
+    if (state.line_pos == state.line.size() && false == state.NextLine()) {
+      break;
+    }
+    const size_t cnt = min(size - filled, state.line.size() - state.line_pos);
+    memcpy(data + filled, state.line.data() + state.line_pos, cnt);
+    filled += cnt;
+    state.line_pos += cnt;
+  }
+  return filled;
+}
+
+}
@@ -0,0 +1,198 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+#include "taq-prep.h"
+
+using namespace std;
+using namespace Taq;
+namespace fs = boost::filesystem;
+namespace mm = boost::interprocess;
+
+namespace taq_prep {
+
+static bool SameSymbol(const Symbol& left, const Symbol& right) {
+  return 0 == strncmp(left, right, sizeof(Symbol));
+}
+
+// the records of an existing summary file built for the same sec master; others are started over
+static void ReadDailySummary(const fs::path & file_path, vector<DailySummary> & records) {
+  if (false == fs::exists(file_path)) {
+    return;
+  }
+  const size_t file_size = (size_t)fs::file_size(file_path);
+  const uint64_t slot_cnt = SymbolDirectorySlots(2 * records.size());
+  if (file_size != SummaryFileSize(FILE_VERSION_PACKED, records.size(), slot_cnt)) {
+    return;
+  }
+  mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
+  mm::mapped_region mmreg(mmfile, mm::read_only);
+  const char *base = (const char*)mmreg.get_address();
+  FileHeader fh(FILE_VERSION_PACKED);
+  if (false == ReadFileHeader(base, file_size, fh) || fh.type != RecordType::DailySummary
+      || fh.version != FILE_VERSION_PACKED || fh.symb_cnt != (int64_t)records.size()) {
+    return;
+  }
+  const DailySummary* existing = (const DailySummary*)(base + FileHeaderSize(fh.version));
+  for (size_t i = 0; i < records.size(); i++) {
+    if (false == SameSymbol(existing[i].symb, records[i].symb)
+        || false == SameSymbol(existing[i].utp_symb, records[i].utp_symb)) {
+      return;
+    }
+  }
+  memcpy((void*)records.data(), existing, records.size() * sizeof(DailySummary));
+}
+
+// the quote and trade passes of a day may run as separate, concurrent processes; each rewrites the summary file with
+// its own parts of the records of the symbols it saw, holding a lock on the day's sec master meanwhile
+void WriteDailySummary(AppContext & ctx) {
+  const Date date = MkTaqDate(ctx.date);
+  const fs::path master_path = MkDataFilePath(ctx.output_dir, RecordType::SecMaster, date);
+  if (false == (fs::exists(master_path) && fs::is_regular_file(master_path))) {
+    cerr << "SecMaster file not found, summary not written : " << master_path.string() << endl;
+    return;
+  }
+  // read before the lock is taken: closing the file would release the lock, which is held per process and file
+  LoadSecMaster(ctx);
+  mm::file_lock master_lock(master_path.string().c_str());
+  mm::scoped_lock<mm::file_lock> guard(master_lock);
+  const vector<Security> & securities = SecMasterSecurities();
+  vector<DailySummary> records(securities.size());
+  for (size_t i = 0; i < securities.size(); i++) {
+    memcpy(records[i].symb, securities[i].symb, sizeof(Symbol));
+    memcpy(records[i].utp_symb, securities[i].utp_symb, sizeof(Symbol));
+  }
+  OutputFile output(RecordType::DailySummary, FILE_VERSION_PACKED);
+  output.path = MkDataFilePath(ctx.output_dir, RecordType::DailySummary, date).string();
+  ReadDailySummary(output.path, records);
+  for (const DailySummary & summary : ctx.summaries) {
+    const SymbolId id = SecuritySymbolId(summary.symb);
+    if (id == SymbolTable::NO_SYMBOL) {
+      continue;
+    }
+    DailySummary & record = records[SecurityIndex(id)];
+    if (summary.parts & DailySummary::TRADES) {
+      record.trades = summary.trades;
+    }
+    if (summary.parts & DailySummary::QUOTES) {
+      record.quotes = summary.quotes;
+    }
+    record.parts |= summary.parts;
+  }
+  vector<uint32_t> slots(SymbolDirectorySlots(2 * records.size()));
+  BuildSummaryDirectory(records.data(), records.size(), slots.data(), slots.size());
+  const SymbolDirectoryFooter footer{slots.size()};
+  output.hdr.symb_cnt = (int64_t)records.size();
+  output.hdr.rec_cnt = (int64_t)records.size();
+  output.buffer.Open(output.path);
+  output.WriteHeader();
+  output.stream.write((const char*)records.data(), records.size() * sizeof(DailySummary));
+  output.stream.write((const char*)slots.data(), slots.size() * sizeof(uint32_t));
+  output.stream.write((const char*)&footer, sizeof(footer));
+  output.buffer.Commit();
+}
+
+// whether the existing snapshot file was built for the same sec master; a file of another grid is an error rather than
+// started over, which would drop the columns other runs built with that grid
+static bool MatchNbboSnapshot(const fs::path & file_path, const vector<Security> & securities, const SnapshotGrid & grid) {
+  if (false == fs::exists(file_path)) {
+    return false;
+  }
+  const size_t file_size = (size_t)fs::file_size(file_path);
+  if (file_size < FileHeaderSize(FILE_VERSION_PACKED) + sizeof(SnapshotGrid)) {
+    return false;
+  }
+  mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
+  mm::mapped_region mmreg(mmfile, mm::read_only);
+  const char *base = (const char*)mmreg.get_address();
+  FileHeader fh(FILE_VERSION_PACKED);
+  SnapshotGrid existing_grid;
+  memcpy(&existing_grid, base + file_size - sizeof(existing_grid), sizeof(existing_grid));
+  if (false == ReadFileHeader(base, file_size, fh) || fh.type != RecordType::NbboSnapshot
+      || fh.version != FILE_VERSION_PACKED || fh.symb_cnt != (int64_t)securities.size()
+      || file_size != SnapshotFileSize(FILE_VERSION_PACKED, securities.size(), existing_grid.time_cnt)) {
+    return false;
+  }
+  const char* rows = base + FileHeaderSize(fh.version);
+  const Symbol* symbols = (const Symbol*)(rows + securities.size() * existing_grid.time_cnt * sizeof(Nbbo));
+  for (size_t i = 0; i < securities.size(); i++) {
+    if (false == SameSymbol(symbols[i], securities[i].symb)) {
+      return false;
+    }
+  }
+  if (false == (existing_grid == grid)) {
+    ostringstream ss;
+    ss << "Snapshot file " << file_path.string() << " has a grid of " << existing_grid.interval / Bar::NANOS
+       << "s, --snapshot-interval must be the same for every quote run of the day";
+    throw domain_error(ss.str());
+  }
+  return true;
+}
+
+// a snapshot file at full size without any column built, published like the other output files
+static void CreateNbboSnapshot(const string & path, const vector<Security> & securities, const SnapshotGrid & grid) {
+  OutputFile output(RecordType::NbboSnapshot, FILE_VERSION_PACKED);
+  output.path = path;
+  const vector<Nbbo> row(securities.size(), Nbbo(SnapshotGrid::NO_COLUMN, 0, 0, 0, 0));
+  output.hdr.symb_cnt = (int64_t)securities.size();
+  output.hdr.rec_cnt = (int64_t)(securities.size() * grid.time_cnt);
+  output.buffer.Open(output.path);
+  output.WriteHeader();
+  for (size_t t = 0; t < grid.time_cnt; t++) {
+    output.stream.write((const char*)row.data(), row.size() * sizeof(Nbbo));
+  }
+  for (const Security & security : securities) {
+    output.stream.write(security.symb, sizeof(Symbol));
+  }
+  output.stream.write((const char*)&grid, sizeof(grid));
+  output.buffer.Commit();
+}
+
+// the day's snapshot file is created once, at full size, by the first quote run with a grid; each run then writes the
+// columns of the symbols it saw in place, holding the lock on the day's sec master like the summary writers, so a run
+// costs the pages of its own columns rather than a copy of the file; the rows stay contiguous, so a market-wide snapshot
+// is one read for tick-calc
+void WriteNbboSnapshot(AppContext & ctx) {
+  const Date date = MkTaqDate(ctx.date);
+  const fs::path master_path = MkDataFilePath(ctx.output_dir, RecordType::SecMaster, date);
+  if (false == (fs::exists(master_path) && fs::is_regular_file(master_path))) {
+    cerr << "SecMaster file not found, snapshot not written : " << master_path.string() << endl;
+    return;
+  }
+  LoadSecMaster(ctx);
+  mm::file_lock master_lock(master_path.string().c_str());
+  mm::scoped_lock<mm::file_lock> guard(master_lock);
+  const vector<Security> & securities = SecMasterSecurities();
+  const SnapshotGrid grid(ctx.snapshot_interval * Bar::NANOS);
+  vector<pair<size_t, const Nbbo*>> columns;
+  for (const SnapshotColumn & column : ctx.snapshots) {
+    const SymbolId id = SecuritySymbolId(column.symbol);
+    if (id != SymbolTable::NO_SYMBOL && column.records.size() == grid.time_cnt) {
+      columns.emplace_back(SecurityIndex(id), column.records.data());
+    }
+  }
+  sort(columns.begin(), columns.end());
+  const fs::path file_path = MkDataFilePath(ctx.output_dir, RecordType::NbboSnapshot, date);
+  if (false == MatchNbboSnapshot(file_path, securities, grid)) {
+    CreateNbboSnapshot(file_path.string(), securities, grid);
+  }
+  mm::file_mapping mmfile(file_path.string().c_str(), mm::read_write);
+  mm::mapped_region mmreg(mmfile, mm::read_write);
+  char* rows = (char*)mmreg.get_address() + FileHeaderSize(FILE_VERSION_PACKED);
+  const size_t row_size = securities.size() * sizeof(Nbbo);
+  for (size_t t = 0; t < grid.time_cnt; t++) {
+    for (const auto & column : columns) {
+      memcpy(rows + t * row_size + column.first * sizeof(Nbbo), column.second + t, sizeof(Nbbo));
+    }
+  }
+  mmreg.flush();
+}
+
+}
@@ -79,37 +79,101 @@ string CtaToUtp(const string & cta_symbol) {
   return symb.size() == 1 ? cta_symbol : symb[0] + NyseSuffixToNasdaq(symb[1]);
 }
 
-static map<string, char> symbol_primary_map;
+void SymbolTable::Add(string_view symbol, SymbolId id) {
+  names_.emplace_back(symbol);
+  ids_.emplace(names_.back(), id);
+}
+
+SymbolId SymbolTable::Intern(string_view symbol) {
+  if (last_id_ != NO_SYMBOL && last_symbol_ == symbol) {
+    return last_id_;
+  }
+  auto it = ids_.find(symbol);
+  if (it == ids_.end()) {
+    Add(symbol, size_);
+    it = ids_.find(symbol);
+    size_++;
+  }
+  last_symbol_ = it->first;
+  last_id_ = it->second;
+  return last_id_;
+}
+
+void SymbolTable::Alias(string_view symbol, SymbolId id) {
+  if (ids_.find(symbol) == ids_.end()) {
+    Add(symbol, id);
+  }
+}
+
+SymbolId SymbolTable::Find(string_view symbol) const {
+  auto it = ids_.find(symbol);
+  return it != ids_.end() ? it->second : NO_SYMBOL;
+}
+
+void SymbolTable::Clear() {
+  ids_.clear();
+  names_.clear();
+  size_ = 0;
+  last_id_ = NO_SYMBOL;
+  last_symbol_ = string_view();
+}
+
+// securities of the loaded master file; both the CTA and the UTP symbol resolve to the security's id and the first
+// security listing a symbol wins
+static SymbolTable security_symbols;
+static vector<char> primary_exchange;
+static vector<size_t> security_index;     // of the security of each id in the master file
+static vector<Security> securities;
 
 void LoadSecMaster(AppContext & ctx) {
-  symbol_primary_map.clear();
+  security_symbols.Clear();
+  primary_exchange.clear();
+  security_index.clear();
+  securities.clear();
   auto file_path = MkDataFilePath(ctx.output_dir, RecordType::SecMaster, MkTaqDate(ctx.date));
   if (false == (fs::exists(file_path) && fs::is_regular_file(file_path))) {
     throw domain_error("SecMaster file not found : " + file_path.string());
   }
   const size_t file_size = (size_t)fs::file_size(file_path);
-  if (file_size < sizeof(FileHeader)) {
+  if (file_size < sizeof(FileHeaderV1)) {
     throw domain_error("Input file size too small to accomodate header : " + file_path.string());
   }
   mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
   mm::mapped_region mmreg(mmfile, mm::read_only);
   const void *base = mmreg.get_address();
-  const FileHeader &fh = *(FileHeader*)base;
+  FileHeader fh(FILE_VERSION_PACKED);
+  if (false == ReadFileHeader((const char*)base, file_size, fh)) {
+    throw domain_error("Input file size too small to accomodate header : " + file_path.string());
+  }
   if (fh.type == RecordType::SecMaster) {
-    const Security* symbols = (const Security *)((char *)base + sizeof(FileHeader));
-    for (int i = 0; i < fh.symb_cnt; i++) {
+    const Security* symbols = (const Security *)((char *)base + FileHeaderSize(fh.version));
+    securities.assign(symbols, symbols + fh.symb_cnt);
+    for (int64_t i = 0; i < fh.symb_cnt; i++) {
       const Security& sec = symbols[i];
-      symbol_primary_map.insert(make_pair(sec.symb, sec.exch));
-      if (sec.symb != sec.utp_symb) {
-        symbol_primary_map.insert(make_pair(sec.utp_symb, sec.exch));
+      const SymbolId id = security_symbols.Intern(sec.symb);
+      if (id == primary_exchange.size()) {
+        primary_exchange.push_back(sec.exch);
+        security_index.push_back((size_t)i);
       }
+      security_symbols.Alias(sec.utp_symb, id);
     }
   }
 }
 
-char PrimaryExchange(const std::string symbol) {
-  auto it = symbol_primary_map.find(symbol);
-  return it != symbol_primary_map.end() ? it->second : '\0';
+SymbolId SecuritySymbolId(string_view symbol) {
+  return security_symbols.Find(symbol);
+}
+
+char PrimaryExchange(SymbolId symbol_id) {
+  return symbol_id < primary_exchange.size() ? primary_exchange[symbol_id] : '\0';
+}
+
+const vector<Security> & SecMasterSecurities() {
+  return securities;
+}
+
+size_t SecurityIndex(SymbolId symbol_id) {
+  return security_index.at(symbol_id);
 }
 
 
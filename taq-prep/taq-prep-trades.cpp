@@ -1,11 +1,13 @@
 
 
 #include <algorithm>
+#include <array>
 #include <set>
-#include <map>
+#include <deque>
+#include <future>
 #include <string>
 #include <sstream>
-#include "boost-algorithm-string.h"
+#include <cstring>
 
 #include "taq-prep.h"
 
@@ -14,122 +16,143 @@ using namespace Taq;
 
 namespace taq_prep {
 
-using SaleCondintionMap = map<char, pair<char, char>>;
-
-const SaleCondintionMap scond_by_src[] = {
-  { // CTA
-    {'C', {'N', 'Y'}},
-    {'B', {'N', 'Y'}},
-    {'E', {'Y', 'Y'}},
-    {'F', {'Y', 'Y'}},
-    {'H', {'N', 'Y'}},
-    {'I', {'N', 'Y'}},
-    {'K', {'Y', 'Y'}},
-    {'L', {'3', 'Y'}},
-    {'M', {'N', 'N'}},
-    {'N', {'N', 'Y'}},
-    {'O', {'1', 'Y'}},
-    {'P', {'2', 'Y'}},
-    {'Q', {'N', 'N'}},
-    {'R', {'N', 'Y'}},
-    {'T', {'N', 'Y'}},
-    {'U', {'N', 'Y'}},
-    {'V', {'N', 'Y'}},
-    {'X', {'Y', 'Y'}},
-    {'Z', {'2', 'Y'}},
-    {'4', {'2', 'Y'}},
-    {'5', {'Y', 'Y'}},
-    {'6', {'Y', 'Y'}},
-    {'7', {'N', 'Y'}},
-    {'8', {'N', 'N'}},
-    {'9', {'Y', 'N'}}
-  },
-  { // UTP
-    {'@', {'Y', 'Y'}},
-    {'A', {'Y', 'Y'}},
-    {'B', {'Y', 'Y'}},
-    {'C', {'N', 'Y'}},
-    {'D', {'Y', 'Y'}},
-    {'E', {'N', 'N'}},
-    {'F', {'Y', 'Y'}},
-    {'G', {'4', 'Y'}},
-    {'H', {'N', 'Y'}},
-    {'I', {'N', 'Y'}},
-    {'K', {'Y', 'Y'}},
-    {'L', {'5', 'Y'}},
-    {'M', {'N', 'N'}},
-    {'N', {'N', 'Y'}},
-    {'O', {'Y', 'Y'}},
-    {'P', {'4', 'Y'}},
-    {'Q', {'N', 'N'}},
-    {'R', {'N', 'Y'}},
-    {'S', {'Y', 'Y'}},
-    {'T', {'N', 'Y'}},
-    {'U', {'N', 'Y'}},
-    {'V', {'N', 'Y'}},
-    {'W', {'N', 'Y'}},
-    {'X', {'Y', 'Y'}},
-    {'Y', {'Y', 'Y'}},
-    {'Z', {'4', 'Y'}},
-    {'1', {'Y', 'Y'}},
-    {'4', {'4', 'Y'}},
-    {'5', {'Y', 'Y'}},
-    {'6', {'Y', 'Y'}},
-    {'7', {'N', 'Y'}},
-    {'8', {'N', 'N'}},
-    {'9', {'Y', 'N'}}
+// sale condition code -> last trade eligibility ('Y', 'N', or the number of a rule below) and volume eligibility
+struct SaleCondition {
+  char code;
+  char lte;
+  char ve;
+};
+
+constexpr SaleCondition cta_sale_conditions[] = {
+  {'C', 'N', 'Y'},
+  {'B', 'N', 'Y'},
+  {'E', 'Y', 'Y'},
+  {'F', 'Y', 'Y'},
+  {'H', 'N', 'Y'},
+  {'I', 'N', 'Y'},
+  {'K', 'Y', 'Y'},
+  {'L', '3', 'Y'},
+  {'M', 'N', 'N'},
+  {'N', 'N', 'Y'},
+  {'O', '1', 'Y'},
+  {'P', '2', 'Y'},
+  {'Q', 'N', 'N'},
+  {'R', 'N', 'Y'},
+  {'T', 'N', 'Y'},
+  {'U', 'N', 'Y'},
+  {'V', 'N', 'Y'},
+  {'X', 'Y', 'Y'},
+  {'Z', '2', 'Y'},
+  {'4', '2', 'Y'},
+  {'5', 'Y', 'Y'},
+  {'6', 'Y', 'Y'},
+  {'7', 'N', 'Y'},
+  {'8', 'N', 'N'},
+  {'9', 'Y', 'N'}
+};
+
+constexpr SaleCondition utp_sale_conditions[] = {
+  {'@', 'Y', 'Y'},
+  {'A', 'Y', 'Y'},
+  {'B', 'Y', 'Y'},
+  {'C', 'N', 'Y'},
+  {'D', 'Y', 'Y'},
+  {'E', 'N', 'N'},
+  {'F', 'Y', 'Y'},
+  {'G', '4', 'Y'},
+  {'H', 'N', 'Y'},
+  {'I', 'N', 'Y'},
+  {'K', 'Y', 'Y'},
+  {'L', '5', 'Y'},
+  {'M', 'N', 'N'},
+  {'N', 'N', 'Y'},
+  {'O', 'Y', 'Y'},
+  {'P', '4', 'Y'},
+  {'Q', 'N', 'N'},
+  {'R', 'N', 'Y'},
+  {'S', 'Y', 'Y'},
+  {'T', 'N', 'Y'},
+  {'U', 'N', 'Y'},
+  {'V', 'N', 'Y'},
+  {'W', 'N', 'Y'},
+  {'X', 'Y', 'Y'},
+  {'Y', 'Y', 'Y'},
+  {'Z', '4', 'Y'},
+  {'1', 'Y', 'Y'},
+  {'4', '4', 'Y'},
+  {'5', 'Y', 'Y'},
+  {'6', 'Y', 'Y'},
+  {'7', 'N', 'Y'},
+  {'8', 'N', 'N'},
+  {'9', 'Y', 'N'}
+};
+
+// effect of a condition code, so that the flags of all codes of a trade can be or-ed together
+enum SaleConditionFlag : uint8_t {
+  LTE_NEVER = 1,           // 'N'
+  LTE_FIRST_PER_EXCH = 2,  // '1': only if no eligible trade from the same exchange yet
+  LTE_FIRST = 4,           // '2', '4': only if no eligible trade yet
+  LTE_PRIMARY_RULE = 8,    // '3': not when reported by the primary exchange or after a trade from another exchange
+  LTE_BEFORE_160130 = 16,  // '5': only before 16:01:30
+  VE_NEVER = 32            // 'N'
+};
+
+constexpr uint8_t SaleConditionFlags(char lte, char ve) {
+  return (lte == 'N' ? LTE_NEVER : 0) | (lte == '1' ? LTE_FIRST_PER_EXCH : 0)
+       | (lte == '2' || lte == '4' ? LTE_FIRST : 0) | (lte == '3' ? LTE_PRIMARY_RULE : 0)
+       | (lte == '5' ? LTE_BEFORE_160130 : 0) | (ve == 'N' ? VE_NEVER : 0);
+}
+
+typedef array<uint8_t, 256> SaleConditionTable;
+
+template <size_t N>
+constexpr SaleConditionTable MkSaleConditionTable(const SaleCondition (&conditions)[N]) {
+  SaleConditionTable table = {};
+  for (const SaleCondition & cond : conditions) {
+    table[(uint8_t)cond.code] = SaleConditionFlags(cond.lte, cond.ve);
   }
+  return table;
+}
+
+constexpr SaleConditionTable scond_by_src[] = {
+  MkSaleConditionTable(cta_sale_conditions),
+  MkSaleConditionTable(utp_sale_conditions)
+};
+
+// last trade eligibility state of the current symbol
+struct LteState {
+  ExchangeMask exch_mask;   // exchanges with an eligible trade
+  char last_exch;
+  LteState() : last_exch('\0') {}
 };
 
-pair<bool,bool> TradeEligibilityIndicators(const SaleCondintionMap & cond_map, const vector<string> & row,
-                                            set<char>& lte_set, char & lte_last_exch) {
+// space and unknown codes have no flags; a trade is eligible unless one of its codes rules it out
+pair<bool,bool> TradeEligibilityIndicators(const SaleConditionTable & cond_table, const PsvRow & row, int64_t trd_time,
+                                            char primary_exch, LteState & lte_state) {
   const char ex_id = row[TCOL_Exchange][0];
-  const bool not_correction = stoi(row[TCOL_Trade_Correction_Indicator]) < 2;
-  string cond = row[TCOL_Sale_Condition];
-  cond.erase(remove(cond.begin(), cond.end(), ' '), cond.end());
-  // determine if trade is last trade eligible
-  bool is_lte = not_correction;
-  for (auto c = cond.begin(); is_lte && c != cond.end(); ++ c) {
-    auto it = cond_map.find(*c);
-    char lte = it != cond_map.end() ? it->second.first : '\0';
-    if (lte == 'N') {
-      is_lte = false;
-    } else if (lte == '1') {
-      if (lte_set.find(ex_id) != lte_set.end()) {
-        is_lte = false;
-      }
-    } else if (lte == '2' ||  lte == '4') {
-      if (lte_set.size()) {
-        is_lte = false;
-      }
-    } else if (lte == '3') {
-      const char source_exch = row[TCOL_Source_of_Trade][0];
-      const char primary_exch = PrimaryExchange(row[TCOL_Symbol]);
-      if ((lte_set.size() &&  ex_id != lte_last_exch) || source_exch == primary_exch) {
-        is_lte = false;
-      }
-    } else if (lte == '5') {
-      static const Time time_160130 = MkTime("16:01:30");
-      const Time trd_time = MkTaqTime(row[TCOL_Time]);
-      is_lte = trd_time < time_160130;
-    }
-  }
+  const bool not_correction = ParseInt(row[TCOL_Trade_Correction_Indicator]) < 2;
+  const char * cond = row[TCOL_Sale_Condition].data();
+  const uint8_t flags = cond_table[(uint8_t)cond[0]] | cond_table[(uint8_t)cond[1]]
+                      | cond_table[(uint8_t)cond[2]] | cond_table[(uint8_t)cond[3]];
+  static const int64_t time_160130 = MkNanos(16, 1, 30, 0);
+  const bool any_lte = lte_state.exch_mask.any();
+  const bool is_lte = not_correction
+    && 0 == (flags & LTE_NEVER)
+    && false == ((flags & LTE_FIRST_PER_EXCH) && lte_state.exch_mask.test(ex_id - 'A'))
+    && false == ((flags & LTE_FIRST) && any_lte)
+    && false == ((flags & LTE_PRIMARY_RULE)
+                 && ((any_lte && ex_id != lte_state.last_exch) || row[TCOL_Source_of_Trade][0] == primary_exch))
+    && false == ((flags & LTE_BEFORE_160130) && false == (trd_time < time_160130));
   // update tracking variables if trade is last trade eligible
   if (is_lte) {
-    lte_set.insert(ex_id);
-    lte_last_exch = ex_id;
-  }
-  // determine if trade is volume eligible
-  bool is_ve = not_correction;
-  for (auto c = cond.begin(); is_ve && c != cond.end(); ++c) {
-    auto it = cond_map.find(*c);
-    char ve = it != cond_map.end() ? it->second.second : '\0';
-    is_ve &= ve != 'N';
+    lte_state.exch_mask.set(ex_id - 'A');
+    lte_state.last_exch = ex_id;
   }
+  const bool is_ve = not_correction && 0 == (flags & VE_NEVER);
   return make_pair(is_lte, is_ve);
 }
 
-static bool ValidateInputRecord(const vector<string>& row) {
+static bool ValidateInputRecord(const PsvRow& row) {
   if (row[0] == "Time" || row[0] == "END" || row[0].size() == 0)
     return false;
   if (row.size() != TCOL_Max) {
@@ -143,78 +166,394 @@ static bool ValidateInputRecord(const vector<string>& row) {
   if (row[TCOL_Sale_Condition].size() != 4) {
     throw(domain_error("Sale_Condition length is not expected 4 characters"));
   }
-  const string& exchange = row[TCOL_Exchange];
+  const PsvField exchange = row[TCOL_Exchange];
   if (exchange.size() != 1 || !strchr("ABCDHIJKLMNPSTQUVWXYZ", exchange[0])) {
-    throw(domain_error("Exchange : unexpected value " + exchange));
+    throw(domain_error("Exchange : unexpected value " + string(exchange)));
   }
-  const string &source = row[TCOL_Source_of_Trade];
+  const PsvField source = row[TCOL_Source_of_Trade];
   if (source.size() != 1 || ! strchr("CN" , source[0])) {
-    throw(domain_error("Source_of_Trade : unexpected value " + source));
+    throw(domain_error("Source_of_Trade : unexpected value " + string(source)));
   }
-  const string& trf = row[TCOL_Trade_Reporting_Facility];
+  const PsvField trf = row[TCOL_Trade_Reporting_Facility];
   if (false == (trf.size() == 0 || (trf.size() == 1 && strchr("BNTQ ", trf[0])))) {
-    throw(domain_error("Trade_Reporting_Facility : unexpected value " + trf));
+    throw(domain_error("Trade_Reporting_Facility : unexpected value " + string(trf)));
   }
   return true;
 }
 
-int ProcessTrades(AppContext &ctx, istream & is) {
+// the trades so far of the second a bar shard is in
+struct BarState {
+  int64_t time;
+  int64_t open;
+  int64_t high;
+  int64_t low;
+  int64_t close;
+  int64_t volume;
+  int64_t ve_volume;
+  int trade_cnt;
+  BarState() : time(-1), open(0), high(0), low(0), close(0), volume(0), ve_volume(0), trade_cnt(0) {}
+};
+
+// trade records, symbol map and daily summaries of a contiguous, symbol-aligned slice of the input, and the eligibility
+// state of its current symbol; trade-nbbo and bar shards also look up the NBBO changes of their symbols, and bar shards
+// collect the trades of a second before writing its bar
+struct TradeShard {
+  RecordType type;
   vector<SymbolMap> symbol_map;
-  ctx.output_file_hdr.type = RecordType::Trade;
-  SymbolMap* current = nullptr;
-  int rec_cnt = 0;
-  LoadSecMaster(ctx);
-  ctx.output.write((const char*)&ctx.output_file_hdr, sizeof(ctx.output_file_hdr));
+  int64_t rec_cnt;
+  const SaleConditionTable* cond_table;
+  LteState lte_state;
+  char primary_exch;
+  SegmentWriter writer;
+  const NbboTimelines* timelines;
+  const vector<Taq::Nbbo>* quotes;   // of the current symbol, null if it has none
+  size_t quote_pos;                  // first NBBO change at or after the last trade
+  BarState bar;
+  DailySummary summary;              // of the current symbol
+  vector<DailySummary> summaries;
+  TradeShard(RecordType type, int version, const NbboTimelines* timelines = nullptr)
+    : type(type), rec_cnt(0), cond_table(nullptr), primary_exch('\0'), writer(type, version), timelines(timelines),
+      quotes(nullptr), quote_pos(0) {}
+};
+
+static const size_t TRADE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// the last NBBO change before the trade's time; trades of a symbol are in time order, so the search goes on from the
+// previous trade's and starts over only for a trade out of order
+static const Taq::Nbbo* PrevailingNbbo(TradeShard & shard, int64_t trd_time) {
+  if (!shard.quotes) {
+    return nullptr;
+  }
+  const vector<Taq::Nbbo> & quotes = *shard.quotes;
+  if (shard.quote_pos && quotes[shard.quote_pos - 1].time >= trd_time) {
+    shard.quote_pos = lower_bound(quotes.begin(), quotes.end(), trd_time, [](const Taq::Nbbo & quote, int64_t time) {
+      return quote.time < time;
+    }) - quotes.begin();
+  }
+  while (shard.quote_pos < quotes.size() && quotes[shard.quote_pos].time < trd_time) {
+    shard.quote_pos++;
+  }
+  return shard.quote_pos ? &quotes[shard.quote_pos - 1] : nullptr;
+}
+
+// the bar's mid is that of the NBBO prevailing at the end of its second
+static void WriteBar(TradeShard & shard, ostream & os) {
+  const BarState & bar = shard.bar;
+  if (0 == bar.trade_cnt) {
+    return;
+  }
+  const Taq::Nbbo* nbbo = PrevailingNbbo(shard, bar.time + Bar::NANOS);
+  const bool two_sided = nbbo && nbbo->bidp > 0 && nbbo->askp != NO_OFFER_TICKS && nbbo->askp >= nbbo->bidp;
+  Bar record(bar.time, bar.open, bar.high, bar.low, bar.close, bar.volume, bar.ve_volume,
+             two_sided ? (nbbo->bidp + nbbo->askp) / 2 : 0, bar.trade_cnt);
+  shard.rec_cnt++;
+  shard.writer.Write(os, &record);
+  shard.bar = BarState();
+}
+
+static void AddToBar(TradeShard & shard, const Trade & trade, ostream & os) {
+  const int64_t second = trade.time - trade.time % Bar::NANOS;
+  if (second != shard.bar.time) {
+    if (second < shard.bar.time) {
+      throw(domain_error("Trade input is not ordered by time, use --sort: " + string(shard.symbol_map.rbegin()->symb)));
+    }
+    WriteBar(shard, os);
+    shard.bar.time = second;
+    shard.bar.open = shard.bar.high = shard.bar.low = trade.price;
+  }
+  BarState & bar = shard.bar;
+  bar.high = max(bar.high, (int64_t)trade.price);
+  bar.low = min(bar.low, (int64_t)trade.price);
+  bar.close = trade.price;
+  bar.volume += trade.qty;
+  bar.ve_volume += trade.attr.ve ? trade.qty : 0;
+  bar.trade_cnt++;
+}
+
+static void AddToSummary(DailySummary::Trades & summary, const Trade & trade) {
+  summary.trade_cnt++;
+  summary.volume += trade.qty;
+  if (trade.attr.ve) {
+    summary.ve_volume += trade.qty;
+    summary.ve_value += trade.price * trade.qty;
+  }
+  if (trade.attr.lte) {
+    summary.lte_volume += trade.qty;
+    summary.open = summary.open ? summary.open : trade.price;
+    summary.high = max(summary.high, trade.price);
+    summary.low = summary.low ? min(summary.low, trade.price) : trade.price;
+    summary.close = trade.price;
+  }
+}
+
+static void FinishSymbol(TradeShard & shard, ostream & os) {
+  WriteBar(shard, os);
+  shard.summaries.push_back(shard.summary);
+  shard.symbol_map.rbegin()->end = shard.rec_cnt;
+  shard.writer.Finish(os);
+}
+
+static void ProcessTrade(TradeShard & shard, const PsvRow & row, ostream & os) {
+  Trade::Attr attr = {};   // the unused bits are written to the file too
+  vector<SymbolMap> & symbol_map = shard.symbol_map;
+  if (symbol_map.empty() || string_view(symbol_map.rbegin()->symb) != row[TCOL_Symbol]) {
+    if (symbol_map.size()) {
+      FinishSymbol(shard, os);
+    }
+    symbol_map.push_back(SymbolMap(row[TCOL_Symbol], shard.rec_cnt + 1, 0));
+
+    const char src = row[TCOL_Source_of_Trade][0];
+    shard.cond_table = src == 'C' ? &scond_by_src[0] : &scond_by_src[1];
+    shard.lte_state = LteState();
+    shard.primary_exch = PrimaryExchange(SecuritySymbolId(row[TCOL_Symbol]));
+    shard.summary = DailySummary();
+    memcpy(shard.summary.symb, symbol_map.rbegin()->symb, sizeof(Symbol));
+    shard.summary.parts = DailySummary::TRADES;
+    if (shard.timelines) {
+      auto found = shard.timelines->find(string(row[TCOL_Symbol]));
+      shard.quotes = found != shard.timelines->end() ? &found->second : nullptr;
+      shard.quote_pos = 0;
+    }
+  }
+  const int64_t trd_time = MkTaqNanos(row[TCOL_Time]);
+  const int64_t trd_price = MkPriceTicks(ParseDouble(row[TCOL_Trade_Price]));
+  const int trd_qty = ParseInt(row[TCOL_Trade_Volume]);
+  const PsvField trd_cond = row[TCOL_Sale_Condition];
+  attr.exch = row[TCOL_Exchange][0];
+  attr.trf = row[TCOL_Trade_Reporting_Facility][0];
+  auto indicators = TradeEligibilityIndicators(*shard.cond_table, row, trd_time, shard.primary_exch, shard.lte_state);
+  attr.lte = indicators.first;
+  attr.ve = indicators.second;
+  attr.iso = '1' == row[TCOL_Trade_Through_Exempt_Indicator][0] ? 1 : 0;
+  Trade trade(trd_time, trd_price, trd_qty, attr, trd_cond.data());
+  AddToSummary(shard.summary.trades, trade);
+  if (shard.type == RecordType::Bar) {
+    AddToBar(shard, trade, os);
+    return;
+  }
+  shard.rec_cnt++;
+  if (shard.type == RecordType::TradeNbbo) {
+    const Taq::Nbbo* nbbo = PrevailingNbbo(shard, trd_time);
+    TradeNbbo record(trade, nbbo ? nbbo->bidp : 0, nbbo ? nbbo->askp : NO_OFFER_TICKS, nbbo ? nbbo->time : -1);
+    shard.writer.Write(os, &record);
+  } else {
+    shard.writer.Write(os, &trade);
+  }
+}
+
+// trade-nbbo and bar look up the quotes of each symbol once, in the order of the quote input
+static void CheckSymbolOrder(const string & last_symbol, string_view symbol) {
+  if (last_symbol.size() && symbol <= last_symbol) {
+    throw(domain_error("Trade input is not ordered by symbol, use --sort: " + last_symbol + " and " + string(symbol)));
+  }
+}
+
+static void FinishTradeShard(TradeShard & shard, ostream & os) {
+  if (shard.symbol_map.size()) {
+    FinishSymbol(shard, os);
+  }
+}
+
+static void AppendTradeShard(TradeShard & file, const TradeShard & shard) {
+  for (SymbolMap sm : shard.symbol_map) {
+    sm.start += file.rec_cnt;
+    sm.end += file.rec_cnt;
+    file.symbol_map.push_back(sm);
+  }
+  file.rec_cnt += shard.rec_cnt;
+  file.writer.Append(shard.writer);
+}
 
-  const SaleCondintionMap* cond_map = nullptr;
-  set<char> symb_lte_set;
-  char lte_last_exch = '\0';
+static void StartTradeFile(OutputFile & output) {
+  output.hdr.type = output.type;
+  output.WriteHeader();
+}
 
-  while(!is.eof()) {
-    string line;
-    getline(is, line);
-    vector<string> row;
-    Trade::Attr attr;
-    boost::split(row, line, boost::is_any_of("|"));
+static void FinishTradeFile(OutputFile & output, const TradeShard & file) {
+  file.writer.WriteTrailer(output.stream, file.symbol_map);
+  output.hdr.symb_cnt = (int64_t)file.symbol_map.size();
+  output.hdr.rec_cnt = file.rec_cnt;
+}
 
+int ProcessTrades(AppContext &ctx, const InputReader & input) {
+  OutputFile & output = ctx.outputs.front();
+  LoadSecMaster(ctx);
+  StartTradeFile(output);
+  NbboTimelines timelines;
+  unique_ptr<PrevailingQuotes> quotes;
+  if (ctx.quote_files.size()) {
+    quotes = make_unique<PrevailingQuotes>(ctx.quote_files, ctx.thread_cnt);
+  }
+  TradeShard shard(output.type, output.hdr.version, quotes ? &timelines : nullptr);
+  string last_symbol;
+  input([&](const PsvRow & row) {
     if (ValidateInputRecord(row)) {
-      rec_cnt++;
-      if (!current || current->symb != row[TCOL_Symbol]) {
-        if (current) {
-          current->end = rec_cnt - 1;
-        }
-        symbol_map.push_back(SymbolMap(row[TCOL_Symbol], rec_cnt, 0));
-        current = &*symbol_map.rbegin();
+      const PsvField symbol = row[TCOL_Symbol];
+      if (quotes && symbol != last_symbol) {
+        CheckSymbolOrder(last_symbol, symbol);
+        last_symbol = symbol;
+        timelines = quotes->Take(last_symbol, last_symbol);
+      }
+      ProcessTrade(shard, row, output.stream);
+    }
+  });
+  FinishTradeShard(shard, output.stream);
+  FinishTradeFile(output, shard);
+  ctx.summaries.insert(ctx.summaries.end(), shard.summaries.begin(), shard.summaries.end());
+  return 0;
+}
 
-        const char src = row[TCOL_Source_of_Trade][0];
-        cond_map = src == 'C' ? &scond_by_src[0] : &scond_by_src[1];
-        symb_lte_set.clear();
-        lte_last_exch = '\0';
+// records of one partition within a chunk
+struct TradeSegment {
+  string group;
+  string first_symbol;   // in sort order
+  string last_symbol;
+  TradeShard shard;
+  stringstream buffer;             // read back into the output file, so opened in and out
+  TradeSegment(const string & group, RecordType type, int version, const NbboTimelines* timelines)
+    : group(group), shard(type, version, timelines) {}
+};
+
+// symbol-aligned chunks of the input are processed concurrently and appended in input order; a symbol never spans
+// chunks, so its eligibility state stays within one worker; with --symbol-group all each partition's file is
+// finished when the next partition starts
+static int ProcessTradeChunks(AppContext & ctx, const function<void(const ChunkConsumer &)> & read_chunks) {
+  typedef vector<TradeSegment> TradeChunk;
+  OutputFile & output = ctx.outputs.front();
+  LoadSecMaster(ctx);
+  deque<future<TradeChunk>> pending;
+  const RecordType type = output.type;
+  const int version = output.hdr.version;
+  TradeShard file(type, version);
+  unique_ptr<PrevailingQuotes> quotes;
+  if (ctx.quote_files.size()) {
+    quotes = make_unique<PrevailingQuotes>(ctx.quote_files, ctx.thread_cnt);
+  }
+  string last_quoted_symbol;
+  set<string> finished_groups;
+  string open_group;
+  uint64_t input_offset = 0;
+  if (false == ctx.all_symbol_groups) {
+    StartTradeFile(output);
+    open_group = ctx.symb;
+  }
+  auto switch_group = [&](const string & group) {
+    if (open_group.size()) {
+      FinishTradeFile(output, file);
+      CloseOutputFiles(ctx);
+      finished_groups.insert(open_group);
+    }
+    if (finished_groups.count(group)) {
+      throw(domain_error("Input is not ordered by symbol group: " + group));
+    }
+    OpenOutputFiles(ctx, group);
+    StartTradeFile(output);
+    file = TradeShard(type, version);
+    open_group = group;
+  };
+  auto append_chunk = [&]() {
+    TradeChunk chunk = pending.front().get();
+    pending.pop_front();
+    for (TradeSegment & segment : chunk) {
+      if (ctx.all_symbol_groups) {
+        if (segment.group != open_group) {
+          switch_group(segment.group);
+        }
+        AddToPartition(ctx, segment.group, segment.first_symbol, segment.last_symbol);
+      }
+      if (segment.buffer.tellp() > 0) {   // inserting an empty buffer would set failbit
+        output.stream << segment.buffer.rdbuf();
       }
-      const Time trd_time = MkTaqTime(row[TCOL_Time]);
-      const double trd_price = stod(row[TCOL_Trade_Price]);
-      const int trd_qty = stoi(row[TCOL_Trade_Volume]);
-      const string& trd_cond = row[TCOL_Sale_Condition];
-      attr.exch = row[TCOL_Exchange][0];
-      attr.trf = row[TCOL_Trade_Reporting_Facility][0];
-      auto indicators = TradeEligibilityIndicators(*cond_map, row, symb_lte_set, lte_last_exch);
-      attr.lte = indicators.first;
-      attr.ve = indicators.second;
-      attr.iso = '1' == row[TCOL_Trade_Through_Exempt_Indicator][0] ? 1 : 0;
-      Trade trade(trd_time, trd_price, trd_qty, attr, trd_cond.c_str());
-      ctx.output.write((const char*)&trade, sizeof(trade));
+      AppendTradeShard(file, segment.shard);
+      ctx.summaries.insert(ctx.summaries.end(), segment.shard.summaries.begin(), segment.shard.summaries.end());
+    }
+  };
+  read_chunks([&](InputChunk && input) {
+    if (pending.size() >= (size_t)ctx.thread_cnt) {
+      append_chunk();
     }
-    if (current) {
-      current->end = rec_cnt;
+    const uint64_t offset = input_offset;
+    input_offset += input.size();
+    // the quotes of the chunk's symbols are taken in input order, before the chunk is handed to its worker
+    NbboTimelines timelines;
+    if (quotes) {
+      string first_symbol, last_symbol;
+      ChunkSymbolRange(input, TCOL_Symbol, first_symbol, last_symbol);
+      if (first_symbol.size()) {
+        CheckSymbolOrder(last_quoted_symbol, first_symbol);
+        timelines = quotes->Take(first_symbol, last_symbol);
+        last_quoted_symbol = last_symbol;
+      }
     }
+    const bool join_quotes = quotes != nullptr;
+    pending.push_back(async(launch::async, [&ctx, type, version, offset, join_quotes, input = move(input),
+                                            timelines = move(timelines)]() {
+      TradeChunk chunk;
+      string last_symbol;
+      ReadInputChunk(input, [&](const PsvRow & row, uint64_t row_offset) {
+        if (ValidateInputRecord(row)) {
+          const PsvField symbol = row[TCOL_Symbol];
+          if (chunk.empty() || last_symbol != symbol) {
+            if (join_quotes) {
+              CheckSymbolOrder(last_symbol, symbol);
+            }
+            const string group = ctx.all_symbol_groups ? SymbolPartition(ctx, symbol, offset + row_offset) : string();
+            if (chunk.empty() || chunk.back().group != group) {
+              chunk.emplace_back(group, type, version, join_quotes ? &timelines : nullptr);
+              chunk.back().first_symbol = symbol;
+              chunk.back().last_symbol = symbol;
+            }
+            last_symbol = symbol;
+            chunk.back().first_symbol = min<string_view>(chunk.back().first_symbol, symbol);
+            chunk.back().last_symbol = max<string_view>(chunk.back().last_symbol, symbol);
+          }
+          ProcessTrade(chunk.back().shard, row, chunk.back().buffer);
+        }
+      });
+      for (TradeSegment & segment : chunk) {
+        FinishTradeShard(segment.shard, segment.buffer);
+      }
+      return chunk;
+    }));
+  });
+  while (pending.size()) {
+    append_chunk();
   }
-  for (const auto& sm : symbol_map) {
-    ctx.output.write((const char*)&sm, sizeof(sm));
+  if (open_group.size() || false == ctx.all_symbol_groups) {
+    FinishTradeFile(output, file);
   }
-  ctx.output_file_hdr.symb_cnt = (int)symbol_map.size();
-  ctx.output_file_hdr.rec_cnt = rec_cnt;
   return 0;
+}
+
+static bool IsChunked(const AppContext & ctx) {
+  return ctx.all_symbol_groups || ctx.thread_cnt > 1;
+}
 
+int ProcessTradeFiles(AppContext & ctx) {
+  if (IsChunked(ctx)) {
+    return ProcessTradeChunks(ctx, [&](const ChunkConsumer & consumer) {
+      ReadInputChunks(ctx.input_files, TRADE_CHUNK_SIZE, TCOL_Symbol, consumer);
+    });
+  }
+  return ProcessTrades(ctx, [&](const RowConsumer & consumer) { ReadInputFiles(ctx.input_files, consumer); });
 }
 
-}
\ No newline at end of file
+int ProcessTradeStream(AppContext & ctx, istream & is) {
+  if (IsChunked(ctx)) {
+    return ProcessTradeChunks(ctx, [&](const ChunkConsumer & consumer) {
+      ReadInputStreamChunks(is, TRADE_CHUNK_SIZE, TCOL_Symbol, consumer);
+    });
+  }
+  return ProcessTrades(ctx, [&](const RowConsumer & consumer) { ReadInputStream(is, consumer); });
+}
+
+int ProcessTradeBlocks(AppContext & ctx, const BlockReader & reader) {
+  if (IsChunked(ctx)) {
+    return ProcessTradeChunks(ctx, [&](const ChunkConsumer & consumer) {
+      ReadInputBlockChunks(reader, TRADE_CHUNK_SIZE, TCOL_Symbol, consumer);
+    });
+  }
+  return ProcessTrades(ctx, [&](const RowConsumer & consumer) { ReadInputBlocks(reader, consumer); });
+}
+
+}
@@ -2,8 +2,11 @@
 
 #include <numeric>
 #include <algorithm>
+#include <sstream>
+#include <iomanip>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include "boost-algorithm-string.h"
 #include "taq-prep.h"
 
 using namespace std;
@@ -11,44 +14,137 @@ using namespace Taq;
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
-static void OpenOutputStream(taq_prep::AppContext& ctx) {
-  fs::path out_path = MkDataFilePath(ctx.output_dir, ctx.output_file_hdr.type, MkTaqDate(ctx.date), ctx.symb.size() ? ctx.symb[0] : '\0');
-  if (fs::exists(out_path) && fs::is_regular_file(out_path)) {
-    fs::remove(out_path);
+static bool IsQuoteType(RecordType type) {
+  return type == RecordType::Nbbo || type == RecordType::NbboPrice || type == RecordType::ExchangeBbo;
+}
+
+static bool IsTradeType(RecordType type) {
+  return type == RecordType::Trade || type == RecordType::TradeNbbo || type == RecordType::Bar;
+}
+
+void taq_prep::OpenOutputFiles(taq_prep::AppContext& ctx, const string& partition) {
+  for (taq_prep::OutputFile& output : ctx.outputs) {
+    fs::path out_path = MkDataFilePath(ctx.output_dir, output.type, MkTaqDate(ctx.date), partition);
+    output.path = out_path.string();
+    output.buffer.Open(output.path);
+    output.stream.clear();
+    output.hdr.symb_cnt = 0;
+    output.hdr.rec_cnt = 0;
   }
-  ctx.output_file = out_path.string();
-  ctx.output.open(ctx.output_file, ios::out | ios::binary);
 }
 
-static void CloseOutputStream(taq_prep::AppContext& ctx) {
-  const bool rewrite_header = ctx.input_type != "master";
-  if (rewrite_header) {
-    ctx.output.seekp(ios_base::beg);
-    ctx.output.write((const char*)&ctx.output_file_hdr, sizeof(ctx.output_file_hdr));
+void taq_prep::CloseOutputFiles(taq_prep::AppContext& ctx) {
+  for (taq_prep::OutputFile& output : ctx.outputs) {
+    if (false == output.buffer.IsOpen()) {
+      continue;
+    }
+    const bool rewrite_header = output.type != RecordType::SecMaster;
+    if (rewrite_header) {
+      output.RewriteHeader();
+    }
+    output.buffer.Commit();
   }
-  ctx.output.close();
 }
 
-static int ProcessInputStream(taq_prep::AppContext& ctx, istream& is) {
-  if (ctx.output_file_hdr.type == RecordType::SecMaster) {
-    return taq_prep::ProcessSecMaster(ctx, is);
+// the first letter of the symbol, or with --partitions and --partition-mb the number of the range of input holding
+// the symbol's first row; input is ordered by symbol, so partitions are consecutive ranges of symbols of about
+// partition_bytes each, and a symbol larger than that leaves the numbers it spans unused
+string taq_prep::SymbolPartition(const taq_prep::AppContext& ctx, string_view symbol, uint64_t offset) {
+  if (symbol.empty()) {
+    throw(domain_error("Empty symbol"));
   }
-  else if (ctx.output_file_hdr.type == RecordType::Nbbo || ctx.output_file_hdr.type == RecordType::NbboPrice) {
-    return taq_prep::ProcessQuotes(ctx, is);
+  if (0 == ctx.partition_bytes) {
+    return string(1, symbol[0]);
   }
-  else if (ctx.output_file_hdr.type == RecordType::Trade) {
-    return taq_prep::ProcessTrades(ctx, is);
+  uint64_t partition = offset / ctx.partition_bytes;
+  if (ctx.partition_cnt) {
+    partition = min(partition, (uint64_t)ctx.partition_cnt - 1);
+  }
+  ostringstream ss;
+  ss << setw(3) << setfill('0') << partition;
+  return ss.str();
+}
+
+// called in input order with the symbol range of each segment appended to the open partition; the ranges of
+// partitions must not overlap for tick-calc to find a symbol's partition
+void taq_prep::AddToPartition(taq_prep::AppContext& ctx, const string& partition, const string& first_symbol,
+                              const string& last_symbol) {
+  if (ctx.partitions.empty() || ctx.partitions.back().partition != partition) {
+    if (ctx.partitions.size() && ctx.partitions.back().last_symbol >= first_symbol) {
+      throw(domain_error("Input is not ordered by symbol, use --sort: " + ctx.partitions.back().last_symbol + " and "
+                         + first_symbol));
+    }
+    ctx.partitions.push_back(PartitionEntry{partition, first_symbol, last_symbol});
+  } else {
+    PartitionEntry& entry = ctx.partitions.back();
+    entry.first_symbol = min(entry.first_symbol, first_symbol);
+    entry.last_symbol = max(entry.last_symbol, last_symbol);
+    if (ctx.partitions.size() > 1 && ctx.partitions[ctx.partitions.size() - 2].last_symbol >= entry.first_symbol) {
+      throw(domain_error("Input is not ordered by symbol, use --sort: " + entry.first_symbol));
+    }
+  }
+}
+
+void taq_prep::WritePartitionManifests(const taq_prep::AppContext& ctx) {
+  for (const taq_prep::OutputFile& output : ctx.outputs) {
+    WritePartitionManifest(MkManifestPath(ctx.output_dir, output.type, MkTaqDate(ctx.date)), ctx.partitions);
+  }
+}
+
+static int ProcessInput(taq_prep::AppContext& ctx, const taq_prep::InputReader& input) {
+  const RecordType rec_type = ctx.outputs.front().type;
+  if (rec_type == RecordType::SecMaster) {
+    return taq_prep::ProcessSecMaster(ctx, input);
+  }
+  else if (IsQuoteType(rec_type)) {
+    return taq_prep::ProcessQuotes(ctx, input);
+  }
+  else if (IsTradeType(rec_type)) {
+    return taq_prep::ProcessTrades(ctx, input);
   }
   return 0;
 }
 
+static int ProcessInputStream(taq_prep::AppContext& ctx, istream& is) {
+  const RecordType rec_type = ctx.outputs.front().type;
+  if (ctx.all_symbol_groups && IsQuoteType(rec_type)) {
+    return taq_prep::ProcessQuoteStream(ctx, is);
+  }
+  if (IsTradeType(rec_type)) {
+    return taq_prep::ProcessTradeStream(ctx, is);
+  }
+  return ProcessInput(ctx, [&](const taq_prep::RowConsumer& consumer) { taq_prep::ReadInputStream(is, consumer); });
+}
+
+// rows are read in full and spilled to sorted runs as needed before anything is processed
+static int ProcessSortedInput(taq_prep::AppContext& ctx) {
+  const bool is_quote = IsQuoteType(ctx.outputs.front().type);
+  taq_prep::ExternalSort sort(ctx.output_dir, ctx.sort_memory_mb * 1024 * 1024,
+                              is_quote ? (int)taq_prep::QCOL_Symbol : (int)taq_prep::TCOL_Symbol,
+                              is_quote ? (int)taq_prep::QCOL_Time : (int)taq_prep::TCOL_Time,
+                              is_quote ? (int)taq_prep::QCOL_Sequence_Number : (int)taq_prep::TCOL_Sequence_Number);
+  auto add = [&](const taq_prep::PsvRow& row) { sort.Add(row); };
+  if (ctx.input_files.size()) {
+    taq_prep::ReadInputFiles(ctx.input_files, add);
+  } else {
+    taq_prep::ReadInputStream(cin, add);
+  }
+  const taq_prep::BlockReader sorted = [&](char* data, size_t size) { return sort.Read(data, size); };
+  if (is_quote) {
+    return taq_prep::ProcessQuoteBlocks(ctx, sorted);
+  }
+  return taq_prep::ProcessTradeBlocks(ctx, sorted);
+}
+
 static int ProcessFiles(taq_prep::AppContext &ctx) {
-  int retval = 0;
-  for(const auto & file : ctx.input_files) {
-      std::ifstream is(file, ifstream::in);
-      retval += ProcessInputStream(ctx, is);
+  if (IsQuoteType(ctx.outputs.front().type)) {
+    return taq_prep::ProcessQuoteFiles(ctx);
   }
-  return retval;
+  if (IsTradeType(ctx.outputs.front().type)) {
+    return taq_prep::ProcessTradeFiles(ctx);
+  }
+  // input files are memory-mapped or decompressed, and read as one continuous stream
+  return ProcessInput(ctx, [&](const taq_prep::RowConsumer& consumer) { taq_prep::ReadInputFiles(ctx.input_files, consumer); });
 }
 
 static bool ValidateCmdArgs(taq_prep::AppContext & ctx) {
@@ -65,26 +161,102 @@ static bool ValidateCmdArgs(taq_prep::AppContext & ctx) {
       return false;
     }
   }
+  if (ctx.thread_cnt < 1) {
+    cerr << "Invalid --threads: " << ctx.thread_cnt << endl;
+    return false;
+  }
+  // v4 files are read but no longer written, --compress gives the same blocks with the indexes of later versions
+  if (false == IsSupportedFileVersion(ctx.file_version) || ctx.file_version == FILE_VERSION_COMPRESSED) {
+    cerr << "Invalid --file-version: " << ctx.file_version << endl;
+    return false;
+  }
+  if (ctx.compress && ctx.file_version < FILE_VERSION_TIME_INDEX) {
+    cerr << "--compress requires --file-version 5 or later" << endl;
+    return false;
+  }
+  if (ctx.compress) {
+    ctx.file_version |= FILE_FLAG_COMPRESSED;
+  }
   if (ctx.date.empty()) {
     cerr << "--date required for stdin" << endl;
     return false;
   }
 
-  RecordType rec_type = RecordTypeFromString(ctx.input_type);
-  if (rec_type == RecordType::NA) {
+  // quote products can be combined, e.g. quote,quote-po,bbo builds all three files from a single read
+  vector<string> type_names;
+  boost::split(type_names, ctx.input_type, boost::is_any_of(","));
+  vector<RecordType> rec_types;
+  for (const string& type_name : type_names) {
+    const RecordType rec_type = RecordTypeFromString(type_name);
+    if (rec_type == RecordType::NA || find(rec_types.begin(), rec_types.end(), rec_type) != rec_types.end()
+        || (type_names.size() > 1 && !IsQuoteType(rec_type))) {
       cerr << "Invalid --in-type:" << ctx.input_type << endl;
       return false;
+    }
+    rec_types.push_back(rec_type);
   }
-  bool symbol_grp_required = rec_type == RecordType::Nbbo || rec_type == RecordType::NbboPrice;
+  const RecordType rec_type = rec_types.front();
+  bool symbol_grp_required = IsQuoteType(rec_type);
   if (symbol_grp_required && ctx.symb.empty()) {
     cerr << "--symbol-group required for stdin" << endl;
     return false;
   }
-  if (symbol_grp_required && ctx.symb.size() > 1) {
+  // trades are written to one whole-day file unless a symbol group is given
+  const bool symbol_grp_allowed = symbol_grp_required || IsTradeType(rec_type);
+  ctx.all_symbol_groups = symbol_grp_allowed && ctx.symb == "all";
+  if (symbol_grp_allowed && ctx.symb.size() > 1 && false == ctx.all_symbol_groups) {
     cerr << "Invalid --symbol-group:" << ctx.symb << endl;
     return false;
   }
-  ctx.output_file_hdr.type = rec_type;
+  if ((ctx.partition_cnt || ctx.partition_mb) && false == ctx.all_symbol_groups) {
+    cerr << "--partitions and --partition-mb apply to --symbol-group all" << endl;
+    return false;
+  }
+  if (ctx.partition_cnt < 0 || (ctx.partition_cnt && ctx.partition_mb)) {
+    cerr << "Invalid --partitions:" << ctx.partition_cnt << endl;
+    return false;
+  }
+  if (ctx.partition_cnt) {
+    // balanced by the size of the input, which must be known up front
+    if (ctx.input_files.empty() || taq_prep::IsCompressedInput(ctx.input_files)) {
+      cerr << "--partitions requires uncompressed --in-files, use --partition-mb" << endl;
+      return false;
+    }
+    uint64_t input_size = 0;
+    for (const string& path : ctx.input_files) {
+      input_size += fs::file_size(path);
+    }
+    ctx.partition_bytes = max<uint64_t>(1, (input_size + ctx.partition_cnt - 1) / ctx.partition_cnt);
+  }
+  ctx.partition_bytes = ctx.partition_mb ? ctx.partition_mb * 1024 * 1024 : ctx.partition_bytes;
+  if (ctx.sort_input && (rec_type == RecordType::SecMaster || ctx.sort_memory_mb == 0)) {
+    cerr << "--sort applies to quote and trade input with a non-zero --sort-memory" << endl;
+    return false;
+  }
+  if (ctx.thread_cnt > 1 && ctx.input_files.empty() && false == ctx.all_symbol_groups && false == ctx.sort_input
+      && false == IsTradeType(rec_type)) {
+    cerr << "--threads requires --in-files" << endl;
+    return false;
+  }
+  // trade-nbbo joins the trades to the whole-day quote files of the date, bar takes the mids from them if given
+  if ((rec_type == RecordType::TradeNbbo && ctx.quote_files.empty())
+      || (ctx.quote_files.size() && rec_type != RecordType::TradeNbbo && rec_type != RecordType::Bar)) {
+    cerr << "--quote-files applies to --in-type trade-nbbo and bar, and is required by trade-nbbo" << endl;
+    return false;
+  }
+  if (ctx.snapshot_interval < 0 || (ctx.snapshot_interval && false == IsQuoteType(rec_type))) {
+    cerr << "--snapshot-interval applies to quote input and must not be negative" << endl;
+    return false;
+  }
+  for (const string& path : ctx.quote_files) {
+    if (false == (fs::exists(path) && fs::is_regular(path))) {
+      cerr << "Invalid quote path: " << path << endl;
+      return false;
+    }
+  }
+  for (RecordType type : rec_types) {
+    ctx.outputs.emplace_back(type, ctx.file_version);
+  }
   return true;
 }
 
@@ -95,10 +267,19 @@ int main(int argc, char **argv) {
   desc.add_options()
     ("help,h", "produce help message")
     ("date,d", po::value<string>(&ctx.date)->default_value(""), "trade date")
-    ("symbol-group,s", po::value<string>(&ctx.symb)->default_value(""), "symbol group")
-    ("in-files,i", po::value<vector<string>>(&ctx.input_files)->multitoken(), "space-separated list of input files")
-    ("in-type,t", po::value<string>(&ctx.input_type)->default_value("quote-po"), "input file type (master, quote, quote-po, trade)")
+    ("symbol-group,s", po::value<string>(&ctx.symb)->default_value(""), "symbol group; all writes the files of every group from a whole-day quote or trade file")
+    ("in-files,i", po::value<vector<string>>(&ctx.input_files)->multitoken(), "space-separated list of input files (.gz, .zst and .zip are decompressed)")
+    ("in-type,t", po::value<string>(&ctx.input_type)->default_value("quote-po"), "input file type (master, quote, quote-po, bbo, trade, trade-nbbo, bar); quote,quote-po builds both NBBO files in one pass, bbo the per-exchange quote changes tick-calc computes venue NBBOs from, trade-nbbo trades with the NBBO prevailing at each, and bar 1-second bars of the trades")
+    ("quote-files", po::value<vector<string>>(&ctx.quote_files)->multitoken(), "with --in-type trade-nbbo or bar, the day's quote files ordered by symbol like the trades")
     ("out-dir,o", po::value<string>(&ctx.output_dir)->default_value("."), "output directory")
+    ("threads,j", po::value<int>(&ctx.thread_cnt)->default_value(1), "number of worker threads (quote and trade input split at symbol boundaries)")
+    ("sort", po::bool_switch(&ctx.sort_input), "sort unordered input by symbol, time and sequence number before processing")
+    ("file-version", po::value<int>(&ctx.file_version)->default_value(FILE_VERSION_PRICE_INDEX), "quote and trade file layout: 1 packed records, 2 columns per symbol, 3 columns with integer times and prices, 5 v3 with a time index per symbol, 6 v5 with a hashed symbol directory, 7 v6 with 64-bit record counts, 8 v7 with an index of the price changes in nbbo files, which tick-calc then reads in place of nbbo-po files")
+    ("compress", po::bool_switch(&ctx.compress), "write the quote and trade records in zstd-compressed blocks, which tick-calc decompresses as it reads them; requires --file-version 5 or later")
+    ("sort-memory", po::value<size_t>(&ctx.sort_memory_mb)->default_value(1024), "memory budget of --sort in MB, file buffers included; sorted runs beyond it are spilled to --out-dir and merged at most 64 at a time")
+    ("partitions", po::value<int>(&ctx.partition_cnt)->default_value(0), "with --symbol-group all, split the files into this many ranges of symbols of about equal input size instead of by first letter")
+    ("partition-mb", po::value<size_t>(&ctx.partition_mb)->default_value(0), "with --symbol-group all, start a new range of symbols after about this many MB of input")
+    ("snapshot-interval", po::value<int>(&ctx.snapshot_interval)->default_value(0), "with quote input, also write the NBBO of every security every this many seconds from 04:00 to 20:00 to the day's snapshot file; the quote runs of a day must use the same interval")
   ;
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -110,9 +291,24 @@ int main(int argc, char **argv) {
     return 2;
   }
   try {
-    OpenOutputStream(ctx);
-    retval = ctx.input_files.size() ? ProcessFiles(ctx) : ProcessInputStream(ctx, cin);
-    CloseOutputStream(ctx);
+    if (false == ctx.all_symbol_groups) {
+      taq_prep::OpenOutputFiles(ctx, ctx.symb);
+    }
+    if (ctx.sort_input) {
+      retval = ProcessSortedInput(ctx);
+    } else {
+      retval = ctx.input_files.size() ? ProcessFiles(ctx) : ProcessInputStream(ctx, cin);
+    }
+    taq_prep::CloseOutputFiles(ctx);
+    if (ctx.all_symbol_groups) {
+      taq_prep::WritePartitionManifests(ctx);
+    }
+    if (ctx.summaries.size()) {
+      taq_prep::WriteDailySummary(ctx);
+    }
+    if (ctx.snapshots.size()) {
+      taq_prep::WriteNbboSnapshot(ctx);
+    }
   } catch (const exception & ex) {
     cerr << ex.what() << endl;
     retval = 3;
@@ -4,9 +4,19 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <cstdint>
 
 #include "taq-proc.h"
+#include "taq-block.h"
+
+namespace boost { namespace interprocess { class mapped_region; } }
 
 namespace taq_prep
 {
@@ -100,24 +110,261 @@ namespace taq_prep
   };
 
 
+  // stream buffer over a memory-mapped file: writes are copied straight into the mapping, which starts preallocated
+  // and doubles when full; the file is written as <path>.tmp and Commit() trims it to the bytes written and renames it
+  // over <path>, so readers never see a partial file; an uncommitted file is removed
+  class MappedFileBuf : public std::streambuf {
+  public:
+    static const size_t INITIAL_CAPACITY = 4 * 1024 * 1024;
+    MappedFileBuf();
+    MappedFileBuf(const MappedFileBuf &) = delete;
+    ~MappedFileBuf();
+    void Open(const std::string & path);
+    bool IsOpen() const { return path_.size(); }
+    void Overwrite(size_t offset, const void * data, size_t size);
+    void Commit();
+  protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char * data, std::streamsize size) override;
+  private:
+    size_t Written() const { return pptr() - pbase(); }
+    void Reserve(size_t size);
+    void Map(size_t capacity, size_t written);
+    void Advance(size_t size);
+    std::string path_;
+    std::string tmp_path_;
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+    size_t capacity_;
+  };
+
+  // writes the records of one product in the layout of the file version: v1 writes each record as it comes, v2 collects
+  // the records of a symbol and writes them column by column when the symbol is finished, v5 and later index the times
+  // of the finished symbol; v8 nbbo writers also index the records marked as price changes; compressed files get a
+  // compressed block whenever BLOCK_RECORDS records of the symbol are collected, and an index of the blocks
+  class SegmentWriter {
+  public:
+    SegmentWriter(Taq::RecordType type, int version);
+    void Write(std::ostream & os, const void * record);
+    void MarkPriceChange();                       // the record just written has other prices than the one before
+    void Finish(std::ostream & os);               // ends the symbol's segment
+    void Append(const SegmentWriter & other);     // other's output was appended to this writer's stream
+    // the symbol map in the layout of the file version, then the time index, the symbol directory, the price index and
+    // the block index
+    void WriteTrailer(std::ostream & os, const std::vector<Taq::SymbolMap> & symbol_map) const;
+  private:
+    void WriteBlock(std::ostream & os);
+    void IndexTimes();
+    int version_;
+    bool compress_;
+    size_t record_size_;
+    std::vector<Taq::FieldLayout> fields_;
+    std::vector<char> packed_;
+    std::vector<std::vector<char>> columns_;
+    std::vector<char> block_;
+    std::vector<char> compressed_;
+    size_t segment_record_cnt_;                   // of the unfinished segment
+    std::vector<int64_t> times_;                  // of the unfinished segment, up to its last block
+    std::vector<Taq::BlockIndexEntry> blocks_;
+    uint64_t block_bytes_;                        // written by WriteBlock
+    int64_t block_record_cnt_;
+    std::vector<Taq::TimeIndexEntry> time_index_;
+    std::vector<uint64_t> buckets_;
+    bool index_prices_;
+    std::vector<Taq::PriceIndexEntry> price_index_;
+    std::vector<uint32_t> positions_;
+    size_t segment_first_position_;               // of the unfinished segment
+  };
+
+  struct OutputFile {
+    Taq::RecordType type;
+    std::string path;
+    MappedFileBuf buffer;
+    std::ostream stream;
+    Taq::FileHeader hdr;
+    OutputFile(Taq::RecordType type, int version)
+      : type(type), stream(&buffer), hdr(type == Taq::RecordType::SecMaster ? Taq::FILE_VERSION_PACKED : version) {
+      hdr.type = type;
+      stream.exceptions(std::ios::badbit);    // failures to grow or map the file must not be lost
+    }
+    void WriteHeader();                         // hdr in the layout of its version, at the start of the stream
+    void RewriteHeader();                       // with the final counts
+  };
+
+  // the NBBO of a symbol at each time of the day's snapshot grid
+  struct SnapshotColumn {
+    std::string symbol;
+    std::vector<Taq::Nbbo> records;
+  };
+
   struct AppContext {
     std::string date;
     std::string symb;
     std::string input_type;
     std::vector<std::string> input_files;
     std::string output_dir;
-    std::string output_file;
-    std::ofstream output;
-    Taq::FileHeader output_file_hdr;
-    AppContext() : output_file_hdr(1) {}
+    std::deque<OutputFile> outputs;  // one per requested record type; quote runs may request nbbo and nbbo-po together
+    int thread_cnt;
+    bool all_symbol_groups;          // --symbol-group all: output files are opened per partition as partitions appear
+    bool sort_input;                 // --sort: rows are ordered by symbol, time and sequence number before processing
+    size_t sort_memory_mb;
+    int file_version;                // FileHeader::version of quote and trade files, with FILE_FLAG_COMPRESSED for --compress
+    bool compress;                   // --compress
+    int partition_cnt;               // --partitions
+    size_t partition_mb;             // --partition-mb
+    uint64_t partition_bytes;        // input bytes per partition, 0 to partition by first letter
+    std::vector<Taq::PartitionEntry> partitions;   // written so far, for the manifest
+    std::vector<std::string> quote_files;          // --quote-files: whole-day quotes for trade-nbbo and bar
+    std::vector<Taq::DailySummary> summaries;      // of the symbols processed, merged into the day's summary file
+    int snapshot_interval;                         // --snapshot-interval in seconds, 0 for no snapshot file
+    std::vector<SnapshotColumn> snapshots;         // of the symbols processed, merged into the day's snapshot file
+    AppContext() : thread_cnt(1), all_symbol_groups(false), sort_input(false), sort_memory_mb(1024),
+                   file_version(Taq::FILE_VERSION_PRICE_INDEX), compress(false), partition_cnt(0), partition_mb(0), partition_bytes(0),
+                   snapshot_interval(0) {}
+  };
+
+  typedef uint32_t SymbolId;
+
+  // dense ids for symbols in order of first appearance, so per-symbol state can live in vectors indexed by id;
+  // further names of a symbol (e.g. the UTP form of a CTA symbol) may be added as aliases of its id
+  class SymbolTable {
+  public:
+    static const SymbolId NO_SYMBOL = UINT32_MAX;
+    SymbolTable() : size_(0), last_id_(NO_SYMBOL) {}
+    SymbolTable(const SymbolTable &) = delete;     // keys refer to names_, which only a move keeps in place
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable & operator=(SymbolTable &&) = default;
+    SymbolId Intern(std::string_view symbol);      // repeated calls with the same symbol skip the hash lookup
+    void Alias(std::string_view symbol, SymbolId id);
+    SymbolId Find(std::string_view symbol) const;
+    size_t size() const { return size_; }
+    void Clear();
+  private:
+    void Add(std::string_view symbol, SymbolId id);
+    std::deque<std::string> names_;                // stable storage for the keys of ids_
+    std::unordered_map<std::string_view, SymbolId> ids_;
+    SymbolId size_;
+    SymbolId last_id_;
+    std::string_view last_symbol_;
+  };
+
+  struct InputSegment {
+    std::string path;
+    uint64_t begin;
+    uint64_t end;
+  };
+  typedef std::vector<InputSegment> InputShard;
+
+  // input cut at a symbol boundary: a copy of its own for compressed or streamed input, otherwise ranges of the
+  // input files that are mapped only while the chunk is read
+  struct InputChunk {
+    std::vector<char> buffer;
+    InputShard segments;
+    uint64_t size() const;
+  };
+
+  // field of pipe-separated input; like std::string, indexing one past the last character yields '\0'
+  class PsvField : public std::string_view {
+  public:
+    PsvField() = default;
+    PsvField(const char* data, size_t size) : std::string_view(data, size) {}
+    char operator[](size_t idx) const { return idx < size() ? data()[idx] : '\0'; }
+  };
+
+  // one line of pipe-separated input; fields point into the input buffer and are valid only inside the row consumer
+  class PsvRow {
+  public:
+    static const size_t MAX_FIELDS = 64;
+    PsvRow() : size_(0) {}
+    size_t size() const { return size_; }
+    PsvField operator[](size_t idx) const { return idx < size_ && idx < MAX_FIELDS ? fields_[idx] : PsvField(); }
+    std::string_view Line() const { return line_; }
+    void Clear(const char* line_start) { size_ = 0; line_ = std::string_view(line_start, 0); }
+    void Push(const char* field_start, const char* field_end) {
+      if (size_ < MAX_FIELDS) {
+        fields_[size_] = PsvField(field_start, field_end - field_start);
+      }
+      size_++;
+      line_ = std::string_view(line_.data(), field_end - line_.data());
+    }
+  private:
+    PsvField fields_[MAX_FIELDS];
+    std::string_view line_;
+    size_t size_;
+  };
+  typedef std::function<void(const PsvRow&)> RowConsumer;
+  typedef std::function<void(const RowConsumer&)> InputReader;
+  typedef std::function<void(const PsvRow&, uint64_t)> ChunkRowConsumer;   // row and its byte offset in the chunk
+  typedef std::function<void(InputChunk&&)> ChunkConsumer;
+  typedef std::function<size_t(char*, size_t)> BlockReader;   // fills up to size bytes, returns 0 at end of input
+
+  // external merge sort of input rows by (symbol, time, sequence number), stable for equal keys; rows are collected
+  // up to the memory budget, each batch is sorted and spilled to a run file in tmp_dir once the budget is exceeded,
+  // and the runs are merged as the sorted text is read back, in several passes when there are more runs than the
+  // budget has file buffers for
+  class ExternalSort {
+  public:
+    ExternalSort(const std::string & tmp_dir, size_t memory_budget, int symbol_column, int time_column, int seq_column);
+    ~ExternalSort();
+    void Add(const PsvRow & row);                 // header, trailer and empty rows are dropped
+    size_t Read(char * data, size_t size);        // no Add after the first Read
+  private:
+    struct State;
+    std::unique_ptr<State> state_;
+  };
+
+  typedef std::map<std::string, std::vector<Taq::Nbbo>> NbboTimelines;   // the NBBO changes of each symbol
+
+  // NBBO changes of whole-day quote input ordered by symbol, computed chunk by chunk on worker threads ahead of the
+  // trades that look them up; the trades must come in the same symbol order, which keeps the join a single pass over
+  // both inputs and bounds the quotes held in memory
+  class PrevailingQuotes {
+  public:
+    PrevailingQuotes(const std::vector<std::string> & quote_files, int thread_cnt);
+    ~PrevailingQuotes();
+    // the NBBO changes of the symbols from first to last; symbols before last are dropped, so later calls must ask for
+    // symbols after it
+    NbboTimelines Take(const std::string & first, const std::string & last);
+  private:
+    struct State;
+    std::unique_ptr<State> state_;
   };
 
-int ProcessSecMaster(AppContext &, std::istream & is);
-int ProcessQuotes(AppContext &, std::istream & is);
-int ProcessTrades(AppContext &, std::istream & is);
+int ProcessSecMaster(AppContext &, const InputReader & input);
+int ProcessQuotes(AppContext &, const InputReader & input);
+int ProcessQuoteFiles(AppContext &);
+int ProcessQuoteStream(AppContext &, std::istream & is);
+int ProcessQuoteBlocks(AppContext &, const BlockReader & reader);
+void OpenOutputFiles(AppContext &, const std::string & partition);
+void CloseOutputFiles(AppContext &);
+std::string SymbolPartition(const AppContext &, std::string_view symbol, uint64_t offset);
+void AddToPartition(AppContext &, const std::string & partition, const std::string & first_symbol,
+                    const std::string & last_symbol);
+void WritePartitionManifests(const AppContext &);
+int ProcessTrades(AppContext &, const InputReader & input);
+int ProcessTradeFiles(AppContext &);
+int ProcessTradeStream(AppContext &, std::istream & is);
+int ProcessTradeBlocks(AppContext &, const BlockReader & reader);
 void LoadSecMaster(AppContext &);
-char PrimaryExchange(const std::string symbol);
+SymbolId SecuritySymbolId(std::string_view symbol);
+char PrimaryExchange(SymbolId symbol_id);
+const std::vector<Taq::Security> & SecMasterSecurities();
+size_t SecurityIndex(SymbolId symbol_id);        // of the security in the master file
+void WriteDailySummary(AppContext &);
+void WriteNbboSnapshot(AppContext &);
 std::string CtaToUtp(const std::string& cta_symbol);
+std::vector<InputShard> SplitInputFiles(const std::vector<std::string>& files, size_t shard_cnt, int symbol_column);
+void ReadInputShard(const InputShard& shard, const RowConsumer& consumer);
+void ReadInputStream(std::istream& is, const RowConsumer& consumer);
+void ReadInputBlocks(const BlockReader& reader, const RowConsumer& consumer);
+void ReadInputBuffer(const char* data, size_t size, const RowConsumer& consumer);
+bool IsCompressedInput(const std::string& path);
+bool IsCompressedInput(const std::vector<std::string>& files);
+void ReadInputFiles(const std::vector<std::string>& files, const RowConsumer& consumer);
+void ReadInputChunks(const std::vector<std::string>& files, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer);
+void ReadInputStreamChunks(std::istream& is, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer);
+void ReadInputBlockChunks(const BlockReader& reader, size_t chunk_size, int symbol_column, const ChunkConsumer& consumer);
+void ReadInputChunk(const InputChunk& chunk, const ChunkRowConsumer& consumer);
+void ChunkSymbolRange(const InputChunk& chunk, int symbol_column, std::string& first, std::string& last);
 
 }
 
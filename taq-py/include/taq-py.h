@@ -39,16 +39,20 @@
 #ifdef __unix__
 #pragma GCC diagnostic pop
 #endif
+#include "taq-parse.h"
 
 using namespace std;
 using namespace boost::asio;
 using namespace boost::property_tree;
 namespace py = pybind11;
+using Taq::ParseInt;
+using Taq::ParseDouble;
 
 using str6 = char[6];
 using str12 = char[12]; // Date 1970-01-01 1970-Jan-01
 using str18 = char[18]; // Symbol
 using str20 = char[20]; // Time 12:30:00.123456789
+using str28 = char[28]; // Exchanges -ABCDEFGHIJKLMNOPQRSTUVWXYZ
 using str36 = char[36]; // Timestamp 1970-01-01T12:30:00.123456789+00:00
 using str64 = char[64]; // Order ID
 
@@ -98,6 +102,16 @@ ptree StringToJson(const string &);
 
 py::list ExecuteROD(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
 py::list ExecuteQuote(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+py::list ExecuteVenueNbbo(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+py::list ExecuteTradeSign(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+py::list ExecuteBars(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+py::list ExecuteDailyStats(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+py::list ExecuteSnapshot(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs);
+
+// tick-calc leaves a value it has no data for empty, e.g. the effective spread of a trade without a quote
+inline double ParseOptionalDouble(const string& text) {
+  return text.empty() ? numeric_limits<double>::quiet_NaN() : ParseDouble(text);
+}
 
 inline void StringCopy(char* desc, const char* src, size_t len) {
 #ifdef _MSC_VER
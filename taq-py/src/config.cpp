@@ -18,6 +18,108 @@ map<string, FunctionDef> tick_functions = {
         }
       )
   },
+  {
+    "VenueNbbo",
+    FunctionDef(
+        "America/New_York", {
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("Timestamp", typeid(char).name(), 36),
+          FieldsDef("Exchanges", typeid(char).name(), 28)
+        }, {
+          FieldsDef("ID", typeid(int).name(), sizeof(int)),
+          FieldsDef("Timestamp", typeid(char).name(), 20),
+          FieldsDef("BestBidPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("BestBidQty", typeid(int).name(), sizeof(int)),
+          FieldsDef("BestOfferPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("BestOfferQty", typeid(int).name(), sizeof(int))
+        }
+      )
+  },
+  {
+    "TradeSign",
+    FunctionDef(
+        "America/New_York", {
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("Date", typeid(char).name(), 12),
+          FieldsDef("StartTime", typeid(char).name(), 20),
+          FieldsDef("EndTime", typeid(char).name(), 20)
+        }, {
+          FieldsDef("ID", typeid(int).name(), sizeof(int)),
+          FieldsDef("Timestamp", typeid(char).name(), 20),
+          FieldsDef("TradePx", typeid(double).name(), sizeof(double)),
+          FieldsDef("TradeQty", typeid(int).name(), sizeof(int)),
+          FieldsDef("Side", typeid(char).name(), 6),
+          FieldsDef("EffectiveSpread", typeid(double).name(), sizeof(double)),
+          FieldsDef("QuoteTimestamp", typeid(char).name(), 20)
+        }
+      )
+  },
+  {
+    "Bars",
+    FunctionDef(
+        "America/New_York", {
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("Date", typeid(char).name(), 12),
+          FieldsDef("StartTime", typeid(char).name(), 20),
+          FieldsDef("EndTime", typeid(char).name(), 20),
+          FieldsDef("Interval", typeid(int).name(), sizeof(int))
+        }, {
+          FieldsDef("ID", typeid(int).name(), sizeof(int)),
+          FieldsDef("Timestamp", typeid(char).name(), 20),
+          FieldsDef("OpenPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("HighPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("LowPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("ClosePx", typeid(double).name(), sizeof(double)),
+          FieldsDef("Volume", typeid(double).name(), sizeof(double)),
+          FieldsDef("VeVolume", typeid(double).name(), sizeof(double)),
+          FieldsDef("TradeCount", typeid(int).name(), sizeof(int)),
+          FieldsDef("MidPx", typeid(double).name(), sizeof(double))
+        }
+      )
+  },
+  {
+    "DailyStats",
+    FunctionDef(
+        "UTC", {
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("StartDate", typeid(char).name(), 12),
+          FieldsDef("EndDate", typeid(char).name(), 12)
+        }, {
+          FieldsDef("ID", typeid(int).name(), sizeof(int)),
+          FieldsDef("Days", typeid(int).name(), sizeof(int)),
+          FieldsDef("OpenPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("HighPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("LowPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("ClosePx", typeid(double).name(), sizeof(double)),
+          FieldsDef("Volume", typeid(double).name(), sizeof(double)),
+          FieldsDef("VeVolume", typeid(double).name(), sizeof(double)),
+          FieldsDef("AvgVeVolume", typeid(double).name(), sizeof(double)),
+          FieldsDef("Vwap", typeid(double).name(), sizeof(double)),
+          FieldsDef("TradeCount", typeid(double).name(), sizeof(double)),
+          FieldsDef("QuoteCount", typeid(double).name(), sizeof(double)),
+          FieldsDef("NbboCount", typeid(double).name(), sizeof(double)),
+          FieldsDef("AvgSpread", typeid(double).name(), sizeof(double)),
+          FieldsDef("NbboUpdateRate", typeid(double).name(), sizeof(double))
+        }
+      )
+  },
+  {
+    "Snapshot",
+    FunctionDef(
+        "America/New_York", {
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("Timestamp", typeid(char).name(), 36)
+        }, {
+          FieldsDef("ID", typeid(int).name(), sizeof(int)),
+          FieldsDef("Symbol", typeid(char).name(), 18),
+          FieldsDef("Timestamp", typeid(char).name(), 20),
+          FieldsDef("BestBidPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("BestBidQty", typeid(int).name(), sizeof(int)),
+          FieldsDef("BestOfferPx", typeid(double).name(), sizeof(double)),
+          FieldsDef("BestOfferQty", typeid(int).name(), sizeof(int))
+        }
+      )
+  },
   {
     "ROD",
     FunctionDef(
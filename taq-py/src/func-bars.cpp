@@ -0,0 +1,83 @@
+#include "taq-py.h"
+
+py::list ExecuteBars(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs) {
+  const string separator = req_json.get<string>("separator", "|");
+  const ssize_t input_cnt = req_json.get<ssize_t>("input_cnt", 0);
+  vector<function<void(ostream& os, size_t)>> func;
+  ostringstream ss;
+
+  py::array_t<str18> arr_symb = kwargs["Symbol"].cast<py::array_t<str18>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_symb.at(i) << separator; });
+
+  py::array_t<str12> arr_date = kwargs["Date"].cast<py::array_t<str12>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_date.at(i) << separator; });
+
+  py::array_t<str20> arr_start = kwargs["StartTime"].cast<py::array_t<str20>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_start.at(i) << separator; });
+
+  py::array_t<str20> arr_end = kwargs["EndTime"].cast<py::array_t<str20>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_end.at(i) << separator; });
+
+  py::array_t<int> arr_interval = kwargs["Interval"].cast<py::array_t<int>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_interval.at(i) << endl; });
+
+  tcptream << JsonToString(req_json) << endl;;
+  for (auto i = 0; i < input_cnt; i++) {
+    for_each(func.begin(), func.end(), [&](auto f) {f(ss, i); });
+    if (ss.str().size() > 64 * 1024) {
+      tcptream << ss.str();
+      ss.str("");
+      ss.clear();
+    }
+  }
+  tcptream << ss.str();
+
+  string json_str;
+  getline(tcptream, json_str);
+  ptree response = StringToJson(json_str);
+  const size_t record_cnt = response.get<size_t>("output_records", 0);
+  py::array_t<int> id((record_cnt));
+  py::array_t<str20> time(record_cnt); // start of the interval 09:35:00.000000000
+  memset(time.mutable_data(), 0, time.nbytes());
+  py::array_t<double> openp((record_cnt));
+  py::array_t<double> highp((record_cnt));
+  py::array_t<double> lowp((record_cnt));
+  py::array_t<double> closep((record_cnt));
+  py::array_t<double> volume((record_cnt));
+  py::array_t<double> ve_volume((record_cnt));
+  py::array_t<int> trade_cnt((record_cnt));
+  py::array_t<double> mid((record_cnt));
+
+  int line_cnt = 0;
+  string line;
+  vector<string> values;
+  while (getline(tcptream, line)) {
+    values.clear();
+    boost::split(values, line, boost::is_any_of("|"));
+    id.mutable_at(line_cnt) = ParseInt(values[0]);
+    StringCopy(time.mutable_at(line_cnt), values[1].c_str(), sizeof(str20));
+    openp.mutable_at(line_cnt) = ParseDouble(values[2]);
+    highp.mutable_at(line_cnt) = ParseDouble(values[3]);
+    lowp.mutable_at(line_cnt) = ParseDouble(values[4]);
+    closep.mutable_at(line_cnt) = ParseDouble(values[5]);
+    volume.mutable_at(line_cnt) = ParseDouble(values[6]);
+    ve_volume.mutable_at(line_cnt) = ParseDouble(values[7]);
+    trade_cnt.mutable_at(line_cnt) = ParseInt(values[8]);
+    mid.mutable_at(line_cnt) = ParseOptionalDouble(values[9]);
+    line_cnt++;
+  }
+  py::list retval;
+  retval.append(json_str);
+  retval.append(id);
+  retval.append(time);
+  retval.append(openp);
+  retval.append(highp);
+  retval.append(lowp);
+  retval.append(closep);
+  retval.append(volume);
+  retval.append(ve_volume);
+  retval.append(trade_cnt);
+  retval.append(mid);
+  tcptream.close();
+  return retval;
+}
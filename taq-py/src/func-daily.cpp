@@ -0,0 +1,65 @@
+#include "taq-py.h"
+
+py::list ExecuteDailyStats(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs) {
+  const string separator = req_json.get<string>("separator", "|");
+  const ssize_t input_cnt = req_json.get<ssize_t>("input_cnt", 0);
+  vector<function<void(ostream& os, size_t)>> func;
+  ostringstream ss;
+
+  py::array_t<str18> arr_symb = kwargs["Symbol"].cast<py::array_t<str18>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_symb.at(i) << separator; });
+
+  py::array_t<str12> arr_start = kwargs["StartDate"].cast<py::array_t<str12>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_start.at(i) << separator; });
+
+  py::array_t<str12> arr_end = kwargs["EndDate"].cast<py::array_t<str12>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_end.at(i) << endl; });
+
+  tcptream << JsonToString(req_json) << endl;;
+  for (auto i = 0; i < input_cnt; i++) {
+    for_each(func.begin(), func.end(), [&](auto f) {f(ss, i); });
+    if (ss.str().size() > 64 * 1024) {
+      tcptream << ss.str();
+      ss.str("");
+      ss.clear();
+    }
+  }
+  tcptream << ss.str();
+
+  string json_str;
+  getline(tcptream, json_str);
+  ptree response = StringToJson(json_str);
+  const size_t record_cnt = response.get<size_t>("output_records", 0);
+  py::array_t<int> id((record_cnt));
+  py::array_t<int> days((record_cnt));
+  // OpenPx to NbboUpdateRate; prices are empty, and so NaN, when no trade of the range was eligible for last sale, and
+  // volumes and counts of a long range can pass the int range
+  const size_t double_cnt = 13;
+  vector<py::array_t<double>> columns;
+  for (size_t column = 0; column < double_cnt; column++) {
+    columns.emplace_back(record_cnt);
+  }
+
+  int line_cnt = 0;
+  string line;
+  vector<string> values;
+  while (getline(tcptream, line)) {
+    values.clear();
+    boost::split(values, line, boost::is_any_of("|"));
+    id.mutable_at(line_cnt) = ParseInt(values[0]);
+    days.mutable_at(line_cnt) = ParseInt(values[1]);
+    for (size_t column = 0; column < columns.size(); column++) {
+      columns[column].mutable_at(line_cnt) = ParseOptionalDouble(values[column + 2]);
+    }
+    line_cnt++;
+  }
+  py::list retval;
+  retval.append(json_str);
+  retval.append(id);
+  retval.append(days);
+  for (auto & column : columns) {
+    retval.append(column);
+  }
+  tcptream.close();
+  return retval;
+}
@@ -41,12 +41,12 @@ py::list ExecuteQuote(const ptree& req_json, ip::tcp::iostream& tcptream, const
   while (getline(tcptream, line)) {
     values.clear();
     boost::split(values, line, boost::is_any_of("|"));
-    id.mutable_at(line_cnt) = stoi(values[0]);
+    id.mutable_at(line_cnt) = ParseInt(values[0]);
     StringCopy(time.mutable_at(line_cnt), values[1].c_str(), sizeof(str20));
-    bidp.mutable_at(line_cnt) = stod(values[2]);
-    bids.mutable_at(line_cnt) = stoi(values[3]);
-    askp.mutable_at(line_cnt) = stod(values[4]);
-    asks.mutable_at(line_cnt) = stoi(values[5]);
+    bidp.mutable_at(line_cnt) = ParseDouble(values[2]);
+    bids.mutable_at(line_cnt) = ParseInt(values[3]);
+    askp.mutable_at(line_cnt) = ParseDouble(values[4]);
+    asks.mutable_at(line_cnt) = ParseInt(values[5]);
     line_cnt++;
   }
   py::list retval;
@@ -0,0 +1,73 @@
+#include "taq-py.h"
+
+py::list ExecuteTradeSign(const ptree& req_json, ip::tcp::iostream& tcptream, const py::kwargs& kwargs) {
+  const string separator = req_json.get<string>("separator", "|");
+  const ssize_t input_cnt = req_json.get<ssize_t>("input_cnt", 0);
+  vector<function<void(ostream& os, size_t)>> func;
+  ostringstream ss;
+
+  py::array_t<str18> arr_symb = kwargs["Symbol"].cast<py::array_t<str18>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_symb.at(i) << separator; });
+
+  py::array_t<str12> arr_date = kwargs["Date"].cast<py::array_t<str12>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_date.at(i) << separator; });
+
+  py::array_t<str20> arr_start = kwargs["StartTime"].cast<py::array_t<str20>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_start.at(i) << separator; });
+
+  py::array_t<str20> arr_end = kwargs["EndTime"].cast<py::array_t<str20>>();
+  func.push_back([&](ostream& os, ssize_t i) {os << arr_end.at(i) << endl; });
+
+  tcptream << JsonToString(req_json) << endl;;
+  for (auto i = 0; i < input_cnt; i++) {
+    for_each(func.begin(), func.end(), [&](auto f) {f(ss, i); });
+    if (ss.str().size() > 64 * 1024) {
+      tcptream << ss.str();
+      ss.str("");
+      ss.clear();
+    }
+  }
+  tcptream << ss.str();
+
+  string json_str;
+  getline(tcptream, json_str);
+  ptree response = StringToJson(json_str);
+  const size_t record_cnt = response.get<size_t>("output_records", 0);
+  py::array_t<int> id((record_cnt));
+  py::array_t<str20> time(record_cnt); // 09:35:28.123456789
+  memset(time.mutable_data(), 0, time.nbytes());
+  py::array_t<double> price((record_cnt));
+  py::array_t<int> qty((record_cnt));
+  py::array_t<str6> side(record_cnt); // B, S or empty when the tick test has no price change yet
+  memset(side.mutable_data(), 0, side.nbytes());
+  py::array_t<double> spread((record_cnt));
+  py::array_t<str20> quote_time(record_cnt);
+  memset(quote_time.mutable_data(), 0, quote_time.nbytes());
+
+  int line_cnt = 0;
+  string line;
+  vector<string> values;
+  while (getline(tcptream, line)) {
+    values.clear();
+    boost::split(values, line, boost::is_any_of("|"));
+    id.mutable_at(line_cnt) = ParseInt(values[0]);
+    StringCopy(time.mutable_at(line_cnt), values[1].c_str(), sizeof(str20));
+    price.mutable_at(line_cnt) = ParseDouble(values[2]);
+    qty.mutable_at(line_cnt) = ParseInt(values[3]);
+    StringCopy(side.mutable_at(line_cnt), values[4].c_str(), sizeof(str6));
+    spread.mutable_at(line_cnt) = ParseOptionalDouble(values[5]);
+    StringCopy(quote_time.mutable_at(line_cnt), values[6].c_str(), sizeof(str20));
+    line_cnt++;
+  }
+  py::list retval;
+  retval.append(json_str);
+  retval.append(id);
+  retval.append(time);
+  retval.append(price);
+  retval.append(qty);
+  retval.append(side);
+  retval.append(spread);
+  retval.append(quote_time);
+  tcptream.close();
+  return retval;
+}
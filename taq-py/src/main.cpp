@@ -97,6 +97,16 @@ py::list Execute(py::args args, py::kwargs kwargs) {
       return ExecuteROD(req_json, tcptream, kwargs);
     } if (function_name == "Quote") {
       return ExecuteQuote(req_json, tcptream, kwargs);
+    } else if (function_name == "VenueNbbo") {
+      return ExecuteVenueNbbo(req_json, tcptream, kwargs);
+    } else if (function_name == "TradeSign") {
+      return ExecuteTradeSign(req_json, tcptream, kwargs);
+    } else if (function_name == "Bars") {
+      return ExecuteBars(req_json, tcptream, kwargs);
+    } else if (function_name == "DailyStats") {
+      return ExecuteDailyStats(req_json, tcptream, kwargs);
+    } else if (function_name == "Snapshot") {
+      return ExecuteSnapshot(req_json, tcptream, kwargs);
     } else {
       throw domain_error("Unknown function:" + function_name);
     }
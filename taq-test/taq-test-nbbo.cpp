@@ -0,0 +1,287 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <limits>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#include "taq-nbbo.h"
+
+// ResetNbboSide of taq-nbbo.h against the loop over an array of per-exchange quotes it replaced: price, aggregate size
+// and exchange mask must be identical on books with ties, unset quotes, quotes at the no-price and NaN prices; the
+// same source is built once per code path, see CMakeLists.txt. Given a TAQ quote file sorted by symbol, its quotes are
+// also replayed through UpdateNbboSide against the update over the array of quotes, checked quote by quote, and the
+// time per quote of both is printed
+//   taq-test-nbbo [books, default 200000] [quote file]
+
+using namespace std;
+using namespace Taq;
+
+namespace {
+
+#if defined(__AVX2__)
+const char* CODE_PATH = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+const char* CODE_PATH = "SSE2";
+#else
+const char* CODE_PATH = "scalar";
+#endif
+
+const int SKIPPED = 77;      // ctest SKIP_RETURN_CODE
+
+struct BboSide {
+  double price;
+  int size;
+  bool is_set;
+  BboSide() : price(.0), size(0), is_set(false) { }
+};
+
+void OldResetNbboSide(const BboSide * exchange_quotes, NbboSide::Side side, NbboSide & best_quote) {
+  auto is_better = side == NbboSide::BID
+    ? [] (double bid, double best_bid) { return bid > best_bid; }
+    : [] (double offer, double best_offer) { return offer < best_offer; };
+
+  best_quote.price = side == NbboSide::BID ? 0 : numeric_limits<double>::max();
+  best_quote.size = 0;
+  best_quote.exch_mask.reset();
+  for (int i = 0; i < Exch_Max; i ++ ) {
+    const BboSide & quote = exchange_quotes[i];
+    if (quote.is_set) {
+      if (is_better(quote.price, best_quote.price)) { // replace best quote
+        best_quote.exch_mask.reset();
+        best_quote.exch_mask.set(i);
+        best_quote.price = quote.price;
+        best_quote.size = quote.size;
+      } else if (quote.price == best_quote.price) { // join best quote
+        best_quote.exch_mask.set(i);
+        best_quote.size += quote.size;
+      }
+    }
+  }
+}
+
+// the update of taq-prep before the exchange book, over an array of per-exchange quotes
+void OldUpdateNbboSide(BboSide * exchange_quotes, NbboSide::Side side, int exch_idx, const BboSide & new_quote,
+                       NbboSide & best_quote) {
+  BboSide & current_quote = exchange_quotes[exch_idx];
+  auto is_better = side == NbboSide::BID
+    ? [] (double bid, double best_bid) { return bid > best_bid; }
+    : [] (double offer, double best_offer) { return offer < best_offer; };
+  if (new_quote.is_set) {
+    if (is_better(new_quote.price, best_quote.price)) {
+      best_quote.exch_mask.reset();
+      best_quote.exch_mask.set(exch_idx);
+      best_quote.price = new_quote.price;
+      best_quote.size = new_quote.size;
+    } else if (new_quote.price == best_quote.price) {
+      if (best_quote.exch_mask.test(exch_idx)) {
+        best_quote.size += (new_quote.size - current_quote.size);
+      } else {
+        best_quote.exch_mask.set(exch_idx);
+        best_quote.size += new_quote.size;
+      }
+    } else if (best_quote.exch_mask.test(exch_idx)) {
+      if (best_quote.exch_mask.count() > 1) {
+        best_quote.size -= current_quote.size;
+        best_quote.exch_mask.set(exch_idx, 0);
+      } else {
+        current_quote = new_quote;
+        OldResetNbboSide(exchange_quotes, side, best_quote);
+      }
+    }
+  } else if (best_quote.exch_mask.test(exch_idx)) {
+    if (best_quote.exch_mask.count() > 1) {
+      best_quote.size -= current_quote.size;
+      best_quote.exch_mask.set(exch_idx, 0);
+    } else {
+      current_quote = new_quote;
+      OldResetNbboSide(exchange_quotes, side, best_quote);
+    }
+  }
+  current_quote = new_quote;
+  if (best_quote.size == 0) {
+    best_quote.price = NbboSide::NoPrice(side);
+  }
+}
+
+// few distinct prices so most books have several exchanges at the best; set_pct of the quotes are set
+BboSide RandomQuote(mt19937 & rng, NbboSide::Side side, int set_pct) {
+  BboSide quote;
+  const int what = uniform_int_distribution<int>(0, 99)(rng);
+  quote.is_set = uniform_int_distribution<int>(0, 99)(rng) < set_pct;
+  if (what < 2) {
+    quote.price = NbboSide::NoPrice(side);
+  } else if (what < 3) {
+    quote.price = numeric_limits<double>::quiet_NaN();
+  } else {
+    quote.price = 100 + uniform_int_distribution<int>(0, 4)(rng) * 0.01;
+  }
+  quote.size = uniform_int_distribution<int>(1, what < 5 ? 1000000 : 9)(rng);
+  return quote;
+}
+
+bool SameSide(const NbboSide & a, const NbboSide & b) {
+  return (a.price == b.price || (a.price != a.price && b.price != b.price)) && a.size == b.size
+      && a.exch_mask == b.exch_mask;
+}
+
+template <NbboSide::Side side>
+int CheckBooks(int count) {
+  mt19937 rng(20200801 + side);
+  int mismatches = 0;
+  for (int n = 0; n < count; n++) {
+    // empty books, books of one or two quotes and books with no NaN or regular price at all come up regularly
+    static const int set_pcts[] = { 0, 5, 10, 70, 100 };
+    const int set_pct = set_pcts[n % 5];
+    const bool no_price_only = n % 7 == 0;
+    BboSide quotes[Exch_Max];
+    ExchangeBook book(side);
+    for (int i = 0; i < Exch_Max; i++) {
+      // the book sees every exchange set and reset at least once, as quote updates do
+      quotes[i] = RandomQuote(rng, side, set_pct);
+      if (no_price_only) {
+        quotes[i].price = NbboSide::NoPrice(side);
+      }
+      book.Set(side, i, true, 1, 1);
+      book.Set(side, i, quotes[i].is_set, quotes[i].price, quotes[i].size);
+    }
+    NbboSide expected(side), actual(side);
+    OldResetNbboSide(quotes, side, expected);
+    ResetNbboSide<side>(book, actual);
+    if (false == SameSide(expected, actual) && ++mismatches <= 10) {
+      cout << (side == NbboSide::BID ? "bid" : "offer") << " book " << n << " : " << actual.price << ' ' << actual.size
+           << ' ' << actual.exch_mask << " expected " << expected.price << ' ' << expected.size << ' '
+           << expected.exch_mask << endl;
+    }
+  }
+  cout << CODE_PATH << ' ' << (side == NbboSide::BID ? "bid" : "offer") << " : " << count << " books, " << mismatches
+       << " mismatches" << endl;
+  return mismatches;
+}
+
+// a quote of the replay, with the validity taq-prep gives each side
+struct QuoteEvent {
+  bool new_symbol;
+  int exch_idx;
+  BboSide bid;
+  BboSide offer;
+};
+
+vector<QuoteEvent> LoadQuotes(const string & file_name) {
+  enum { Time, Exchange, Symbol, Bid_Price, Bid_Size, Offer_Price, Offer_Size, Quote_Condition, Source_Of_Quote = 13 };
+  vector<QuoteEvent> quotes;
+  ifstream is(file_name);
+  string line, last_symbol;
+  vector<string> values;
+  while (getline(is, line)) {
+    values.clear();
+    istringstream ls(line);
+    for (string value; getline(ls, value, '|'); ) {
+      values.push_back(value);
+    }
+    if (values.size() <= Source_Of_Quote || values[Time] == "Time" || values[Time] == "END") {
+      continue;
+    }
+    QuoteEvent quote;
+    quote.new_symbol = values[Symbol] != last_symbol;
+    last_symbol = values[Symbol];
+    quote.exch_idx = values[Exchange][0] - 'A';
+    quote.bid.price = stod(values[Bid_Price]);
+    quote.bid.size = stoi(values[Bid_Size]);
+    quote.offer.price = stod(values[Offer_Price]);
+    quote.offer.size = stoi(values[Offer_Size]);
+    const char cond = values[Quote_Condition][0];
+    const bool valid = string(values[Source_Of_Quote][0] == 'C' ? "CLNU4" : "FILNUXZ4").find(cond) == string::npos;
+    quote.bid.is_set = valid && cond != 'E' && quote.bid.size > 0;
+    quote.offer.is_set = valid && cond != 'F' && quote.offer.size > 0;
+    quotes.push_back(quote);
+  }
+  return quotes;
+}
+
+struct OldReplay {
+  BboSide bids[Exch_Max];
+  BboSide offers[Exch_Max];
+  NbboSide bid, offer;
+  OldReplay() : bid(NbboSide::BID), offer(NbboSide::OFFER) {}
+  void Update(const QuoteEvent & quote) {
+    OldUpdateNbboSide(bids, NbboSide::BID, quote.exch_idx, quote.bid, bid);
+    OldUpdateNbboSide(offers, NbboSide::OFFER, quote.exch_idx, quote.offer, offer);
+  }
+};
+
+struct Replay {
+  ExchangeBook bids, offers;
+  NbboSide bid, offer;
+  Replay() : bids(NbboSide::BID), offers(NbboSide::OFFER), bid(NbboSide::BID), offer(NbboSide::OFFER) {}
+  void Update(const QuoteEvent & quote) {
+    UpdateNbboSide<NbboSide::BID>(bids, bid, quote.exch_idx, quote.bid.is_set, quote.bid.price, quote.bid.size);
+    UpdateNbboSide<NbboSide::OFFER>(offers, offer, quote.exch_idx, quote.offer.is_set, quote.offer.price,
+                                    quote.offer.size);
+  }
+};
+
+int CheckReplay(const string & file_name) {
+  const vector<QuoteEvent> quotes = LoadQuotes(file_name);
+  int mismatches = 0;
+  OldReplay expected;
+  Replay actual;
+  for (size_t n = 0; n < quotes.size(); n++) {
+    if (quotes[n].new_symbol) {
+      expected = OldReplay();
+      actual = Replay();
+    }
+    expected.Update(quotes[n]);
+    actual.Update(quotes[n]);
+    if ((false == SameSide(expected.bid, actual.bid) || false == SameSide(expected.offer, actual.offer))
+        && ++mismatches <= 10) {
+      cout << "quote " << n << " : " << actual.bid.price << ' ' << actual.bid.size << ' ' << actual.offer.price << ' '
+           << actual.offer.size << " expected " << expected.bid.price << ' ' << expected.bid.size << ' '
+           << expected.offer.price << ' ' << expected.offer.size << endl;
+    }
+  }
+  cout << CODE_PATH << " replay : " << quotes.size() << " quotes, " << mismatches << " mismatches" << endl;
+
+  // the symbol's books are reset at each new symbol, as taq-prep starts every symbol with an empty entry
+  auto time_per_quote = [&](auto & replay) {
+    double sum = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int round = 0; round < 10; round++) {
+      for (const QuoteEvent & quote : quotes) {
+        if (quote.new_symbol) {
+          replay = remove_reference_t<decltype(replay)>();
+        }
+        replay.Update(quote);
+        sum += replay.bid.size + replay.offer.size;
+      }
+    }
+    const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return make_pair(elapsed.count() / (10 * max<size_t>(quotes.size(), 1)), sum);
+  };
+  Replay replay;
+  OldReplay old_replay;
+  const auto fast_time = time_per_quote(replay);
+  const auto reference_time = time_per_quote(old_replay);
+  cout << CODE_PATH << " UpdateNbboSide : " << fast_time.first << " ns per quote, array of quotes "
+       << reference_time.first << " ns" << endl;
+  return mismatches;
+}
+
+}
+
+int main(int argc, char** argv) {
+#if defined(__AVX2__) && defined(__GNUC__)
+  if (false == __builtin_cpu_supports("avx2")) {
+    cout << "AVX2 not supported, skipped" << endl;
+    return SKIPPED;
+  }
+#endif
+  const int count = argc > 1 ? atoi(argv[1]) : 200000;
+  int failures = CheckBooks<NbboSide::BID>(count) + CheckBooks<NbboSide::OFFER>(count);
+  if (argc > 2) {
+    failures += CheckReplay(argv[2]);
+  }
+  return failures ? 1 : 0;
+}
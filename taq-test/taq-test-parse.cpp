@@ -0,0 +1,256 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <typeinfo>
+#include <functional>
+
+#include "boost-algorithm-string.h"
+#include "taq-time.h"
+
+// the fast parsers of taq-parse.h behind MkTaqTime, MkTaqDate, MkTime, MkDate, ParseInt and ParseDouble against the
+// boost and std conversions they replaced: results must be bit-identical, and input one rejects the other must reject
+// the same way; then the time per call of both on valid input
+//   taq-test-parse [inputs per function, default 200000]
+
+using namespace std;
+using namespace Taq;
+
+namespace {
+
+Time BoostTaqTime(const string & timestamp) {
+  try {
+    return  boost::posix_time::hours(                 stoi(timestamp.substr(0,2)) )
+          + boost::posix_time::minutes(               stoi(timestamp.substr(2,2)) )
+          + boost::posix_time::seconds(               stoi(timestamp.substr(4,2)) )
+          + boost::posix_time::nanoseconds(           stoi(timestamp.substr(6,9)) );
+  } catch (...) {
+    throw Exception(ErrorType::InvalidTimestamp);
+  }
+}
+
+Date BoostTaqDate(const string & yyyymmdd) {
+  try {
+    return  boost::gregorian::from_undelimited_string(yyyymmdd);
+  } catch (...) {
+    throw Exception(ErrorType::InvalidDate);
+  }
+}
+
+Time BoostTime(const string& time) {
+  try {
+    return  boost::posix_time::duration_from_string(time);
+  } catch (...) {
+    throw Exception(ErrorType::InvalidTimestamp);
+  }
+}
+
+Date BoostDate(const string& yyyymmdd) {
+  try {
+    return boost::gregorian::from_string(yyyymmdd);
+  } catch (...) {
+    throw Exception(ErrorType::InvalidDate);
+  }
+}
+
+bool BoostSplitTimestamp(const string & timestamp, string & date, string & time) {
+  vector<string> values;
+  boost::split(values, timestamp, boost::is_any_of("T "));
+  if (values.size() != 2) {
+    return false;
+  }
+  date = values[0];
+  time = values[1];
+  return true;
+}
+
+// a result, or the exception thrown instead, as text that compares equal only for bit-identical values
+template <typename Value>
+string Outcome(const function<Value()> & convert, const function<string(const Value&)> & print) {
+  try {
+    return print(convert());
+  }
+  catch (const Exception & ex) {
+    return string("Exception:") + to_string((int)ex.errtype());
+  }
+  catch (const exception & ex) {
+    return string("exception:") + typeid(ex).name();
+  }
+}
+
+string PrintTime(const Time & time) {
+  return time.is_special() ? to_simple_string(time) : to_string(time.total_nanoseconds());
+}
+
+string PrintDate(const Date & date) {
+  return date.is_special() ? to_simple_string(date) : to_string(date.day_number());
+}
+
+string PrintDouble(const double & value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return to_string(bits);
+}
+
+string PrintInt(const int & value) {
+  return to_string(value);
+}
+
+class Inputs {
+public:
+  Inputs() : rng_(20200801) {}
+  int Between(int lo, int hi) {
+    return uniform_int_distribution<int>(lo, hi)(rng_);
+  }
+  string Digits(int width, int hi, int lo = 0) {
+    string text = to_string(Between(lo, hi));
+    return string(width > (int)text.size() ? width - text.size() : 0, '0') + text;
+  }
+  string TaqTime() {
+    return Digits(2, 23) + Digits(2, 59) + Digits(2, 59) + Digits(9, 999999999);
+  }
+  // month 0 or 13 and day 29 to 31 put some dates off the calendar
+  string TaqDate() {
+    return Digits(4, 2099, 1900) + Digits(2, 13) + Digits(2, 31);
+  }
+  string IsoTime() {
+    string text = Digits(2, 23) + ':' + Digits(2, 59) + ':' + Digits(2, 59);
+    const int fraction = Between(-1, 9);
+    if (fraction >= 0) {
+      text += '.' + Digits(fraction, 999999999).substr(0, fraction);
+    }
+    return text;
+  }
+  string IsoDate(bool valid = false) {
+    const string year = Digits(4, 2099, 1900);
+    return valid ? year + '-' + Digits(2, 12, 1) + '-' + Digits(2, 28, 1) : year + '-' + Digits(2, 13) + '-' + Digits(2, 31);
+  }
+  string Timestamp() {
+    return IsoDate() + (Between(0, 1) ? 'T' : ' ') + IsoTime();
+  }
+  string Price() {
+    const int decimals = Between(0, 6);
+    string text = to_string(Between(0, 99999));
+    if (decimals) {
+      text += '.' + Digits(decimals, 999999).substr(0, decimals);
+    }
+    return text;
+  }
+  string Size() {
+    return to_string(Between(0, Between(0, 1) ? 1000 : 2147483647));
+  }
+  // about one input in three is damaged: a character replaced, inserted or removed, or the text cut short
+  string Damage(string text) {
+    static const string alphabet = "0123456789:.-+T Z,e";
+    const int what = Between(0, 8);
+    const size_t pos = text.empty() ? 0 : Between(0, (int)text.size() - 1);
+    const char c = alphabet[Between(0, (int)alphabet.size() - 1)];
+    if (what == 0 && text.size()) {
+      text[pos] = c;
+    } else if (what == 1) {
+      text.insert(text.begin() + pos, c);
+    } else if (what == 2 && text.size()) {
+      text.erase(pos, 1);
+    } else if (what == 3) {
+      text.resize(pos);
+    }
+    return text;
+  }
+private:
+  mt19937 rng_;
+};
+
+struct Check {
+  const char* name;
+  function<string(Inputs&)> input;
+  function<string(const string&)> fast;
+  function<string(const string&)> reference;
+};
+
+}
+
+int main(int argc, char** argv) {
+  const int count = argc > 1 ? atoi(argv[1]) : 200000;
+  const vector<Check> checks = {
+    { "MkTaqTime", [](Inputs& in) { return in.Damage(in.TaqTime()); },
+      [](const string& s) { return Outcome<Time>([&] { return MkTaqTime(s); }, PrintTime); },
+      [](const string& s) { return Outcome<Time>([&] { return BoostTaqTime(s); }, PrintTime); } },
+    { "MkTaqDate", [](Inputs& in) { return in.Damage(in.TaqDate()); },
+      [](const string& s) { return Outcome<Date>([&] { return MkTaqDate(s); }, PrintDate); },
+      [](const string& s) { return Outcome<Date>([&] { return BoostTaqDate(s); }, PrintDate); } },
+    { "MkTime", [](Inputs& in) { return in.Damage(in.IsoTime()); },
+      [](const string& s) { return Outcome<Time>([&] { return MkTime(s); }, PrintTime); },
+      [](const string& s) { return Outcome<Time>([&] { return BoostTime(s); }, PrintTime); } },
+    { "MkDate", [](Inputs& in) { return in.Damage(in.IsoDate()); },
+      [](const string& s) { return Outcome<Date>([&] { return MkDate(s); }, PrintDate); },
+      [](const string& s) { return Outcome<Date>([&] { return BoostDate(s); }, PrintDate); } },
+    { "SplitTimestamp", [](Inputs& in) { return in.Damage(in.Timestamp()); },
+      [](const string& s) {
+        string_view date, time;
+        return SplitTimestamp(s, date, time) ? string(date) + '|' + string(time) : string("none");
+      },
+      [](const string& s) {
+        string date, time;
+        return BoostSplitTimestamp(s, date, time) ? date + '|' + time : string("none");
+      } },
+    { "ParseInt", [](Inputs& in) { return in.Damage(in.Size()); },
+      [](const string& s) { return Outcome<int>([&] { return ParseInt(s); }, PrintInt); },
+      [](const string& s) { return Outcome<int>([&] { return stoi(s); }, PrintInt); } },
+    { "ParseDouble", [](Inputs& in) { return in.Damage(in.Price()); },
+      [](const string& s) { return Outcome<double>([&] { return ParseDouble(s); }, PrintDouble); },
+      [](const string& s) { return Outcome<double>([&] { return stod(s); }, PrintDouble); } },
+  };
+  int failures = 0;
+  for (const Check & check : checks) {
+    Inputs inputs;
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+      const string text = check.input(inputs);
+      const string fast = check.fast(text);
+      const string reference = check.reference(text);
+      if (fast != reference && ++mismatches <= 10) {
+        cout << check.name << "(\"" << text << "\") : " << fast << " expected " << reference << endl;
+      }
+    }
+    cout << check.name << " : " << count << " inputs, " << mismatches << " mismatches" << endl;
+    failures += mismatches;
+  }
+
+  // valid input only, so both sides take their normal path
+  Inputs inputs;
+  vector<string> taq_times, iso_times, iso_dates, prices;
+  for (int i = 0; i < 100000; i++) {
+    taq_times.push_back(inputs.TaqTime());
+    iso_times.push_back(inputs.IsoTime());
+    iso_dates.push_back(inputs.IsoDate(true));
+    prices.push_back(inputs.Price());
+  }
+  auto time_per_call = [](const vector<string> & texts, const function<int64_t(const string&)> & convert) {
+    int64_t sum = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int round = 0; round < 10; round++) {
+      for (const string & text : texts) {
+        sum += convert(text);
+      }
+    }
+    const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return make_pair(elapsed.count() / (10 * texts.size()), sum);
+  };
+  auto report = [&](const char* name, const vector<string> & texts, const function<int64_t(const string&)> & fast,
+                    const function<int64_t(const string&)> & reference) {
+    const auto fast_time = time_per_call(texts, fast);
+    const auto reference_time = time_per_call(texts, reference);
+    cout << name << " : " << fast_time.first << " ns per call, boost/std " << reference_time.first << " ns" << endl;
+  };
+  report("MkTaqTime", taq_times, [](const string& s) { return NanosFromTime(MkTaqTime(s)); },
+         [](const string& s) { return NanosFromTime(BoostTaqTime(s)); });
+  report("MkTime", iso_times, [](const string& s) { return NanosFromTime(MkTime(s)); },
+         [](const string& s) { return NanosFromTime(BoostTime(s)); });
+  report("MkDate", iso_dates, [](const string& s) { return (int64_t)MkDate(s).day_number(); },
+         [](const string& s) { return (int64_t)BoostDate(s).day_number(); });
+  report("ParseDouble", prices, [](const string& s) { return (int64_t)(ParseDouble(s) * 100); },
+         [](const string& s) { return (int64_t)(stod(s) * 100); });
+  return failures ? 1 : 0;
+}
@@ -55,6 +55,7 @@ int main(int argc, char **argv) {
     ("log_dir,l", po::value<string>(&args.log_dir)->default_value("."), "log directory")
     ("-tcp,t", po::value<uint16_t>(&args.in_port)->default_value(3090), "TCP port")
     ("-cpu,c", po::value<string>(&args.in_cpu_list), "CPU core list to pin threads")
+    ("block-cache-mb", po::value<size_t>(&args.block_cache_mb)->default_value(1024), "memory for decompressed blocks of compressed data files, in MB")
     ("-verbose,v", po::value<bool>(&verbose)->default_value(false), "vebose mode with output written to stdout")
     ;
   po::variables_map vm;
@@ -78,7 +79,7 @@ int main(int argc, char **argv) {
   #endif
   try {
     LogInitialize(args);
-    InitializeData(args.in_data_dir);
+    InitializeData(args.in_data_dir, args.block_cache_mb * 1024 * 1024);
     InitializeFunctionDefinitions();
     NetInitialize(args);
     CreateThreads(cpu_cores);
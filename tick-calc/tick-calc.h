@@ -18,6 +18,7 @@ struct AppAruments {
   string in_cpu_list;
   uint16_t in_port;
   string log_dir;
+  size_t block_cache_mb;
 };
 
 void NetInitialize(AppAruments&);
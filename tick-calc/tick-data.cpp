@@ -1,3 +1,4 @@
+#include <atomic>
 
 #include "tick-calc.h"
 #include "tick-data.h"
@@ -10,15 +11,27 @@ using namespace Taq;
 
 namespace  tick_calc {
 
+unique_ptr<BlockCache> block_cache;   // outlives the recordsets, which drop their blocks from it
 unique_ptr<SecMasterManager> secmaster_manager;
 unique_ptr<RecordsetManager<Nbbo>> nbbo_data_manager;
 unique_ptr<RecordsetManager<NbboPrice>> nbbo_po_data_manager;
 unique_ptr<RecordsetManager<Trade>> trade_data_manager;
+unique_ptr<RecordsetManager<ExchangeBbo>> bbo_data_manager;
+unique_ptr<RecordsetManager<TradeNbbo>> trade_nbbo_data_manager;
+unique_ptr<RecordsetManager<Bar>> bar_data_manager;
+unique_ptr<SummaryManager> summary_manager;
+unique_ptr<SnapshotManager> snapshot_manager;
 
-void InitializeData(const string & data_dir) {
+void InitializeData(const string & data_dir, size_t block_cache_size) {
+  block_cache = make_unique<BlockCache>(block_cache_size);
   secmaster_manager = make_unique<SecMasterManager>(data_dir);
   nbbo_data_manager = make_unique<RecordsetManager<Nbbo>>(data_dir);
   nbbo_po_data_manager = make_unique<RecordsetManager<NbboPrice>>(data_dir);
+  bbo_data_manager = make_unique<RecordsetManager<ExchangeBbo>>(data_dir);
+  trade_nbbo_data_manager = make_unique<RecordsetManager<TradeNbbo>>(data_dir);
+  bar_data_manager = make_unique<RecordsetManager<Bar>>(data_dir);
+  summary_manager = make_unique<SummaryManager>(data_dir);
+  snapshot_manager = make_unique<SnapshotManager>(data_dir);
 }
 void CleanupData() {
   nbbo_data_manager.release();
@@ -36,6 +49,73 @@ tick_calc::RecordsetManager<NbboPrice>& NbboPoRecordsetManager() {
   return *nbbo_po_data_manager;
 }
 
+tick_calc::RecordsetManager<ExchangeBbo>& BboRecordsetManager() {
+  return *bbo_data_manager;
+}
+
+tick_calc::RecordsetManager<TradeNbbo>& TradeNbboRecordsetManager() {
+  return *trade_nbbo_data_manager;
+}
+
+tick_calc::RecordsetManager<Bar>& BarRecordsetManager() {
+  return *bar_data_manager;
+}
+
+tick_calc::SummaryManager& DailySummaryManager() {
+  return *summary_manager;
+}
+
+tick_calc::SnapshotManager& NbboSnapshotManager() {
+  return *snapshot_manager;
+}
+
+BlockCache& DecodedBlockCache() {
+  return *block_cache;
+}
+
+uint64_t NextFileId() {
+  static atomic<uint64_t> file_id(0);
+  return ++file_id;
+}
+
+// blocks are decoded outside the lock, so concurrent misses on one block may both decode it; the first one is kept
+BlockCache::Block BlockCache::Get(uint64_t file_id, size_t block_idx, const function<void(vector<char>&)>& decode) {
+  const Key key(file_id, block_idx);
+  {
+    lock_guard<mutex> lock(mtx_);
+    auto found = blocks_.find(key);
+    if (found != blocks_.end()) {
+      lru_.splice(lru_.begin(), lru_, found->second);
+      return found->second->second;
+    }
+  }
+  auto block = make_shared<vector<char>>();
+  decode(*block);
+  lock_guard<mutex> lock(mtx_);
+  auto inserted = blocks_.insert(make_pair(key, lru_.end()));
+  if (false == inserted.second) {
+    return inserted.first->second->second;
+  }
+  lru_.emplace_front(key, block);
+  inserted.first->second = lru_.begin();
+  size_ += block->size();
+  while (size_ > capacity_ && lru_.size() > 1) {
+    size_ -= lru_.back().second->size();
+    blocks_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return block;
+}
+
+void BlockCache::Drop(uint64_t file_id) {
+  lock_guard<mutex> lock(mtx_);
+  for (auto it = blocks_.lower_bound(Key(file_id, 0)); it != blocks_.end() && it->first.first == file_id; ) {
+    size_ -= it->second->second->size();
+    lru_.erase(it->second);
+    it = blocks_.erase(it);
+  }
+}
+
 void SecMasterManager::trim() {
   if (sec_master_.size() >= max_size_) {
     // attempt to trim stale struct(s)
@@ -71,16 +151,21 @@ const SecMaster&  SecMasterManager::Load(Date date) {
       throw domain_error("Input file not found : " + file_path.string());
     }
     const size_t file_size = (size_t)fs::file_size(file_path);
-    if (file_size < sizeof(FileHeader)) {
+    if (file_size < sizeof(FileHeaderV1)) {
       throw domain_error("Input file size too small to accomodate header : " + file_path.string());
     }
     mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
     mm::mapped_region mmreg(mmfile, mm::read_only);
-    const FileHeader& fh = *(FileHeader*)mmreg.get_address();
-    if ((sizeof(fh) + fh.symb_cnt * sizeof(Security)) != file_size) {
+    FileHeader fh(FILE_VERSION_PACKED);
+    if (false == ReadFileHeader((const char*)mmreg.get_address(), file_size, fh)) {
+      throw domain_error("Input file size too small to accomodate header : " + file_path.string());
+    }
+    const size_t header_size = FileHeaderSize(fh.version);
+    if (fh.symb_cnt < 0 || header_size + (size_t)fh.symb_cnt * sizeof(Security) != file_size) {
       throw domain_error("Input file corruption : " + file_path.string());
     }
-    auto inserted = sec_master_.insert(make_pair(date, make_unique<SecMaster>(date, fh.symb_cnt, mmfile, mmreg)));
+    auto inserted = sec_master_.insert(make_pair(date, make_unique<SecMaster>(date, header_size, fh.symb_cnt, mmfile,
+                                                                              mmreg)));
     retval = inserted.first->second.get();
   }
   if (retval) {
@@ -100,4 +185,132 @@ void SecMasterManager::Release(const SecMaster &obj) {
   //sec_master_.erase(obj.date_);
 }
 
+void SummaryManager::trim() {
+  if (summaries_.size() >= max_size_) {
+    vector<pair<Date, const DaySummary*>> tmp;
+    for (const auto& x : summaries_) {
+      tmp.push_back(make_pair(x.first, x.second.get()));
+    }
+    sort(tmp.begin(), tmp.end(), [](pair<Date, const DaySummary*>& l, pair<Date, const DaySummary*>& r) {
+      return (l.second->use_cnt_ < r.second->use_cnt_)
+        || (l.second->use_cnt_ == r.second->use_cnt_ && l.second->last_used_ < r.second->last_used_);
+      });
+    size_t to_release = 1 + summaries_.size() - max_size_;
+    for (size_t i = 0; i < to_release; i++) {
+      if (tmp[i].second->use_cnt_) {
+        break;
+      }
+      summaries_.erase(tmp[i].first);
+    }
+  }
+}
+
+const DaySummary& SummaryManager::Load(Date date) {
+  DaySummary* retval = nullptr;
+  lock_guard<mutex> lock(mtx_);
+  SummaryTable::iterator found = summaries_.find(date);
+  if (found != summaries_.end()) {
+    retval = found->second.get();
+  }
+  else {
+    trim();
+    fs::path file_path = MkDataFilePath(data_dir_, RecordType::DailySummary, date);
+    if (false == (fs::exists(file_path) && fs::is_regular_file(file_path))) {
+      throw domain_error("Input file not found : " + file_path.string());
+    }
+    const size_t file_size = (size_t)fs::file_size(file_path);
+    if (file_size < sizeof(FileHeaderV1) + sizeof(SymbolDirectoryFooter)) {
+      throw domain_error("Input file size too small to accomodate header : " + file_path.string());
+    }
+    mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
+    mm::mapped_region mmreg(mmfile, mm::read_only);
+    const char* base = (const char*)mmreg.get_address();
+    FileHeader fh(FILE_VERSION_PACKED);
+    SymbolDirectoryFooter footer;
+    memcpy(&footer, base + file_size - sizeof(footer), sizeof(footer));
+    if (false == ReadFileHeader(base, file_size, fh) || fh.type != RecordType::DailySummary || fh.symb_cnt < 0
+        || 0 == footer.slot_cnt || (footer.slot_cnt & (footer.slot_cnt - 1)) || footer.slot_cnt > file_size
+        || SummaryFileSize(fh.version, (size_t)fh.symb_cnt, footer.slot_cnt) != file_size) {
+      throw domain_error("Input file corruption : " + file_path.string());
+    }
+    auto inserted = summaries_.insert(make_pair(date, make_unique<DaySummary>(date, FileHeaderSize(fh.version),
+                                                                             (size_t)fh.symb_cnt, footer.slot_cnt,
+                                                                             mmfile, mmreg)));
+    retval = inserted.first->second.get();
+  }
+  retval->use_cnt_ ++;
+  retval->last_used_ = pt::microsec_clock::local_time();
+  return *retval;
+}
+
+void SummaryManager::Release(const DaySummary &obj) {
+  lock_guard<mutex> lock(mtx_);
+  obj.use_cnt_ --;
+  assert(obj.use_cnt_ >= 0);
+}
+
+void SnapshotManager::trim() {
+  if (snapshots_.size() >= max_size_) {
+    vector<pair<Date, const DaySnapshot*>> tmp;
+    for (const auto& x : snapshots_) {
+      tmp.push_back(make_pair(x.first, x.second.get()));
+    }
+    sort(tmp.begin(), tmp.end(), [](pair<Date, const DaySnapshot*>& l, pair<Date, const DaySnapshot*>& r) {
+      return (l.second->use_cnt_ < r.second->use_cnt_)
+        || (l.second->use_cnt_ == r.second->use_cnt_ && l.second->last_used_ < r.second->last_used_);
+      });
+    size_t to_release = 1 + snapshots_.size() - max_size_;
+    for (size_t i = 0; i < to_release; i++) {
+      if (tmp[i].second->use_cnt_) {
+        break;
+      }
+      snapshots_.erase(tmp[i].first);
+    }
+  }
+}
+
+const DaySnapshot& SnapshotManager::Load(Date date) {
+  DaySnapshot* retval = nullptr;
+  lock_guard<mutex> lock(mtx_);
+  SnapshotTable::iterator found = snapshots_.find(date);
+  if (found != snapshots_.end()) {
+    retval = found->second.get();
+  }
+  else {
+    trim();
+    fs::path file_path = MkDataFilePath(data_dir_, RecordType::NbboSnapshot, date);
+    if (false == (fs::exists(file_path) && fs::is_regular_file(file_path))) {
+      throw domain_error("Input file not found : " + file_path.string());
+    }
+    const size_t file_size = (size_t)fs::file_size(file_path);
+    if (file_size < sizeof(FileHeaderV1) + sizeof(SnapshotGrid)) {
+      throw domain_error("Input file size too small to accomodate header : " + file_path.string());
+    }
+    mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
+    mm::mapped_region mmreg(mmfile, mm::read_only);
+    const char* base = (const char*)mmreg.get_address();
+    FileHeader fh(FILE_VERSION_PACKED);
+    SnapshotGrid grid;
+    memcpy(&grid, base + file_size - sizeof(grid), sizeof(grid));
+    if (false == ReadFileHeader(base, file_size, fh) || fh.type != RecordType::NbboSnapshot || fh.symb_cnt < 0
+        || grid.interval <= 0 || grid.time_cnt > file_size
+        || SnapshotFileSize(fh.version, (size_t)fh.symb_cnt, grid.time_cnt) != file_size) {
+      throw domain_error("Input file corruption : " + file_path.string());
+    }
+    auto inserted = snapshots_.insert(make_pair(date, make_unique<DaySnapshot>(date, FileHeaderSize(fh.version),
+                                                                               (size_t)fh.symb_cnt, grid, mmfile,
+                                                                               mmreg)));
+    retval = inserted.first->second.get();
+  }
+  retval->use_cnt_ ++;
+  retval->last_used_ = pt::microsec_clock::local_time();
+  return *retval;
+}
+
+void SnapshotManager::Release(const DaySnapshot &obj) {
+  lock_guard<mutex> lock(mtx_);
+  obj.use_cnt_ --;
+  assert(obj.use_cnt_ >= 0);
+}
+
 }
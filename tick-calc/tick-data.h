@@ -7,12 +7,18 @@
 #include <iterator>
 #include <sstream>
 #include <map>
+#include <list>
+#include <mutex>
+#include <memory>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/filesystem.hpp>
 
 #include "taq-proc.h"
+#include "taq-block.h"
 #include "tick-secmaster.h"
+#include "tick-summary.h"
+#include "tick-snapshot.h"
 
 using namespace std;
 using namespace Taq;
@@ -24,52 +30,279 @@ namespace pt = boost::posix_time;
 namespace tick_calc {
 
 
+// decompressed blocks of compressed files, shared by all recordsets and bounded in size; the least recently used blocks are
+// evicted first, and an evicted block stays valid for as long as an iterator holds it
+class BlockCache {
+public:
+  typedef shared_ptr<const vector<char>> Block;
+  explicit BlockCache(size_t capacity) : capacity_(capacity), size_(0) {}
+  // the block of the file, decoded by decode into the buffer passed to it unless cached
+  Block Get(uint64_t file_id, size_t block_idx, const function<void(vector<char>&)>& decode);
+  void Drop(uint64_t file_id);
+private:
+  typedef pair<uint64_t, size_t> Key;
+  typedef list<pair<Key, Block>> LruList;
+  mutex mtx_;
+  const size_t capacity_;
+  size_t size_;
+  LruList lru_;                   // most recently used first
+  map<Key, LruList::iterator> blocks_;
+};
+
+BlockCache& DecodedBlockCache();
+uint64_t NextFileId();            // tells apart the files loaded over time in the block cache
+
+
+// records of one symbol, sorted by time, as one column per field: a v1 segment holds packed records, so each column
+// is strided by the record size; later versions hold each column contiguously, so searches read the dense time column
+// only and a record is gathered from the columns when dereferenced; times are nanoseconds since midnight;
+// a compressed segment is a run of blocks, each holding v3 columns once decompressed: iterators keep the block of
+// their record, which they take from the block cache when they move onto another block; the time index of a v5 or later
+// segment narrows each search to one bucket before the binary search; a price-only view of a v8 nbbo segment reads the
+// records of the segment at the positions of its price changes
 template <typename T>
 class SortedConstVector {
 public:
-  SortedConstVector() = default;
-  SortedConstVector(const T* base, size_t record_count) : base_(base), record_count_(record_count) {}
-  const T* begin() const { return base_; }
-  const T* end()   const { return base_ + record_count_; }
-  size_t   size()  const { return record_count_; }
-  size_t distance(const T* left, const T* right) const { return right - left; }
-
-  const T* upper_bound(const T* left, const T* right, Time time) const {
-    ptrdiff_t lo = 0, hi = right - left;
-    while (lo < hi) {
-      ptrdiff_t mid = lo + (hi - lo) / 2;
-      if (time >= left[mid].time) {
-        lo = mid + 1;
+  static constexpr size_t FIELD_CNT = std::size(RecordLayout<T>::fields);
+
+  // records first to first + count - 1 of the segment
+  struct BlockRef {
+    BlockCache::Block owner;      // none for uncompressed segments
+    const char* data;
+    size_t first;
+    size_t count;
+    bool Contains(size_t row) const { return data && row >= first && row - first < count; }
+  };
+
+  class const_iterator {
+  public:
+    struct Pointer {
+      const T record;
+      const T* operator->() const { return &record; }
+    };
+    const_iterator() : records_(nullptr), idx_(0), block_() {}
+    const_iterator(const SortedConstVector* records, size_t idx, BlockRef block = BlockRef())
+      : records_(records), idx_(idx), block_(move(block)) {}
+    T operator*() const { return records_->record(Block(), idx_); }
+    Pointer operator->() const { return Pointer{records_->record(Block(), idx_)}; }
+    int64_t time() const { return records_->time(Block(), idx_); }
+    size_t index() const { return idx_; }
+    const_iterator& operator++() { ++idx_; return *this; }
+    const_iterator& operator--() { --idx_; return *this; }
+    const_iterator operator+(ptrdiff_t n) const { return const_iterator(records_, idx_ + n, block_); }
+    const_iterator operator-(ptrdiff_t n) const { return const_iterator(records_, idx_ - n, block_); }
+    ptrdiff_t operator-(const const_iterator& other) const { return (ptrdiff_t)idx_ - (ptrdiff_t)other.idx_; }
+    bool operator==(const const_iterator& other) const { return idx_ == other.idx_; }
+    bool operator!=(const const_iterator& other) const { return idx_ != other.idx_; }
+    bool operator<(const const_iterator& other) const { return idx_ < other.idx_; }
+    bool operator>(const const_iterator& other) const { return idx_ > other.idx_; }
+  private:
+    const BlockRef& Block() const {
+      if (false == block_.Contains(records_->row(idx_))) {
+        block_ = records_->block(idx_);
+      }
+      return block_;
+    }
+    const SortedConstVector* records_;
+    size_t idx_;
+    mutable BlockRef block_;
+  };
+
+  SortedConstVector() : data_(nullptr), column_offsets_(), field_offsets_(), strides_(), version_(0), fixed_point_(false),
+                        record_count_(0), column_length_(0), blocks_(nullptr), block_records_(0), file_id_(0),
+                        first_block_(0), time_index_(nullptr), buckets_(nullptr), positions_(nullptr) {}
+  SortedConstVector(const char* segment, size_t record_count, int version, const TimeIndexEntry* time_index = nullptr,
+                    const uint64_t* buckets = nullptr)
+    : data_(segment), version_(version), fixed_point_(version >= FILE_VERSION_FIXED_POINT), record_count_(record_count),
+      column_length_(record_count), blocks_(nullptr), block_records_(record_count), file_id_(0), first_block_(0),
+      time_index_(time_index), buckets_(buckets), positions_(nullptr) {
+    size_t column_offset = 0;
+    for (size_t i = 0; i < FIELD_CNT; i++) {
+      const FieldLayout& field = RecordLayout<T>::fields[i];
+      if (version == FILE_VERSION_PACKED) {
+        column_offsets_[i] = 0;
+        field_offsets_[i] = field.offset;
+        strides_[i] = sizeof(T);
       } else {
-        hi = mid;
+        column_offsets_[i] = column_offset;
+        field_offsets_[i] = 0;
+        strides_[i] = field.size;
+        column_offset += field.size;
       }
     }
-    return left + lo;
   }
+  // compressed: block k of the segment of segment_count records is blocks[k], which starts at data + blocks[k].offset
+  // and is cached as block first_block + k of the file; with positions, a price-only view of it
+  SortedConstVector(const char* data, size_t segment_count, const BlockIndexEntry* blocks, size_t block_records,
+                    uint64_t file_id, size_t first_block, const TimeIndexEntry* time_index, const uint64_t* buckets,
+                    const uint32_t* positions = nullptr, size_t position_cnt = 0)
+    : SortedConstVector(data, segment_count, FILE_VERSION_FIXED_POINT, time_index, buckets) {
+    blocks_ = blocks;
+    block_records_ = block_records;
+    file_id_ = file_id;
+    first_block_ = first_block;
+    if (positions) {
+      record_count_ = position_cnt;
+      positions_ = positions;
+    }
+  }
+  // v8 price-only view: record i is record positions[i] of a segment of segment_count records whose leading columns
+  // are those of T, i.e. the time, bid and offer columns of an nbbo segment
+  SortedConstVector(const char* segment, size_t segment_count, int version, const uint32_t* positions,
+                    size_t position_cnt, const TimeIndexEntry* time_index, const uint64_t* buckets)
+    : SortedConstVector(segment, segment_count, version, time_index, buckets) {
+    record_count_ = position_cnt;
+    positions_ = positions;
+  }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end()   const { return const_iterator(this, record_count_); }
+  size_t   size()  const { return record_count_; }
+  size_t distance(const_iterator left, const_iterator right) const { return right - left; }
 
-  const T* lower_bound(const T* left, const T* right, Time time) const {
-    ptrdiff_t lo = 0, hi = right - left;
-    while (lo < hi) {
-      auto mid = (lo + (hi - lo) / 2);
-      if (time <= left[mid].time) {
-        hi = mid;
+  // of record idx in the segment
+  size_t row(size_t idx) const {
+    return positions_ ? positions_[idx] : idx;
+  }
+
+  // the blocks of a price-only view hold the columns of all the nbbo fields
+  BlockRef block(size_t idx) const {
+    if (nullptr == blocks_) {
+      return BlockRef{nullptr, data_, 0, column_length_};
+    }
+    const size_t block_idx = row(idx) / block_records_;
+    const BlockIndexEntry& entry = blocks_[block_idx];
+    BlockCache::Block owner = DecodedBlockCache().Get(file_id_, first_block_ + block_idx, [&](vector<char>& columns) {
+      if (positions_) {
+        columns.resize(entry.record_cnt * RecordWidth<Nbbo>(FILE_VERSION_FIXED_POINT));
+        DecodeBlock(RecordLayout<Nbbo>::fields, std::size(RecordLayout<Nbbo>::fields), entry.record_cnt,
+                    data_ + entry.offset, entry.size, columns.data(), columns.size());
       } else {
-        lo = mid + 1;
+        columns.resize(entry.record_cnt * RecordWidth<T>(FILE_VERSION_FIXED_POINT));
+        DecodeBlock(RecordLayout<T>::fields, FIELD_CNT, entry.record_cnt, data_ + entry.offset, entry.size,
+                    columns.data(), columns.size());
       }
+    });
+    const char* columns = owner->data();
+    return BlockRef{move(owner), columns, block_idx * block_records_, entry.record_cnt};
+  }
+
+  const char* field(const BlockRef& block, size_t i, size_t idx) const {
+    return block.data + block.count * column_offsets_[i] + field_offsets_[i] + (row(idx) - block.first) * strides_[i];
+  }
+
+  // field i of records idx to the end of their block, which v3 and later segments hold as a contiguous column, so a
+  // reduction over a field reads it in place; nullptr for segments of earlier versions and price-only views
+  const char* column(const BlockRef& block, size_t i, size_t idx) const {
+    return fixed_point_ && nullptr == positions_ ? field(block, i, idx) : nullptr;
+  }
+
+  int64_t time(const BlockRef& block, size_t idx) const {
+    const char* field = this->field(block, 0, idx);
+    if (fixed_point_) {
+      int64_t retval;
+      memcpy(&retval, field, sizeof(retval));
+      return retval;
+    }
+    Time retval;
+    memcpy(&retval, field, sizeof(retval));
+    return NanosFromTime(retval);
+  }
+
+  T record(const BlockRef& block, size_t idx) const {
+    alignas(T) char record[sizeof(T)] = {};
+    for (size_t i = 0; i < FIELD_CNT; i++) {
+      const FieldLayout& field = RecordLayout<T>::fields[i];
+      ReadField(field, version_, this->field(block, i, idx), record + field.offset);
     }
-    return left + lo;
+    return *reinterpret_cast<const T*>(record);
   }
-  const T* find_prior(const T* left, const T* right, Time time) const {
+
+  int64_t time(size_t idx) const { return time(block(idx), idx); }
+  T operator[](size_t idx) const { return record(block(idx), idx); }
+
+  const_iterator upper_bound(const_iterator left, const_iterator right, int64_t time) const {
+    return search(left, right, time, [time](int64_t record_time) { return record_time <= time; });
+  }
+
+  const_iterator lower_bound(const_iterator left, const_iterator right, int64_t time) const {
+    return search(left, right, time, [time](int64_t record_time) { return record_time < time; });
+  }
+
+  const_iterator find_prior(const_iterator left, const_iterator right, int64_t time) const {
     auto retval = lower_bound(left, right, time);
-    if ((retval == end() || retval->time > time) && retval > begin()) {
+    if ((retval == end() || retval.time() > time) && retval > begin()) {
       -- retval;
     }
     return retval;
   }
 
 private:
-  const T* base_;
+  // first record of [left, right) not before the time sought; the first times in the block index narrow the search
+  // in a compressed segment down to one block, so a search decompresses a single block
+  template <typename Before>
+  const_iterator search(const_iterator left, const_iterator right, int64_t time, Before before) const {
+    size_t lo = left.index(), hi = right.index();
+    if (time_index_ && lo < hi) {
+      uint64_t from, to;
+      TimeIndexRange(*time_index_, buckets_, column_length_, time, from, to);
+      if (positions_) {     // rows of the segment to records of the view
+        from = std::lower_bound(positions_, positions_ + record_count_, from) - positions_;
+        to = std::lower_bound(positions_, positions_ + record_count_, to) - positions_;
+      }
+      lo = (size_t)std::clamp<uint64_t>(from, lo, hi);
+      hi = (size_t)std::clamp<uint64_t>(to, lo, hi);
+    }
+    if (blocks_ && lo < hi) {
+      size_t row_lo = row(lo), row_hi = row(hi - 1) + 1;
+      size_t first = row_lo / block_records_ + 1, last = (row_hi - 1) / block_records_ + 1;   // blocks starting in (lo, hi)
+      const size_t first_candidate = first;
+      while (first < last) {
+        const size_t mid = first + (last - first) / 2;
+        if (before(blocks_[mid].first_time)) {
+          first = mid + 1;
+        } else {
+          last = mid;
+        }
+      }
+      if (first > first_candidate) {
+        row_lo = (first - 1) * block_records_;
+      }
+      row_hi = min(row_hi, first * block_records_);
+      if (positions_) {     // rows of the segment to records of the view
+        lo = std::lower_bound(positions_ + lo, positions_ + hi, row_lo) - positions_;
+        hi = std::lower_bound(positions_ + lo, positions_ + hi, row_hi) - positions_;
+      } else {
+        lo = row_lo;
+        hi = row_hi;
+      }
+    }
+    BlockRef block = lo < hi ? this->block(lo) : BlockRef();
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (before(this->time(block, mid))) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return const_iterator(this, lo, move(block));
+  }
+
+  const char* data_;
+  size_t column_offsets_[FIELD_CNT];    // a column starts at the block's record count times this
+  size_t field_offsets_[FIELD_CNT];
+  size_t strides_[FIELD_CNT];
+  int version_;
+  bool fixed_point_;
   size_t record_count_;
+  size_t column_length_;                // of an uncompressed segment, which a view holds fewer records of
+  const BlockIndexEntry* blocks_;       // compressed segments only
+  size_t block_records_;
+  uint64_t file_id_;
+  size_t first_block_;
+  const TimeIndexEntry* time_index_;    // v5 and later
+  const uint64_t* buckets_;
+  const uint32_t* positions_;           // v8 price-only views
 };
 
 
@@ -79,10 +312,23 @@ class SymbolRecordset {
 public:
   SymbolRecordset(SymbolRecordset&&) = delete;
   SymbolRecordset(const SymbolRecordset&) = delete;
-  SymbolRecordset(mm::mapped_region& mmreg) : mmreg_(move(mmreg)) {
-    const T* data = (T*)mmreg_.get_address();
-    const size_t record_count = mmreg_.get_size() / sizeof(T);
-    records = move(SortedConstVector<T>(data, record_count));
+  SymbolRecordset(mm::mapped_region& mmreg, size_t record_count, int version, const TimeIndexEntry* time_index = nullptr,
+                  const uint64_t* buckets = nullptr) : mmreg_(move(mmreg)) {
+    records = SortedConstVector<T>((const char*)mmreg_.get_address(), record_count, version, time_index, buckets);
+  }
+  // compressed: mmreg holds the blocks of the symbol's segment_count records, the first of which is block first_block
+  // of the file; with positions, a price-only view of an nbbo segment
+  SymbolRecordset(mm::mapped_region& mmreg, size_t segment_count, const BlockIndexEntry* blocks, size_t block_records,
+                  uint64_t file_id, size_t first_block, const TimeIndexEntry* time_index, const uint64_t* buckets,
+                  const uint32_t* positions, size_t position_cnt) : mmreg_(move(mmreg)) {
+    records = SortedConstVector<T>((const char*)mmreg_.get_address() - blocks->offset, segment_count, blocks,
+                                   block_records, file_id, first_block, time_index, buckets, positions, position_cnt);
+  }
+  // v8 price-only view of the segment_count records of an nbbo segment in mmreg
+  SymbolRecordset(mm::mapped_region& mmreg, size_t segment_count, int version, const uint32_t* positions,
+                  size_t position_cnt, const TimeIndexEntry* time_index, const uint64_t* buckets) : mmreg_(move(mmreg)) {
+    records = SortedConstVector<T>((const char*)mmreg_.get_address(), segment_count, version, positions, position_cnt,
+                                   time_index, buckets);
   }
   SortedConstVector<T> records;
 private:
@@ -94,13 +340,43 @@ private:
 template <typename T>
 class DayRecordset {
 public:
-  DayRecordset(Date date, mm::file_mapping& mmfile, mm::mapped_region& mmreg_header, mm::mapped_region& mmreg_map)
-    : date_(date), mmfile_(move(mmfile)), mmreg_hdr_(move(mmreg_header)), mmreg_map_(move(mmreg_map)), use_cnt_(0) {
-    const size_t symb_cnt = ((FileHeader*)mmreg_hdr_.get_address())->symb_cnt;
-    const SymbolMap* start = (SymbolMap*)mmreg_map_.get_address();
-    for (size_t i = 0; i < symb_cnt; i++) {
-      const SymbolMap* p = start + i;
-      symb_map_.insert(make_pair(p->symb, p));
+  // mmreg_map holds the trailer, i.e. the symbol map and, in v4 and later files, the time index, the symbol directory,
+  // the price index and the block index; files without the directory get a std::map of their symbols instead, and files
+  // before v7 a copy of their symbol map in the v7 layout; a v8 nbbo file opened for NbboPrice records is read through
+  // its price index
+  DayRecordset(Date date, mm::file_mapping& mmfile, const FileHeader& header, mm::mapped_region& mmreg_map,
+               const FileSections& sections)
+    : date_(date), mmfile_(move(mmfile)), mmreg_map_(move(mmreg_map)), sections_(sections), file_id_(NextFileId()),
+      use_cnt_(0) {
+    symb_cnt_ = (size_t)header.symb_cnt;
+    version_ = header.version;
+    price_view_ = header.type != RecordTypeFromString(typeid(T).name());
+    header_size_ = FileHeaderSize(version_);
+    const char* file = (const char*)mmreg_map_.get_address() - sections.symbol_map;   // offsets are from the file start
+    symbol_map_ = (const SymbolMap*)(file + sections.symbol_map);
+    if (false == HasWideCounts(version_)) {
+      wide_map_.resize(symb_cnt_, SymbolMap("", 0, 0));
+      ReadSymbolMapV1(file + sections.symbol_map, symb_cnt_, wide_map_.data());
+      symbol_map_ = wide_map_.data();
+    }
+    if (false == HasSymbolDirectory(version_)) {
+      for (size_t i = 0; i < symb_cnt_; i++) {
+        const SymbolMap* p = symbol_map_ + i;
+        symb_map_.insert(make_pair(p->symb, p));
+      }
+    }
+    blocks_ = (const BlockIndexEntry*)(file + sections.block_index);
+    time_index_ = (const TimeIndexEntry*)(file + sections.time_index);
+    buckets_ = (const uint64_t*)(file + sections.buckets);
+    slots_ = (const uint32_t*)(file + sections.directory);
+    price_index_ = (const PriceIndexEntry*)(file + sections.price_index);
+    positions_ = (const uint32_t*)(file + sections.positions);
+  }
+
+  ~DayRecordset() {
+    by_symb_.clear();
+    if (IsCompressedFileVersion(version_)) {
+      DecodedBlockCache().Drop(file_id_);
     }
   }
 
@@ -108,13 +384,44 @@ public:
     SymbolRecordset<T>* retval = nullptr;
     auto found = by_symb_.find(symbol);
     if (found == by_symb_.end()) {
-      auto symb = symb_map_.find(symbol);
-      if (symb != symb_map_.end()) {
-        const size_t offset = sizeof(FileHeader) + sizeof(T) * (symb->second->start - 1);
-        const size_t length = sizeof(T) * (symb->second->end - symb->second->start + 1);
-        mm::mapped_region mmreg_map(mmfile_, mm::read_only, offset, length);
-        auto inserted = by_symb_.insert(make_pair(symbol, make_unique<SymbolRecordset<T>>(mmreg_map)));
-        retval = inserted.first->second.get();
+      const SymbolMap* symb = LocateSymbol(symbol);
+      if (symb) {
+        const size_t segment_count = symb->end - symb->start + 1;
+        const size_t symbol_idx = symb - symbol_map_;
+        const TimeIndexEntry* time_index = HasTimeIndex(version_) ? time_index_ + symbol_idx : nullptr;
+        const uint32_t* positions = nullptr;
+        size_t position_cnt = 0;
+        if (price_view_) {
+          const PriceIndexEntry& entry = price_index_[symbol_idx];
+          if (entry.first_position + entry.position_cnt > sections_.position_cnt
+              || (entry.position_cnt && positions_[entry.first_position + entry.position_cnt - 1] >= segment_count)) {
+            throw domain_error("Input file corruption : price index of " + symbol);
+          }
+          positions = positions_ + entry.first_position;
+          position_cnt = entry.position_cnt;
+        }
+        unique_ptr<SymbolRecordset<T>> recordset;
+        if (IsCompressedFileVersion(version_)) {
+          const BlockIndexEntry* first = std::lower_bound(blocks_, blocks_ + sections_.block_cnt, symb->start,
+            [](const BlockIndexEntry& block, int64_t record) { return block.first_record < record; });
+          const BlockIndexEntry* last = first + (segment_count - 1) / sections_.block_records;
+          mm::mapped_region mmreg_map(mmfile_, mm::read_only, header_size_ + first->offset,
+                                      last->offset + last->size - first->offset);
+          recordset = make_unique<SymbolRecordset<T>>(mmreg_map, segment_count, first, sections_.block_records, file_id_,
+                                                      first - blocks_, time_index, buckets_, positions, position_cnt);
+        } else if (price_view_) {
+          const size_t width = RecordWidth<Nbbo>(version_);
+          mm::mapped_region mmreg_map(mmfile_, mm::read_only, header_size_ + width * (symb->start - 1),
+                                      width * segment_count);
+          recordset = make_unique<SymbolRecordset<T>>(mmreg_map, segment_count, version_, positions, position_cnt,
+                                                      time_index, buckets_);
+        } else {
+          const size_t width = RecordWidth<T>(version_);
+          mm::mapped_region mmreg_map(mmfile_, mm::read_only, header_size_ + width * (symb->start - 1),
+                                      width * segment_count);
+          recordset = make_unique<SymbolRecordset<T>>(mmreg_map, segment_count, version_, time_index, buckets_);
+        }
+        retval = by_symb_.insert(make_pair(symbol, move(recordset))).first->second.get();
       }
     }
     else {
@@ -133,12 +440,33 @@ public:
   int UseCount() const { return use_cnt_; }
 
 private:
+  const SymbolMap* LocateSymbol(const string& symbol) const {
+    if (HasSymbolDirectory(version_)) {
+      return FindSymbol(symbol_map_, symb_cnt_, slots_, sections_.slot_cnt, symbol);
+    }
+    auto symb = symb_map_.find(symbol);
+    return symb != symb_map_.end() ? symb->second : nullptr;
+  }
+
   const Date date_;
   mm::file_mapping mmfile_;
-  mm::mapped_region mmreg_hdr_;
   mm::mapped_region mmreg_map_;
-  map<string, const SymbolMap*> symb_map_;
+  const SymbolMap* symbol_map_;
+  vector<SymbolMap> wide_map_;              // before v7
+  size_t symb_cnt_;
+  size_t header_size_;
+  map<string, const SymbolMap*> symb_map_;   // before v6
   map<string, unique_ptr<SymbolRecordset<T>>> by_symb_;
+  const FileSections sections_;
+  const uint64_t file_id_;
+  const BlockIndexEntry* blocks_;       // compressed files
+  const TimeIndexEntry* time_index_;    // v5
+  const uint64_t* buckets_;
+  const uint32_t* slots_;               // v6
+  const PriceIndexEntry* price_index_;  // v8
+  const uint32_t* positions_;
+  bool price_view_;
+  int version_;
   pt::ptime last_used_;
   int use_cnt_;
 };
@@ -153,7 +481,7 @@ public:
 
   const SymbolRecordset<T>& LoadSymbolRecordset(Date date, const string symbol) {
     lock_guard<mutex> lock(mtx_);
-    DayRecordset<T>& day_recordset = load(date, symbol[0]);
+    DayRecordset<T>& day_recordset = load(date, partition(date, symbol));
     const SymbolRecordset<T>* symbol_recordset = day_recordset.Find(symbol);
     if (!symbol_recordset) {
       throw(domain_error("Not found date:" + boost::gregorian::to_simple_string(date) + " symbol:" + symbol));
@@ -163,16 +491,44 @@ public:
     return *symbol_recordset;
   }
 
+  // symbol as it was loaded, i.e. the security's symbol rather than the one a request gave
   void UnloadSymbolRecordset(Date date, const string symbol) {
     lock_guard<mutex> lock(mtx_);
-    auto found = daily_records_.find(make_pair(date, symbol[0]));
+    auto found = daily_records_.find(make_pair(date, partition(date, symbol)));
+    if (found == daily_records_.end()) {
+      found = daily_records_.find(make_pair(date, string()));   // whole-day trade file
+    }
     if (found != daily_records_.end()) {
       found->second->Release(symbol);
       found->second->UseCount()--;
     }
   }
 private:
-  void trim() {
+  // per the day's manifest if taq-prep --symbol-group all wrote one, else the first letter of the symbol
+  string partition(Date date, const string& symbol) {
+    auto found = manifests_.find(date);
+    if (found == manifests_.end()) {
+      const RecordType type = RecordTypeFromString(typeid(T).name());
+      unique_ptr<vector<PartitionEntry>> entries = make_unique<vector<PartitionEntry>>();
+      if (false == ReadPartitionManifest(MkManifestPath(data_dir_, type, date), *entries)
+          && false == (type == RecordType::NbboPrice
+                       && ReadPartitionManifest(MkManifestPath(data_dir_, RecordType::Nbbo, date), *entries))) {
+        entries.reset();
+      }
+      found = manifests_.insert(make_pair(date, move(entries))).first;
+    }
+    if (!found->second) {
+      return symbol.substr(0, 1);
+    }
+    const PartitionEntry* entry = FindPartition(*found->second, symbol);
+    if (!entry) {
+      throw(domain_error("Not found date:" + boost::gregorian::to_simple_string(date) + " symbol:" + symbol));
+    }
+    return entry->partition;
+  }
+
+  // the manifest of the day being loaded is kept, so the partition just looked up in it stays valid
+  void trim(Date loading) {
     if (daily_records_.size() >= max_size_) {
       // attempt to trim stale struct(s)
       vector<pair<Key, const DayRecordset<T>*>> tmp;
@@ -191,35 +547,78 @@ private:
         daily_records_.erase(tmp[i].first);
       }
     }
+    // manifests are reread once none of their day's files are loaded, so a day prepared again is picked up
+    for (auto it = manifests_.begin(); it != manifests_.end(); ) {
+      auto loaded = daily_records_.lower_bound(make_pair(it->first, string()));
+      if (it->first != loading && (loaded == daily_records_.end() || loaded->first.first != it->first)) {
+        it = manifests_.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
 
-  DayRecordset<T>& load(Date date, char symbol_group) {
+  DayRecordset<T>& load(Date date, const string& partition) {
     DayRecordset<T>* retval = nullptr;
-    auto key = make_pair(date, symbol_group);
+    auto key = make_pair(date, partition);
     auto found = daily_records_.find(key);
     if (found != daily_records_.end()) {
       retval = found->second.get();
     }
     else {
-      trim();
-      fs::path file_path = MkDataFilePath(data_dir_, RecordTypeFromString(typeid(T).name()), date, symbol_group);
+      const RecordType type = RecordTypeFromString(typeid(T).name());
+      fs::path file_path = MkDataFilePath(data_dir_, type, date, partition);
+      if ((type == RecordType::Trade || type == RecordType::TradeNbbo || type == RecordType::Bar) && partition.size()
+          && false == fs::exists(file_path)) {
+        return load(date, string());   // trades prepared without --symbol-group are in one whole-day file
+      }
+      if (type == RecordType::NbboPrice && false == fs::exists(file_path)) {
+        file_path = MkDataFilePath(data_dir_, RecordType::Nbbo, date, partition);    // v8 nbbo files index their prices
+      }
+      trim(date);
       if (false == (fs::exists(file_path) && fs::is_regular_file(file_path))) {
         throw domain_error("Input file not found : " + file_path.string());
       }
       const size_t file_size = (size_t)fs::file_size(file_path);
-      if (file_size < sizeof(FileHeader)) {
+      if (file_size < sizeof(FileHeaderV1)) {
         throw domain_error("Input file size too small to accomodate header : " + file_path.string());
       }
       mm::file_mapping mmfile(file_path.string().c_str(), mm::read_only);
-      mm::mapped_region mmreg_header(mmfile, mm::read_only, 0, sizeof(FileHeader));
-      const FileHeader& file_header = *(FileHeader*)mmreg_header.get_address();
-      if ((sizeof(file_header) + file_header.symb_cnt * sizeof(SymbolMap) + file_header.rec_cnt * sizeof(T)) != file_size) {
+      FileHeader file_header(FILE_VERSION_PACKED);
+      {
+        mm::mapped_region mmreg_header(mmfile, mm::read_only, 0, std::min(file_size, sizeof(FileHeader)));
+        if (false == ReadFileHeader((const char*)mmreg_header.get_address(), mmreg_header.get_size(), file_header)) {
+          throw domain_error("Input file size too small to accomodate header : " + file_path.string());
+        }
+      }
+      if (false == IsSupportedFileVersion(file_header.version)) {
+        throw domain_error("Unsupported file version : " + file_path.string());
+      }
+      const size_t footer_size = TrailerFooterSize(file_header.version);
+      vector<char> footer(footer_size);
+      if (footer_size && file_size >= FileHeaderSize(file_header.version) + footer_size) {
+        mm::mapped_region mmreg_footer(mmfile, mm::read_only, file_size - footer_size, footer_size);
+        memcpy(footer.data(), mmreg_footer.get_address(), footer_size);
+      }
+      FileSections sections;
+      if (false == LocateFileSections(file_header, RecordWidth(file_header.type, file_header.version), file_size,
+                                      footer.data(), sections)) {
         throw domain_error("Input file corruption : " + file_path.string());
       }
-      size_t off = sizeof(FileHeader) + file_header.rec_cnt * sizeof(T);
+      if (file_header.type != type && false == (type == RecordType::NbboPrice && file_header.type == RecordType::Nbbo
+                                                && HasPriceIndex(file_header.version)
+                                                && sections.price_entry_cnt == (size_t)file_header.symb_cnt)) {
+        throw domain_error("Input file record type mismatch : " + file_path.string());
+      }
+      size_t off = sections.symbol_map;
       size_t siz = file_size - off;
       mm::mapped_region mmreg_map(mmfile, mm::read_only, off, siz);
-      auto inserted = daily_records_.insert(make_pair(key, make_unique<DayRecordset<T>>(date, mmfile, mmreg_header, mmreg_map)));
+      if (false == ValidateBlockIndex(file_header, sections,
+                                      (const BlockIndexEntry*)((const char*)mmreg_map.get_address() + sections.block_index - off))) {
+        throw domain_error("Input file corruption : " + file_path.string());
+      }
+      auto inserted = daily_records_.insert(make_pair(key, make_unique<DayRecordset<T>>(date, mmfile, file_header, mmreg_map,
+                                                                                        sections)));
       retval = inserted.first->second.get();
     }
     if (!retval) {
@@ -231,8 +630,9 @@ private:
   const string data_dir_;
   const size_t max_size_;
   mutex mtx_;
-  typedef pair<Date, char> Key;
+  typedef pair<Date, string> Key;
   map<Key, unique_ptr<DayRecordset<T>>> daily_records_;
+  map<Date, unique_ptr<vector<PartitionEntry>>> manifests_;   // null when a day has no manifest
 };
 
 
@@ -283,11 +683,16 @@ private:
   char* write_ptr_;
 };
 
-void InitializeData(const string& data_dir);
+void InitializeData(const string& data_dir, size_t block_cache_size);
 void CleanupData();
 tick_calc::SecMasterManager & SecurityMasterManager();
 tick_calc::RecordsetManager<Nbbo> & QuoteRecordsetManager();
 tick_calc::RecordsetManager<NbboPrice>& NbboPoRecordsetManager();
+tick_calc::RecordsetManager<ExchangeBbo>& BboRecordsetManager();
+tick_calc::RecordsetManager<TradeNbbo>& TradeNbboRecordsetManager();
+tick_calc::RecordsetManager<Bar>& BarRecordsetManager();
+tick_calc::SummaryManager& DailySummaryManager();
+tick_calc::SnapshotManager& NbboSnapshotManager();
 
 }
 
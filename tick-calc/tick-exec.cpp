@@ -24,6 +24,32 @@ void InitializeFunctionDefinitions() {
     vector<string> {"ID", "Timestamp", "BestBidPx", "BestBidQty", "BestOfferPx", "BestOfferQty"}
   )));
 
+  function_definitions.insert(make_pair("VenueNbbo", FunctionDefinition("VenueNbbo",
+    vector<string> {"Symbol", "Timestamp", "Exchanges"},
+    vector<string> {"ID", "Timestamp", "BestBidPx", "BestBidQty", "BestOfferPx", "BestOfferQty"}
+  )));
+
+  function_definitions.insert(make_pair("TradeSign", FunctionDefinition("TradeSign",
+    vector<string> {"Symbol", "Date", "StartTime", "EndTime"},
+    vector<string> {"ID", "Timestamp", "TradePx", "TradeQty", "Side", "EffectiveSpread", "QuoteTimestamp"}
+  )));
+
+  function_definitions.insert(make_pair("Bars", FunctionDefinition("Bars",
+    vector<string> {"Symbol", "Date", "StartTime", "EndTime", "Interval"},
+    vector<string> {"ID", "Timestamp", "OpenPx", "HighPx", "LowPx", "ClosePx", "Volume", "VeVolume", "TradeCount", "MidPx"}
+  )));
+
+  function_definitions.insert(make_pair("DailyStats", FunctionDefinition("DailyStats",
+    vector<string> {"Symbol", "StartDate", "EndDate"},
+    vector<string> {"ID", "Days", "OpenPx", "HighPx", "LowPx", "ClosePx", "Volume", "VeVolume", "AvgVeVolume", "Vwap",
+                    "TradeCount", "QuoteCount", "NbboCount", "AvgSpread", "NbboUpdateRate"}
+  )));
+
+  function_definitions.insert(make_pair("Snapshot", FunctionDefinition("Snapshot",
+    vector<string> {"Symbol", "Timestamp"},
+    vector<string> {"ID", "Symbol", "Timestamp", "BestBidPx", "BestBidQty", "BestOfferPx", "BestOfferQty"}
+  )));
+
   function_definitions.insert(make_pair("ROD", FunctionDefinition("ROD",
     vector<string> {"ID", "Symbol", "Date", "StartTime", "EndTime", "Side", "OrdQty", "LimitPx", "MPA", "ExecTime", "ExecQty"},
     vector<string> {"ID", "MinusThree", "MinusTwo", "MinusOne", "Zero", "PlusOne", "PlusTwo", "PlusThree"}
@@ -41,6 +67,21 @@ static void LoadExecutionPlan(Connection& conn) {
     else if (function_name == "Quote") {
       conn.exec_plans.push_back(make_unique<QuoteExecutionPlan>(function, request, it->second));
     }
+    else if (function_name == "VenueNbbo") {
+      conn.exec_plans.push_back(make_unique<VenueNbboExecutionPlan>(function, request, it->second));
+    }
+    else if (function_name == "TradeSign") {
+      conn.exec_plans.push_back(make_unique<TradeSignExecutionPlan>(function, request, it->second));
+    }
+    else if (function_name == "Bars") {
+      conn.exec_plans.push_back(make_unique<BarsExecutionPlan>(function, request, it->second));
+    }
+    else if (function_name == "DailyStats") {
+      conn.exec_plans.push_back(make_unique<DailyStatsExecutionPlan>(function, request, it->second));
+    }
+    else if (function_name == "Snapshot") {
+      conn.exec_plans.push_back(make_unique<SnapshotExecutionPlan>(function, request, it->second));
+    }
     else if (function_name == "ROD") {
       conn.exec_plans.push_back(make_unique<RodExecutionPlan>(function, request, it->second));
     }
@@ -307,7 +348,8 @@ ExecutionPlan::State ExecutionPlan::CheckState() {
         make_move_iterator(exec_unit->output_records.end()));
       exec_unit->output_records.clear();
     }
-    sort(output_records.begin(), output_records.end(), [](const auto& left, const auto& right) {
+    // stable, as functions such as TradeSign and Bars output several records per id in order
+    stable_sort(output_records.begin(), output_records.end(), [](const auto& left, const auto& right) {
       return left.id < right.id;
       });
   }
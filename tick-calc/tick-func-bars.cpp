@@ -0,0 +1,160 @@
+#include "tuple"
+#include "algorithm"
+#include "iterator"
+
+#include "boost-algorithm-string.h"
+#include "taq-proc.h"
+#include "tick-func.h"
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// fields of a bar in RecordLayout<Bar> order
+enum BarColumn {
+  BCOL_Time, BCOL_Open, BCOL_High, BCOL_Low, BCOL_Close, BCOL_Volume, BCOL_VeVolume, BCOL_Mid, BCOL_TradeCnt
+};
+
+// the 1-second bars of an interval folded into one
+struct BarTotals {
+  int64_t high;
+  int64_t low;
+  int64_t volume;
+  int64_t ve_volume;
+  int64_t trade_cnt;
+  BarTotals() : high(INT64_MIN), low(INT64_MAX), volume(0), ve_volume(0), trade_cnt(0) {}
+  void Add(const Bar& bar) {
+    high = max(high, bar.high);
+    low = min(low, bar.low);
+    volume += bar.volume;
+    ve_volume += bar.ve_volume;
+    trade_cnt += bar.trade_cnt;
+  }
+};
+
+// the columns of a mapped file are not aligned for their type, so values are copied out; each loop carries nothing but
+// its result from one value to the next, which lets the compiler vectorize it
+template <typename V, typename Op>
+static int64_t FoldColumn(const char* column, size_t count, int64_t init, Op op) {
+  for (size_t i = 0; i < count; i++) {
+    V value;
+    memcpy(&value, column + i * sizeof(V), sizeof(V));
+    init = op(init, (int64_t)value);
+  }
+  return init;
+}
+
+// bars [first, last) of the symbol, reduced column by column within each block; v1 and v2 bars are gathered one by one
+static BarTotals FoldBars(const SortedConstVector<Bar>& bars, size_t first, size_t last) {
+  BarTotals totals;
+  auto max_op = [](int64_t lh, int64_t rh) { return max(lh, rh); };
+  auto min_op = [](int64_t lh, int64_t rh) { return min(lh, rh); };
+  auto sum_op = [](int64_t lh, int64_t rh) { return lh + rh; };
+  for (size_t idx = first; idx < last; ) {
+    const auto block = bars.block(idx);
+    if (nullptr == bars.column(block, BCOL_High, idx)) {
+      for (; idx < last; idx++) {
+        totals.Add(bars[idx]);
+      }
+      break;
+    }
+    const size_t count = min(last, block.first + block.count) - idx;
+    totals.high = FoldColumn<int64_t>(bars.column(block, BCOL_High, idx), count, totals.high, max_op);
+    totals.low = FoldColumn<int64_t>(bars.column(block, BCOL_Low, idx), count, totals.low, min_op);
+    totals.volume = FoldColumn<int64_t>(bars.column(block, BCOL_Volume, idx), count, totals.volume, sum_op);
+    totals.ve_volume = FoldColumn<int64_t>(bars.column(block, BCOL_VeVolume, idx), count, totals.ve_volume, sum_op);
+    totals.trade_cnt = FoldColumn<int>(bars.column(block, BCOL_TradeCnt, idx), count, totals.trade_cnt, sum_op);
+    idx += count;
+  }
+  return totals;
+}
+
+// intervals run from the start time in steps of the requested seconds and hold the bars that start in them; intervals
+// without trades have no bar, and the search for the next interval skips them
+void BarsExecutionPlan::BarsExecutionUnit::Execute() {
+  auto & secmaster_mgr = SecurityMasterManager();
+  auto & bar_mgr = BarRecordsetManager();
+  const SecMaster* secmaster = nullptr;
+  const SymbolRecordset<Bar>* symbol_recordset = nullptr;
+  const Security* security = nullptr;
+  try {
+    secmaster = &secmaster_mgr.Load(date);
+    security = &secmaster->FindBySymbol(symbol);
+    symbol_recordset = &bar_mgr.LoadSymbolRecordset(date, security->symb);
+  }
+  catch (...) {
+    Error(ErrorType::DataNotFound, (int)input_records.size());
+    return;
+  }
+  const Time taq_time_adjustment = adjust_time ? UtcToTaq(date) : ZeroTime();
+  auto & bars = symbol_recordset->records;
+  for (auto rec : input_records) {
+    const int64_t start_time = NanosFromTime(rec.start_time + taq_time_adjustment);
+    const int64_t end_time = NanosFromTime(rec.end_time + taq_time_adjustment);
+    const int64_t interval = rec.interval * Bar::NANOS;
+    auto it = bars.lower_bound(bars.begin(), bars.end(), start_time);
+    while (it != bars.end() && it.time() < end_time) {
+      const int64_t interval_start = start_time + (it.time() - start_time) / interval * interval;
+      const auto next = bars.lower_bound(it, bars.end(), min(interval_start + interval, end_time));
+      const BarTotals totals = FoldBars(bars, it.index(), next.index());
+      const Bar first = *it;
+      const Bar last = bars[next.index() - 1];
+      ostringstream ss;
+      ss << rec.id << '|' << TimeFromNanos(interval_start) << '|' << PriceFromTicks(first.open)
+         << '|' << PriceFromTicks(totals.high) << '|' << PriceFromTicks(totals.low) << '|' << PriceFromTicks(last.close)
+         << '|' << totals.volume << '|' << totals.ve_volume << '|' << totals.trade_cnt << '|';
+      if (last.mid) {
+        ss << PriceFromTicks(last.mid);
+      }
+      ss << endl;
+      output_records.emplace_back(rec.id, ss.str());
+      it = next;
+    }
+  }
+  bar_mgr.UnloadSymbolRecordset(date, security->symb);
+  secmaster_mgr.Release(*secmaster);
+}
+
+void BarsExecutionPlan::Input(InputRecord& input_record) {
+  try {
+    const string & symbol = input_record.values[argument_mapping[0]];
+    if (symbol.empty()) {
+      throw Exception(ErrorType::MissingSymbol);
+    }
+    const Date date = MkDate(input_record.values[argument_mapping[1]]);
+    const Time start_time = MkTime(input_record.values[argument_mapping[2]]);
+    const Time end_time = MkTime(input_record.values[argument_mapping[3]]);
+    const int interval = ParseInt(input_record.values[argument_mapping[4]]);
+    if (interval <= 0) {
+      throw Exception(ErrorType::InvalidArgument);
+    }
+    input_record_ranges[make_pair(symbol, date)].emplace_back(input_record.id, start_time, end_time, interval);
+  }
+  catch (const Exception & Ex) {
+    Error(Ex.errtype());
+  }
+  catch (...) {
+    Error(ErrorType::InvalidArgument);
+  }
+}
+
+void BarsExecutionPlan::Execute() {
+  typedef tuple<string, Date, InputRecordRange*> InputRecordSlice;
+  vector<InputRecordSlice> slices;
+  for (auto & range : input_record_ranges) {
+    slices.push_back(make_tuple(range.first.first, range.first.second, &range.second));
+  }
+  sort(slices.begin(), slices.end(),[] (const InputRecordSlice &left, const InputRecordSlice &right) {
+    return (get<2>(left)->size() > get<2>(right)->size());
+  });
+  for (auto& slice : slices) {
+    shared_ptr<ExecutionUnit> job = make_shared<BarsExecutionUnit>(
+      get<0>(slice), get<1>(slice), request.tz_name == "UTC", move(*get<2>(slice))
+    );
+    todo_list.push_back(job);
+    AddExecutionUnit(job);
+  }
+}
+
+}
@@ -0,0 +1,148 @@
+#include "algorithm"
+#include "iterator"
+
+#include "boost-algorithm-string.h"
+#include "taq-proc.h"
+#include "tick-func.h"
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// the summaries of a symbol over the days of a range; prices are those of the days' trades eligible for last sale; the
+// value of a day fits its int64_t but that of a long range of a high-priced symbol need not, so it adds up in double
+struct DailyStatsTotals {
+  int days = 0;
+  int quote_days = 0;
+  int64_t open = 0;
+  int64_t high = 0;
+  int64_t low = 0;
+  int64_t close = 0;
+  int64_t volume = 0;
+  int64_t ve_volume = 0;
+  double ve_value = 0;
+  int64_t trade_cnt = 0;
+  int64_t quote_cnt = 0;
+  int64_t nbbo_cnt = 0;
+  int64_t session_nbbo_cnt = 0;
+  int64_t two_sided_time = 0;
+  double spread_time = 0;
+  void Add(const DailySummary& summary) {
+    const DailySummary::Trades& trades = summary.trades;
+    const DailySummary::Quotes& quotes = summary.quotes;
+    days++;
+    quote_days += summary.parts & DailySummary::QUOTES ? 1 : 0;
+    open = open ? open : trades.open;
+    high = max(high, trades.high);
+    low = low && trades.low ? min(low, trades.low) : max(low, trades.low);
+    close = trades.close ? trades.close : close;
+    volume += trades.volume;
+    ve_volume += trades.ve_volume;
+    ve_value += (double)trades.ve_value;
+    trade_cnt += trades.trade_cnt;
+    quote_cnt += quotes.quote_cnt;
+    nbbo_cnt += quotes.nbbo_cnt;
+    session_nbbo_cnt += quotes.session_nbbo_cnt;
+    two_sided_time += quotes.two_sided_time;
+    spread_time += quotes.spread_time;
+  }
+};
+
+static void PrintPrice(ostream& os, int64_t ticks) {
+  os << '|';
+  if (ticks) {
+    os << PriceFromTicks(ticks);
+  }
+}
+
+// the days of the range are loaded once for all symbols of the unit; days without a summary file, e.g. weekends and
+// holidays, are skipped
+void DailyStatsExecutionPlan::DailyStatsExecutionUnit::Execute() {
+  auto & summary_mgr = DailySummaryManager();
+  static const double session_seconds =
+    (double)(DailySummary::REGULAR_CLOSE - DailySummary::REGULAR_OPEN) / Bar::NANOS;
+  vector<const DaySummary*> days;
+  for (Date date = start_date; date <= end_date; date += boost::gregorian::days(1)) {
+    try {
+      days.push_back(&summary_mgr.Load(date));
+    }
+    catch (...) {
+    }
+  }
+  for (auto & rec : input_records) {
+    DailyStatsTotals totals;
+    for (const DaySummary* day : days) {
+      const DailySummary* summary = day->FindBySymbol(rec.symbol);
+      if (summary && summary->parts) {
+        totals.Add(*summary);
+      }
+    }
+    if (0 == totals.days) {
+      Error(ErrorType::DataNotFound);
+      continue;
+    }
+    ostringstream ss;
+    ss << rec.id << '|' << totals.days;
+    PrintPrice(ss, totals.open);
+    PrintPrice(ss, totals.high);
+    PrintPrice(ss, totals.low);
+    PrintPrice(ss, totals.close);
+    ss << '|' << totals.volume << '|' << totals.ve_volume << '|' << totals.ve_volume / totals.days << '|';
+    if (totals.ve_volume) {
+      ss << totals.ve_value / totals.ve_volume / PRICE_TICKS_PER_UNIT;
+    }
+    ss << '|' << totals.trade_cnt << '|' << totals.quote_cnt << '|' << totals.nbbo_cnt << '|';
+    if (totals.two_sided_time) {
+      ss << totals.spread_time / totals.two_sided_time / PRICE_TICKS_PER_UNIT;
+    }
+    ss << '|';
+    if (totals.quote_days) {
+      ss << totals.session_nbbo_cnt / (totals.quote_days * session_seconds);
+    }
+    ss << endl;
+    output_records.emplace_back(rec.id, ss.str());
+  }
+  for (const DaySummary* day : days) {
+    summary_mgr.Release(*day);
+  }
+}
+
+void DailyStatsExecutionPlan::Input(InputRecord& input_record) {
+  try {
+    const string & symbol = input_record.values[argument_mapping[0]];
+    if (symbol.empty()) {
+      throw Exception(ErrorType::MissingSymbol);
+    }
+    const Date start_date = MkDate(input_record.values[argument_mapping[1]]);
+    const Date end_date = MkDate(input_record.values[argument_mapping[2]]);
+    if (end_date < start_date) {
+      throw Exception(ErrorType::InvalidArgument);
+    }
+    input_record_ranges[make_pair(start_date, end_date)].emplace_back(input_record.id, symbol);
+  }
+  catch (const Exception & Ex) {
+    Error(Ex.errtype());
+  }
+  catch (...) {
+    Error(ErrorType::InvalidArgument);
+  }
+}
+
+// a screen of many symbols over one range is cut into several units, so that it runs on several threads
+void DailyStatsExecutionPlan::Execute() {
+  for (auto & range : input_record_ranges) {
+    InputRecordRange & records = range.second;
+    for (size_t first = 0; first < records.size(); first += UNIT_RECORDS) {
+      const size_t last = min(records.size(), first + UNIT_RECORDS);
+      shared_ptr<ExecutionUnit> job = make_shared<DailyStatsExecutionUnit>(
+        range.first.first, range.first.second, InputRecordRange(make_move_iterator(records.begin() + first),
+                                                                 make_move_iterator(records.begin() + last))
+      );
+      todo_list.push_back(job);
+      AddExecutionUnit(job);
+    }
+  }
+}
+
+}
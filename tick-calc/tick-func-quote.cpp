@@ -16,12 +16,13 @@ void QuoteExecutionPlan::QuoteExecutionUnit::Execute() {
   auto & quote_mgr = QuoteRecordsetManager();
   const SecMaster* secmaster = nullptr;
   const SymbolRecordset<Nbbo>* symbol_recordset = nullptr;
+  const Security* security = nullptr;
   int lot_size = 100;
   try {
     secmaster = &secmaster_mgr.Load(date);
-    const Security &security = secmaster->FindBySymbol(symbol);
-    lot_size = security.lot_size;
-    symbol_recordset = &quote_mgr.LoadSymbolRecordset(date, security.symb);
+    security = &secmaster->FindBySymbol(symbol);
+    lot_size = security->lot_size;
+    symbol_recordset = &quote_mgr.LoadSymbolRecordset(date, security->symb);
   }
   catch (...) {
     Error(ErrorType::DataNotFound, (int)input_records.size());
@@ -34,29 +35,29 @@ void QuoteExecutionPlan::QuoteExecutionUnit::Execute() {
   auto & quotes = symbol_recordset->records;
   auto it = quotes.begin();
   for (auto rec : input_records) {
-    const Time requested_time = rec.time + taq_time_adjustment;
+    const int64_t requested_time = NanosFromTime(rec.time + taq_time_adjustment);
     it = quotes.find_prior(it, quotes.end(), requested_time);
     if (it != quotes.end()) {
+      const Nbbo quote = *it;
       ostringstream ss;
-      ss << rec.id << '|' << it->time << '|' << it->bidp << '|' << (it->bids * lot_size)
-                                      << '|' << it->askp << '|' << (it->asks * lot_size) << endl;
+      ss << rec.id << '|' << TimeFromNanos(quote.time) << '|' << PriceFromTicks(quote.bidp) << '|' << (quote.bids * lot_size)
+                 << '|' << PriceFromTicks(quote.askp) << '|' << (quote.asks * lot_size) << endl;
       output_records.emplace_back(rec.id, ss.str());
     } else {
       Error(ErrorType::DataNotFound);
     }
   }
-  quote_mgr.UnloadSymbolRecordset(date, symbol);
+  quote_mgr.UnloadSymbolRecordset(date, security->symb);
   secmaster_mgr.Release(*secmaster);
 }
 
 void QuoteExecutionPlan::Input(InputRecord& input_record) {
   const string & symbol = input_record.values[argument_mapping[0]];
   const string & timestamp = input_record.values[argument_mapping[1]];
-  vector<string> values;
-  boost::split(values, timestamp, boost::is_any_of("T "));
-  if (values.size() ==2) {
-    const Date date = MkDate(values[0]);
-    const Time time = MkTime(values[1]);
+  string_view date_text, time_text;
+  if (SplitTimestamp(timestamp, date_text, time_text)) {
+    const Date date = MkDate(date_text);
+    const Time time = MkTime(time_text);
     InputRecordRange& input_range = input_record_ranges[make_pair(symbol, date)];
     input_range.emplace_back(input_record.id, time);
   }
@@ -17,10 +17,10 @@ namespace tick_calc {
 using RestType = RodExecutionPlan::RestType;
 
 struct RodSlice{
-  RodSlice(Time start_time, Time end_time, int leaves_qty)
+  RodSlice(int64_t start_time, int64_t end_time, int leaves_qty)
     : start_time(start_time), end_time(end_time), leaves_qty(leaves_qty) { }
-  const Time start_time;
-  const Time end_time;
+  const int64_t start_time;
+  const int64_t end_time;
   const int leaves_qty;
 };
 
@@ -29,7 +29,7 @@ static bool LooksLikeNumber(const string& str) {
 }
 static RestType DecodeRestType(const string& str) {
   if (LooksLikeNumber(str)) {
-    const int val = stoi(str);
+    const int val = ParseInt(str);
     if (val >= -(int)RestType::Zero && val <= (int)RestType::Zero) {
       return (RestType)(val + (int)RestType::Zero);
     }
@@ -59,27 +59,28 @@ static RestType InvertRestType(const RestType mpa) {
   return (RestType)(-1 * ((int)mpa - (int)RestType::Zero) + (int)RestType::Zero);
 }
 
-static RestType RestingType(const NbboPrice &nbbo, char side, const Double &limit_price, const RestType &mpa) {
-  if (limit_price.Empty() || limit_price.IsZero() || mpa == RestType::MinusThree) {
+// prices are in ticks, so they compare exactly; the midpoint is compared at twice the price to stay integer
+static RestType RestingType(const NbboPrice &nbbo, char side, bool has_limit_price, int64_t limit_price,
+                            const RestType &mpa) {
+  if (false == has_limit_price || mpa == RestType::MinusThree) {
     return mpa;
   }
   RestType retval = RestType::None;
-  const bool valid_nbbo = nbbo.bidp > 0 && nbbo.askp < numeric_limits<double>::max();
+  const bool valid_nbbo = nbbo.bidp > 0 && nbbo.askp != NO_OFFER_TICKS;
   if (valid_nbbo) {
-    const Double bid(nbbo.bidp);
-    const Double offer(nbbo.askp);
-    const Double mid(.5 * (nbbo.bidp + nbbo.askp));
-    if (limit_price.Less(bid)) {
+    const int64_t double_limit_price = 2 * limit_price;
+    const int64_t double_mid = nbbo.bidp + nbbo.askp;
+    if (limit_price < nbbo.bidp) {
       retval = RestType::MinusThree;
-    } else if (limit_price.Equal(bid)) {
+    } else if (limit_price == nbbo.bidp) {
       retval = RestType::MinusTwo;
-    } else if (limit_price.Greater(bid) && limit_price.Less(mid)) {
+    } else if (double_limit_price < double_mid) {
       retval = RestType::MinusOne;
-    } else if (limit_price.Equal(mid)) {
+    } else if (double_limit_price == double_mid) {
       retval = RestType::Zero;
-    } else if (limit_price.Greater(mid) && limit_price.Less(offer)) {
+    } else if (limit_price < nbbo.askp) {
       retval = RestType::PlusOne;
-    } else if (limit_price.Equal(offer)) {
+    } else if (limit_price == nbbo.askp) {
       retval = RestType::PlusTwo;
     } else {
       retval = RestType::PlusThree;
@@ -94,23 +95,28 @@ static RestType RestingType(const NbboPrice &nbbo, char side, const Double &limi
   return retval;
 }
 
-static void CalculateROD(vector<double> &result, const NbboPrice*quote_start, const NbboPrice* quote_end,
-                        const vector<RodSlice> slices, char side, const Double &limit_price, const RestType &mpa) {
+static void CalculateROD(vector<double> &result, SortedConstVector<NbboPrice>::const_iterator quote_start,
+                        SortedConstVector<NbboPrice>::const_iterator quote_end,
+                        const vector<RodSlice> slices, char side, bool has_limit_price, int64_t limit_price,
+                        const RestType &mpa) {
     auto slice = slices.begin();
-    const NbboPrice* current_quote = quote_start;
+    auto current_quote = quote_start;
     while (slice != slices.end()) {
-      const Time start_time = max(slice->start_time, current_quote->time); // latest of slice start time or curent nbbo time
-      const NbboPrice* next_quote = (current_quote + 1) < quote_end ? current_quote + 1 : nullptr;
-      const Time end_time = next_quote            // check if subsequent quote is present
-        ? min(slice->end_time, next_quote->time)  // earlierst of end of slice or nbbo change i.e. next nbbo time
+      const NbboPrice current_nbbo = *current_quote;
+      const int64_t start_time = max(slice->start_time, current_nbbo.time); // latest of slice start time or curent nbbo time
+      const auto next_quote = current_quote + 1;
+      const bool has_next_quote = next_quote < quote_end;
+      const int64_t next_time = has_next_quote ? next_quote.time() : 0;
+      const int64_t end_time = has_next_quote     // check if subsequent quote is present
+        ? min(slice->end_time, next_time)         // earlierst of end of slice or nbbo change i.e. next nbbo time
         : slice->end_time;
 
-      const RestType rest_type = RestingType(*current_quote, side, limit_price, mpa);
+      const RestType rest_type = RestingType(current_nbbo, side, has_limit_price, limit_price, mpa);
       if (rest_type != RestType::None) {
         auto& shares_per_second = result[(int)rest_type];
-        shares_per_second += .000001 * (end_time - start_time).total_microseconds() * slice->leaves_qty;
+        shares_per_second += .000001 * ((end_time - start_time) / 1000) * slice->leaves_qty;   // whole microseconds
       }
-      if (next_quote && next_quote->time < slice->end_time) {
+      if (has_next_quote && next_time < slice->end_time) {
         current_quote = next_quote;
       } else {
         ++ slice;
@@ -123,10 +129,11 @@ void RodExecutionPlan::RodExecutionUnit::Execute() {
   auto& quote_mgr = NbboPoRecordsetManager();
   const SecMaster* secmaster = nullptr;
   const SymbolRecordset<NbboPrice> * symbol_recordset = nullptr;
+  const Security* security = nullptr;
   try {
     secmaster = &secmaster_mgr.Load(date);
-    const Security& security = secmaster->FindBySymbol(symbol);
-    symbol_recordset = &quote_mgr.LoadSymbolRecordset(date, security.symb);
+    security = &secmaster->FindBySymbol(symbol);
+    symbol_recordset = &quote_mgr.LoadSymbolRecordset(date, security->symb);
   } catch (...) {
     Error(ErrorType::DataNotFound, (int)input_records.size());
     return;
@@ -146,8 +153,8 @@ void RodExecutionPlan::RodExecutionUnit::Execute() {
     const InputRecord &rec = *prec;
     try {
       ostringstream ss;
-      const Time start_time_adjusted = rec.start_time + taq_time_adjustment;
-      const Time end_time_adjusted = rec.end_time + taq_time_adjustment;
+      const int64_t start_time_adjusted = NanosFromTime(rec.start_time + taq_time_adjustment);
+      const int64_t end_time_adjusted = NanosFromTime(rec.end_time + taq_time_adjustment);
 
       quote_start = quotes.find_prior(quote_start, quotes.end(), start_time_adjusted);
       if (quote_start == quotes.end()) {
@@ -168,10 +175,10 @@ void RodExecutionPlan::RodExecutionUnit::Execute() {
         });
         // split order duration into execution count + 1 slices (start and end times, and leaves qty)
         int leaves_qty = rec.ord_qty;
-        Time slice_start_time = start_time_adjusted;
-        Time slice_end_time;
+        int64_t slice_start_time = start_time_adjusted;
+        int64_t slice_end_time;
         for (auto exec : sorted_executions) {
-          const Time exec_time_adjusted = exec.first + taq_time_adjustment;
+          const int64_t exec_time_adjusted = NanosFromTime(exec.first + taq_time_adjustment);
           const int exec_qty = exec.second;
           slice_end_time = exec_time_adjusted;
           if (slice_end_time < slice_start_time) {
@@ -195,7 +202,9 @@ void RodExecutionPlan::RodExecutionUnit::Execute() {
       vector<double> rod_values((size_t)RestType::Max, .0);
       if (!slices.empty()) {
         auto quote_end = quotes.upper_bound(quote_start, quotes.end(), slices.rbegin()->end_time);
-        CalculateROD(rod_values, quote_start, quote_end, slices, rec.side, rec.limit_price, rec.mpa);
+        const bool has_limit_price = false == (rec.limit_price.Empty() || rec.limit_price.IsZero());
+        const int64_t limit_price = has_limit_price ? MkPriceTicks(rec.limit_price) : 0;
+        CalculateROD(rod_values, quote_start, quote_end, slices, rec.side, has_limit_price, limit_price, rec.mpa);
       }
       ss << rec.order_id;
       for (size_t i = 0; i < rod_values.size(); i ++) {
@@ -210,7 +219,7 @@ void RodExecutionPlan::RodExecutionUnit::Execute() {
     }
   }
 
-  quote_mgr.UnloadSymbolRecordset(date, symbol);
+  quote_mgr.UnloadSymbolRecordset(date, security->symb);
   secmaster_mgr.Release(*secmaster);
 }
 
@@ -230,7 +239,7 @@ void RodExecutionPlan::Input(InputRecord& input_record) {
       const Time start_time = MkTime(input_record.values[START_TIME]);
       const Time end_time = MkTime(input_record.values[END_TIME]);
       const char side = DecodeSide(input_record.values[SIDE]);
-      const int ord_qty = stoi(input_record.values[ORD_QTY]);
+      const int ord_qty = ParseInt(input_record.values[ORD_QTY]);
       const Double limit_price(input_record.values[LMT_PX]);
       const RestType mpa = DecodeRestType(input_record.values[MPA]);
       auto pit = input_range.try_emplace(id, input_record.id, id, start_time, end_time, side, ord_qty, limit_price, mpa);
@@ -241,7 +250,7 @@ void RodExecutionPlan::Input(InputRecord& input_record) {
     const string & qty = input_record.values[EXEC_QTY];
     if (LooksLikeNumber(qty)) {
       const Time exec_time = MkTime(input_record.values[EXEC_TIME]);
-      const int exec_qty = stoi(qty);
+      const int exec_qty = ParseInt(qty);
       rec->executions.emplace_back(exec_time, exec_qty);
     }
   }
@@ -0,0 +1,134 @@
+#include "algorithm"
+#include "optional"
+
+#include "boost-algorithm-string.h"
+#include "taq-proc.h"
+#include "tick-func.h"
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// the last nbbo record at or before the time, searched for in the security's nbbo file
+static optional<Nbbo> FindNbbo(Date date, const Security& security, int64_t time) {
+  auto & quote_mgr = QuoteRecordsetManager();
+  const SymbolRecordset<Nbbo>* symbol_recordset = nullptr;
+  try {
+    symbol_recordset = &quote_mgr.LoadSymbolRecordset(date, security.symb);
+  }
+  catch (...) {
+    return nullopt;
+  }
+  optional<Nbbo> retval;
+  auto & quotes = symbol_recordset->records;
+  auto it = quotes.upper_bound(quotes.begin(), quotes.end(), time);
+  if (it != quotes.begin()) {
+    retval.emplace(*--it);
+  }
+  quote_mgr.UnloadSymbolRecordset(date, security.symb);
+  return retval;
+}
+
+// the stream is reused for the records of a unit, as setting one up for each record of a market-wide snapshot costs
+// more than finding the records
+static string PrintNbbo(ostringstream& ss, int id, const string& symbol, const Nbbo& quote, int lot_size) {
+  ss.str("");
+  ss << id << '|' << symbol << '|' << TimeFromNanos(quote.time) << '|' << PriceFromTicks(quote.bidp) << '|'
+     << (quote.bids * lot_size) << '|' << PriceFromTicks(quote.askp) << '|' << (quote.asks * lot_size) << endl;
+  return ss.str();
+}
+
+// a time of the day's snapshot grid reads the row of that time; other times, days without a snapshot file and
+// securities the file does not have a built column of are searched for in the nbbo files
+void SnapshotExecutionPlan::SnapshotExecutionUnit::Execute() {
+  auto & secmaster_mgr = SecurityMasterManager();
+  auto & snapshot_mgr = NbboSnapshotManager();
+  const SecMaster* secmaster = nullptr;
+  const DaySnapshot* snapshot = nullptr;
+  try {
+    secmaster = &secmaster_mgr.Load(date);
+  }
+  catch (...) {
+    Error(ErrorType::DataNotFound, (int)input_records.size());
+    return;
+  }
+  try {
+    snapshot = &snapshot_mgr.Load(date);
+  }
+  catch (...) {
+  }
+  const Time taq_time_adjustment = adjust_time ? UtcToTaq(date) : ZeroTime();
+  const int64_t requested_time = NanosFromTime(time + taq_time_adjustment);
+  const Nbbo* row = snapshot ? snapshot->Row(requested_time) : nullptr;
+  const vector<Security> & securities = secmaster->Securities();
+  // the snapshot's record when a quote run built the column of the security
+  auto find = [&](size_t i) -> optional<Nbbo> {
+    if (row && snapshot->IsColumnOf(i, securities[i]) && row[i].time != SnapshotGrid::NO_COLUMN) {
+      return row[i].time == SnapshotGrid::NO_NBBO ? nullopt : optional<Nbbo>(row[i]);
+    }
+    return FindNbbo(date, securities[i], requested_time);
+  };
+  ostringstream ss;
+  for (auto & rec : input_records) {
+    const size_t output_cnt = output_records.size();
+    if (rec.symbol.empty()) {
+      for (size_t i = 0; i < securities.size(); i++) {
+        const optional<Nbbo> quote = find(i);
+        if (quote) {
+          output_records.emplace_back(rec.id, PrintNbbo(ss, rec.id, securities[i].symb, *quote, securities[i].lot_size));
+        }
+      }
+    } else {
+      try {
+        const Security &security = secmaster->FindBySymbol(rec.symbol);
+        const optional<Nbbo> quote = find((size_t)(&security - securities.data()));
+        if (quote) {
+          output_records.emplace_back(rec.id, PrintNbbo(ss, rec.id, rec.symbol, *quote, security.lot_size));
+        }
+      }
+      catch (...) {
+      }
+    }
+    if (output_records.size() == output_cnt) {
+      Error(ErrorType::DataNotFound);
+    }
+  }
+  if (snapshot) {
+    snapshot_mgr.Release(*snapshot);
+  }
+  secmaster_mgr.Release(*secmaster);
+}
+
+void SnapshotExecutionPlan::Input(InputRecord& input_record) {
+  const string & symbol = input_record.values[argument_mapping[0]];
+  const string & timestamp = input_record.values[argument_mapping[1]];
+  string_view date_text, time_text;
+  try {
+    if (false == SplitTimestamp(timestamp, date_text, time_text)) {
+      throw Exception(ErrorType::InvalidTimestamp);
+    }
+    const Date date = MkDate(date_text);
+    const Time time = MkTime(time_text);
+    input_record_ranges[make_pair(date, time)].emplace_back(input_record.id, symbol);
+  }
+  catch (const Exception & Ex) {
+    Error(Ex.errtype());
+  }
+  catch (...) {
+    Error(ErrorType::InvalidTimestamp);
+  }
+}
+
+// the symbols asked for at one time share a unit, so a market-wide or filtered snapshot reads a single row
+void SnapshotExecutionPlan::Execute() {
+  for (auto & range : input_record_ranges) {
+    shared_ptr<ExecutionUnit> job = make_shared<SnapshotExecutionUnit>(
+      range.first.first, range.first.second, request.tz_name == "UTC", move(range.second)
+    );
+    todo_list.push_back(job);
+    AddExecutionUnit(job);
+  }
+}
+
+}
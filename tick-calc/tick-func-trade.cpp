@@ -0,0 +1,143 @@
+#include "tuple"
+#include "algorithm"
+#include "iterator"
+
+#include "boost-algorithm-string.h"
+#include "taq-proc.h"
+#include "tick-func.h"
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// direction of the last price change among the trades so far: the tick test of the Lee-Ready rule
+class TickTest {
+public:
+  TickTest() : last_price_(-1), direction_(0) {}
+  int Direction(int64_t price) const {
+    return last_price_ < 0 || price == last_price_ ? direction_ : (price > last_price_ ? 1 : -1);
+  }
+  void Update(int64_t price) {
+    direction_ = Direction(price);
+    last_price_ = price;
+  }
+private:
+  int64_t last_price_;
+  int direction_;
+};
+
+static bool HasQuote(const TradeNbbo& trade) {
+  return trade.bidp > 0 && trade.askp != NO_OFFER_TICKS && trade.askp >= trade.bidp;
+}
+
+// the tick test as of the trades before it: the last of them and the last other price before that
+static TickTest TickTestBefore(const SortedConstVector<TradeNbbo>& trades,
+                               SortedConstVector<TradeNbbo>::const_iterator it) {
+  TickTest tick_test;
+  if (it == trades.begin()) {
+    return tick_test;
+  }
+  const int64_t last_price = (*--it).price;
+  while (it != trades.begin()) {
+    const int64_t price = (*--it).price;
+    if (price != last_price) {
+      tick_test.Update(price);
+      break;
+    }
+  }
+  tick_test.Update(last_price);
+  return tick_test;
+}
+
+// trades above the prevailing midpoint are buys and below it sells; trades at the midpoint or without a two-sided
+// quote take the direction of the last price change; the effective spread is twice the distance to the midpoint
+static void SignTrade(const TradeNbbo& trade, const TickTest& tick_test, ostream& os) {
+  const int64_t doubled_distance = HasQuote(trade) ? 2 * trade.price - (trade.bidp + trade.askp) : 0;
+  const int direction = doubled_distance ? (doubled_distance > 0 ? 1 : -1) : tick_test.Direction(trade.price);
+  os << '|' << (direction > 0 ? "B" : direction < 0 ? "S" : "") << '|';
+  if (HasQuote(trade)) {
+    os << PriceFromTicks(abs(doubled_distance));
+  }
+  os << '|';
+  if (trade.quote_time >= 0) {
+    os << TimeFromNanos(trade.quote_time);
+  }
+}
+
+// each window is searched for, and the tick test of its first trade is taken from the trades just before it, so
+// overlapping windows cost no more than disjoint ones
+void TradeSignExecutionPlan::TradeSignExecutionUnit::Execute() {
+  auto & secmaster_mgr = SecurityMasterManager();
+  auto & trade_mgr = TradeNbboRecordsetManager();
+  const SecMaster* secmaster = nullptr;
+  const SymbolRecordset<TradeNbbo>* symbol_recordset = nullptr;
+  const Security* security = nullptr;
+  try {
+    secmaster = &secmaster_mgr.Load(date);
+    security = &secmaster->FindBySymbol(symbol);
+    symbol_recordset = &trade_mgr.LoadSymbolRecordset(date, security->symb);
+  }
+  catch (...) {
+    Error(ErrorType::DataNotFound, (int)input_records.size());
+    return;
+  }
+  const Time taq_time_adjustment = adjust_time ? UtcToTaq(date) : ZeroTime();
+  auto & trades = symbol_recordset->records;
+  for (auto rec : input_records) {
+    const int64_t start_time = NanosFromTime(rec.start_time + taq_time_adjustment);
+    const int64_t end_time = NanosFromTime(rec.end_time + taq_time_adjustment);
+    auto it = trades.lower_bound(trades.begin(), trades.end(), start_time);
+    TickTest tick_test = TickTestBefore(trades, it);
+    for (; it != trades.end() && it.time() <= end_time; ++it) {
+      const TradeNbbo trade = *it;
+      ostringstream ss;
+      ss << rec.id << '|' << TimeFromNanos(trade.time) << '|' << PriceFromTicks(trade.price) << '|' << trade.qty;
+      SignTrade(trade, tick_test, ss);
+      ss << endl;
+      output_records.emplace_back(rec.id, ss.str());
+      tick_test.Update(trade.price);
+    }
+  }
+  trade_mgr.UnloadSymbolRecordset(date, security->symb);
+  secmaster_mgr.Release(*secmaster);
+}
+
+void TradeSignExecutionPlan::Input(InputRecord& input_record) {
+  try {
+    const string & symbol = input_record.values[argument_mapping[0]];
+    if (symbol.empty()) {
+      throw Exception(ErrorType::MissingSymbol);
+    }
+    const Date date = MkDate(input_record.values[argument_mapping[1]]);
+    const Time start_time = MkTime(input_record.values[argument_mapping[2]]);
+    const Time end_time = MkTime(input_record.values[argument_mapping[3]]);
+    input_record_ranges[make_pair(symbol, date)].emplace_back(input_record.id, start_time, end_time);
+  }
+  catch (const Exception & Ex) {
+    Error(Ex.errtype());
+  }
+  catch (...) {
+    Error(ErrorType::InvalidArgument);
+  }
+}
+
+void TradeSignExecutionPlan::Execute() {
+  typedef tuple<string, Date, InputRecordRange*> InputRecordSlice;
+  vector<InputRecordSlice> slices;
+  for (auto & range : input_record_ranges) {
+    slices.push_back(make_tuple(range.first.first, range.first.second, &range.second));
+  }
+  sort(slices.begin(), slices.end(),[] (const InputRecordSlice &left, const InputRecordSlice &right) {
+    return (get<2>(left)->size() > get<2>(right)->size());
+  });
+  for (auto& slice : slices) {
+    shared_ptr<ExecutionUnit> job = make_shared<TradeSignExecutionUnit>(
+      get<0>(slice), get<1>(slice), request.tz_name == "UTC", move(*get<2>(slice))
+    );
+    todo_list.push_back(job);
+    AddExecutionUnit(job);
+  }
+}
+
+}
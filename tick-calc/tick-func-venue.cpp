@@ -0,0 +1,128 @@
+#include "tuple"
+#include "algorithm"
+#include "iterator"
+
+#include "boost-algorithm-string.h"
+#include "taq-proc.h"
+#include "taq-nbbo.h"
+#include "tick-func.h"
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// the exchanges listed by letter, or with a leading '-' every exchange except those listed
+static ExchangeMask DecodeExchanges(const string& exchanges) {
+  const bool exclude = exchanges.size() && exchanges[0] == '-';
+  if (exchanges.size() == 0) {
+    throw Exception(ErrorType::InvalidArgument);
+  }
+  ExchangeMask mask;
+  for (size_t i = exclude ? 1 : 0; i < exchanges.size(); i++) {
+    const int exch_idx = toupper(exchanges[i]) - 'A';
+    if (exch_idx < 0 || exch_idx >= Exch_Max) {
+      throw Exception(ErrorType::InvalidArgument);
+    }
+    mask.set(exch_idx);
+  }
+  return exclude ? ~mask : mask;
+}
+
+// the books hold prices in ticks, which doubles represent exactly, so the NBBO compares and reports the file's prices
+void VenueNbboExecutionPlan::VenueNbboExecutionUnit::Execute() {
+  auto & secmaster_mgr = SecurityMasterManager();
+  auto & bbo_mgr = BboRecordsetManager();
+  const SecMaster* secmaster = nullptr;
+  const SymbolRecordset<ExchangeBbo>* symbol_recordset = nullptr;
+  const Security* security = nullptr;
+  int lot_size = 100;
+  try {
+    secmaster = &secmaster_mgr.Load(date);
+    security = &secmaster->FindBySymbol(symbol);
+    lot_size = security->lot_size;
+    symbol_recordset = &bbo_mgr.LoadSymbolRecordset(date, security->symb);
+  }
+  catch (...) {
+    Error(ErrorType::DataNotFound, (int)input_records.size());
+    return;
+  }
+  if (false == input_sorted) {
+    sort(input_records.begin(), input_records.end(), [] (const auto &lh, const auto& rh) {return lh.time < rh.time;});
+  }
+  const Time taq_time_adjustment = adjust_time ? UtcToTaq(date) : ZeroTime();
+  auto & bbos = symbol_recordset->records;
+  auto it = bbos.begin();
+  ExchangeBook bid_book(NbboSide::BID), offer_book(NbboSide::OFFER);
+  NbboSide bid(NbboSide::BID), offer(NbboSide::OFFER);
+  int64_t nbbo_time = -1;
+  for (auto rec : input_records) {
+    const int64_t requested_time = NanosFromTime(rec.time + taq_time_adjustment);
+    for (; it != bbos.end() && it.time() <= requested_time; ++it) {
+      const ExchangeBbo bbo = *it;
+      const int exch_idx = bbo.exch - 'A';
+      if (exch_idx < 0 || exch_idx >= Exch_Max || false == exchanges.test(exch_idx)) {
+        continue;
+      }
+      bid_book.Set(NbboSide::BID, exch_idx, bbo.bids > 0, (double)bbo.bidp, bbo.bids);
+      offer_book.Set(NbboSide::OFFER, exch_idx, bbo.asks > 0, (double)bbo.askp, bbo.asks);
+      const NbboSide prev_bid = bid, prev_offer = offer;
+      ResetNbboSide<NbboSide::BID>(bid_book, bid);
+      ResetNbboSide<NbboSide::OFFER>(offer_book, offer);
+      if (bid.price != prev_bid.price || bid.size != prev_bid.size
+          || offer.price != prev_offer.price || offer.size != prev_offer.size) {
+        nbbo_time = bbo.time;
+      }
+    }
+    if (nbbo_time >= 0) {
+      const int64_t bidp = bid.size ? (int64_t)bid.price : 0;
+      const int64_t askp = offer.size ? (int64_t)offer.price : NO_OFFER_TICKS;
+      ostringstream ss;
+      ss << rec.id << '|' << TimeFromNanos(nbbo_time) << '|' << PriceFromTicks(bidp) << '|' << (bid.size * lot_size)
+                 << '|' << PriceFromTicks(askp) << '|' << (offer.size * lot_size) << endl;
+      output_records.emplace_back(rec.id, ss.str());
+    } else {
+      Error(ErrorType::DataNotFound);
+    }
+  }
+  bbo_mgr.UnloadSymbolRecordset(date, security->symb);
+  secmaster_mgr.Release(*secmaster);
+}
+
+void VenueNbboExecutionPlan::Input(InputRecord& input_record) {
+  const string & symbol = input_record.values[argument_mapping[0]];
+  const string & timestamp = input_record.values[argument_mapping[1]];
+  string_view date_text, time_text;
+  try {
+    const ExchangeMask exchanges = DecodeExchanges(input_record.values[argument_mapping[2]]);
+    if (SplitTimestamp(timestamp, date_text, time_text)) {
+      const Date date = MkDate(date_text);
+      const Time time = MkTime(time_text);
+      InputRecordRange& input_range = input_record_ranges[make_tuple(symbol, date, exchanges.to_ulong())];
+      input_range.emplace_back(input_record.id, time);
+    }
+  }
+  catch (const Exception & Ex) {
+    Error(Ex.errtype());
+  }
+}
+
+void VenueNbboExecutionPlan::Execute() {
+  typedef tuple<string, Date, ExchangeMask, InputRecordRange*> InputRecordSlice;
+  vector<InputRecordSlice> slices;
+  for (auto & range : input_record_ranges) {
+    slices.push_back(make_tuple(get<0>(range.first), get<1>(range.first), ExchangeMask(get<2>(range.first)), &range.second));
+  }
+  sort(slices.begin(), slices.end(),[] (const InputRecordSlice &left, const InputRecordSlice &right) {
+    return (get<3>(left)->size() > get<3>(right)->size());
+  });
+  for (auto& slice : slices) {
+    shared_ptr<ExecutionUnit> job = make_shared<VenueNbboExecutionUnit>(
+      get<0>(slice), get<1>(slice), get<2>(slice), request.input_sorted, request.tz_name == "UTC", move(*get<3>(slice))
+    );
+    todo_list.push_back(job);
+    AddExecutionUnit(job);
+  }
+}
+
+}
@@ -43,6 +43,150 @@ private:
   map<SymbolDateKey, InputRecordRange> input_record_ranges;
 };
 
+class VenueNbboExecutionPlan : public ExecutionPlan {
+  class VenueNbboExecutionUnit : public ExecutionUnit {
+  public:
+    struct InputRecord {
+      InputRecord(int id, Time time) : time(time), id(id) {}
+      Time time;
+      int id;
+    };
+    VenueNbboExecutionUnit(const string& symbol, Date date, ExchangeMask exchanges, bool input_sorted, bool adjust_time,
+                           vector<InputRecord> input_records)
+      : symbol(symbol), date(date), exchanges(exchanges), input_sorted(input_sorted), adjust_time(adjust_time),
+        input_records(move(input_records)) {}
+    ~VenueNbboExecutionUnit() {}
+    void Execute() override;
+    const string symbol;
+    const Date date;
+    const ExchangeMask exchanges;
+    const bool input_sorted;
+    const bool adjust_time;
+    vector<InputRecord> input_records;
+  };
+public:
+  VenueNbboExecutionPlan(const FunctionDefinition& function, const Request& request, const vector<int>& argument_mapping)
+    : ExecutionPlan(function, request, argument_mapping) {}
+  void Input(InputRecord& input_record) override;
+  void Execute() override;
+private:
+  using InputRecordRange = vector<VenueNbboExecutionUnit::InputRecord>;
+  using VenueKey = tuple<string, Date, unsigned long>;    // symbol, date and exchange mask
+  map<VenueKey, InputRecordRange> input_record_ranges;
+};
+
+class TradeSignExecutionPlan : public ExecutionPlan {
+  class TradeSignExecutionUnit : public ExecutionUnit {
+  public:
+    struct InputRecord {
+      InputRecord(int id, Time start_time, Time end_time) : start_time(start_time), end_time(end_time), id(id) {}
+      Time start_time;
+      Time end_time;
+      int id;
+    };
+    TradeSignExecutionUnit(const string& symbol, Date date, bool adjust_time, vector<InputRecord> input_records)
+      : symbol(symbol), date(date), adjust_time(adjust_time), input_records(move(input_records)) {}
+    ~TradeSignExecutionUnit() {}
+    void Execute() override;
+    const string symbol;
+    const Date date;
+    const bool adjust_time;
+    vector<InputRecord> input_records;
+  };
+public:
+  TradeSignExecutionPlan(const FunctionDefinition& function, const Request& request, const vector<int>& argument_mapping)
+    : ExecutionPlan(function, request, argument_mapping) {}
+  void Input(InputRecord& input_record) override;
+  void Execute() override;
+private:
+  using InputRecordRange = vector<TradeSignExecutionUnit::InputRecord>;
+  map<SymbolDateKey, InputRecordRange> input_record_ranges;
+};
+
+class BarsExecutionPlan : public ExecutionPlan {
+  class BarsExecutionUnit : public ExecutionUnit {
+  public:
+    struct InputRecord {
+      InputRecord(int id, Time start_time, Time end_time, int interval)
+        : start_time(start_time), end_time(end_time), interval(interval), id(id) {}
+      Time start_time;
+      Time end_time;
+      int interval;       // seconds
+      int id;
+    };
+    BarsExecutionUnit(const string& symbol, Date date, bool adjust_time, vector<InputRecord> input_records)
+      : symbol(symbol), date(date), adjust_time(adjust_time), input_records(move(input_records)) {}
+    ~BarsExecutionUnit() {}
+    void Execute() override;
+    const string symbol;
+    const Date date;
+    const bool adjust_time;
+    vector<InputRecord> input_records;
+  };
+public:
+  BarsExecutionPlan(const FunctionDefinition& function, const Request& request, const vector<int>& argument_mapping)
+    : ExecutionPlan(function, request, argument_mapping) {}
+  void Input(InputRecord& input_record) override;
+  void Execute() override;
+private:
+  using InputRecordRange = vector<BarsExecutionUnit::InputRecord>;
+  map<SymbolDateKey, InputRecordRange> input_record_ranges;
+};
+
+class DailyStatsExecutionPlan : public ExecutionPlan {
+  class DailyStatsExecutionUnit : public ExecutionUnit {
+  public:
+    struct InputRecord {
+      InputRecord(int id, const string& symbol) : symbol(symbol), id(id) {}
+      string symbol;
+      int id;
+    };
+    DailyStatsExecutionUnit(Date start_date, Date end_date, vector<InputRecord> input_records)
+      : start_date(start_date), end_date(end_date), input_records(move(input_records)) {}
+    ~DailyStatsExecutionUnit() {}
+    void Execute() override;
+    const Date start_date;
+    const Date end_date;
+    vector<InputRecord> input_records;
+  };
+public:
+  static const size_t UNIT_RECORDS = 1024;     // symbols of a date range per unit
+  DailyStatsExecutionPlan(const FunctionDefinition& function, const Request& request, const vector<int>& argument_mapping)
+    : ExecutionPlan(function, request, argument_mapping) {}
+  void Input(InputRecord& input_record) override;
+  void Execute() override;
+private:
+  using InputRecordRange = vector<DailyStatsExecutionUnit::InputRecord>;
+  map<pair<Date, Date>, InputRecordRange> input_record_ranges;
+};
+
+class SnapshotExecutionPlan : public ExecutionPlan {
+  class SnapshotExecutionUnit : public ExecutionUnit {
+  public:
+    struct InputRecord {
+      InputRecord(int id, const string& symbol) : symbol(symbol), id(id) {}
+      string symbol;      // empty for all securities
+      int id;
+    };
+    SnapshotExecutionUnit(Date date, Time time, bool adjust_time, vector<InputRecord> input_records)
+      : date(date), time(time), adjust_time(adjust_time), input_records(move(input_records)) {}
+    ~SnapshotExecutionUnit() {}
+    void Execute() override;
+    const Date date;
+    const Time time;
+    const bool adjust_time;
+    vector<InputRecord> input_records;
+  };
+public:
+  SnapshotExecutionPlan(const FunctionDefinition& function, const Request& request, const vector<int>& argument_mapping)
+    : ExecutionPlan(function, request, argument_mapping) {}
+  void Input(InputRecord& input_record) override;
+  void Execute() override;
+private:
+  using InputRecordRange = vector<SnapshotExecutionUnit::InputRecord>;
+  map<pair<Date, Time>, InputRecordRange> input_record_ranges;
+};
+
 class RodExecutionPlan : public ExecutionPlan {
 public:
   enum class RestType { MinusThree, MinusTwo, MinusOne, Zero, PlusOne, PlusTwo, PlusThree, None, Max = None };
@@ -32,9 +32,9 @@ class SecMasterManager;
 class SecMaster {
   friend class SecMasterManager;
   public:
-    SecMaster(Date date, size_t sec_no, mm::file_mapping & mmfile, mm::mapped_region & mmreg)
+    SecMaster(Date date, size_t header_size, size_t sec_no, mm::file_mapping & mmfile, mm::mapped_region & mmreg)
       : date_(date), mmfile_(move(mmfile)), mmreg_(move(mmreg)), use_cnt_(0) {
-      Security* start = (Security*)((char*)mmreg_.get_address() + sizeof(FileHeader));
+      Security* start = (Security*)((char*)mmreg_.get_address() + header_size);
       list_ = vector<Security>(start, start + sec_no);
       for_each(list_.begin(), list_.end(), [&](const auto& sec) {
         by_symb_.insert(make_pair(sec.symb, &sec));
@@ -54,6 +54,10 @@ class SecMaster {
       }
       return *(it->second);
     }
+    // in file order, which is that of the columns of the day's snapshot file
+    const vector<Security> & Securities() const {
+      return list_;
+    }
 
   private:
     const Date date_;
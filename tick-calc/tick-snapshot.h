@@ -0,0 +1,74 @@
+#ifndef TICK_CALC_SNAPSHOT_INCLUDED
+#define TICK_CALC_SNAPSHOT_INCLUDED
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include "taq-proc.h"
+
+namespace mm = boost::interprocess;
+namespace fs = boost::filesystem;
+namespace pt = boost::posix_time;
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// the NBBO snapshot file of a day; the records of all securities at a grid time are one row, read in place
+class SnapshotManager;
+class DaySnapshot {
+  friend class SnapshotManager;
+  public:
+    DaySnapshot(Date date, size_t header_size, size_t symb_cnt, const SnapshotGrid & grid, mm::file_mapping & mmfile,
+                mm::mapped_region & mmreg)
+      : date_(date), mmfile_(move(mmfile)), mmreg_(move(mmreg)), symb_cnt_(symb_cnt), grid_(grid), use_cnt_(0) {
+      rows_ = (const Nbbo*)((const char*)mmreg_.get_address() + header_size);
+      symbols_ = (const Symbol*)(rows_ + symb_cnt * grid.time_cnt);
+    }
+    // the records of the securities in sec master order, nullptr if the time is not one of the grid
+    const Nbbo* Row(int64_t time) const {
+      size_t idx = 0;
+      return grid_.Find(time, idx) ? rows_ + idx * symb_cnt_ : nullptr;
+    }
+    // whether column i of the rows is that of the security
+    bool IsColumnOf(size_t i, const Security & security) const {
+      return i < symb_cnt_ && 0 == strncmp(symbols_[i], security.symb, sizeof(Symbol));
+    }
+    size_t SymbolCount() const { return symb_cnt_; }
+
+  private:
+    const Date date_;
+    mm::file_mapping mmfile_;
+    mm::mapped_region mmreg_;
+    const Nbbo* rows_;
+    const Symbol* symbols_;
+    const size_t symb_cnt_;
+    const SnapshotGrid grid_;
+    pt::ptime last_used_;
+    mutable int use_cnt_;
+};
+
+class SnapshotManager {
+  public:
+    typedef map<Date, unique_ptr<DaySnapshot>> SnapshotTable;
+    SnapshotManager(const string & data_dir, size_t max_size = 22)  : data_dir_(data_dir) , max_size_(max_size) { }
+    const DaySnapshot & Load(Date);
+    void Release(const DaySnapshot &);
+  private:
+    void trim();
+    const string data_dir_;
+    const size_t max_size_;
+    mutex mtx_;
+    SnapshotTable snapshots_;
+};
+
+}
+#endif
@@ -0,0 +1,68 @@
+#ifndef TICK_CALC_SUMMARY_INCLUDED
+#define TICK_CALC_SUMMARY_INCLUDED
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include "taq-proc.h"
+
+namespace mm = boost::interprocess;
+namespace fs = boost::filesystem;
+namespace pt = boost::posix_time;
+
+using namespace std;
+using namespace Taq;
+
+namespace tick_calc {
+
+// the summary file of a day, searched in place through its symbol directory
+class SummaryManager;
+class DaySummary {
+  friend class SummaryManager;
+  public:
+    DaySummary(Date date, size_t header_size, size_t symb_cnt, uint64_t slot_cnt, mm::file_mapping & mmfile,
+               mm::mapped_region & mmreg)
+      : date_(date), mmfile_(move(mmfile)), mmreg_(move(mmreg)), symb_cnt_(symb_cnt), slot_cnt_(slot_cnt), use_cnt_(0) {
+      records_ = (const DailySummary*)((const char*)mmreg_.get_address() + header_size);
+      slots_ = (const uint32_t*)(records_ + symb_cnt);
+    }
+    // nullptr if the day's sec master does not list the symbol
+    const DailySummary* FindBySymbol(const string& symbol) const {
+      return FindSummary(records_, symb_cnt_, slots_, slot_cnt_, symbol);
+    }
+
+  private:
+    const Date date_;
+    mm::file_mapping mmfile_;
+    mm::mapped_region mmreg_;
+    const DailySummary* records_;
+    const uint32_t* slots_;
+    const size_t symb_cnt_;
+    const uint64_t slot_cnt_;
+    pt::ptime last_used_;
+    mutable int use_cnt_;
+};
+
+// keeps about a year of days mapped, so that date range queries of many symbols find their days loaded
+class SummaryManager {
+  public:
+    typedef map<Date, unique_ptr<DaySummary>> SummaryTable;
+    SummaryManager(const string & data_dir, size_t max_size = 260)  : data_dir_(data_dir) , max_size_(max_size) { }
+    const DaySummary & Load(Date);
+    void Release(const DaySummary &);
+  private:
+    void trim();
+    const string data_dir_;
+    const size_t max_size_;
+    mutex mtx_;
+    SummaryTable summaries_;
+};
+
+}
+#endif